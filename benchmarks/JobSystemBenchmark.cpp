@@ -0,0 +1,107 @@
+// Measures overhead of job system in ns per job: spawning and running empty
+// jobs from outside and from inside of a worker, stealing them, and splitting
+// a parallel for into jobs, for increasing worker counts.
+//
+// usage : job_system_benchmark [jobs per batch] [pin workers 0/1]
+
+#include "JobSystem.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+namespace {
+
+// run given function a few times and return best time in seconds
+template<typename Func>
+double bestOf(uint32_t runs, Func&& func){
+    double best = 1e30;
+    for(uint32_t r = 0; r < runs; r++){
+        auto start = std::chrono::high_resolution_clock::now();
+        func();
+        auto stop = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double>(stop - start).count());
+    }
+    return best;
+}
+
+// keeps compiler from removing empty jobs
+std::atomic<uint64_t> executed{0};
+
+} // namespace
+
+int main(int argc, char** argv){
+    size_t jobCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2048;
+    bool pinWorkers = argc > 2 && std::atoi(argv[2]) != 0;
+    if(jobCount == 0 || jobCount >= JobSystem::maxJobsPerThread){
+        std::cerr << "[ERROR] Jobs per batch has to be between 1 and " << JobSystem::maxJobsPerThread - 1 << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // powers of two up to all cores of host, plus no workers at all
+    uint32_t maxWorkers = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint32_t> workerCounts{0};
+    for(uint32_t workers = 1; workers < maxWorkers; workers *= 2) workerCounts.push_back(workers);
+    workerCounts.push_back(maxWorkers);
+
+    auto nsPerJob = [&](double seconds){ return seconds * 1e9 / jobCount; };
+    auto empty = [](){ executed.fetch_add(1, std::memory_order_relaxed); };
+
+    for(uint32_t workers : workerCounts){
+        JobSystem jobSystem;
+        if(workers > 0) jobSystem.init(workers, pinWorkers);
+
+        // jobs from a thread outside of system go through shared queue
+        double external = bestOf(10, [&](){
+            JobCounter counter;
+            for(size_t i = 0; i < jobCount; i++) jobSystem.run(&counter, empty);
+            jobSystem.wait(counter);
+        });
+
+        // jobs spawned by a worker go to its own deque, worker pops them back
+        // unless others steal them first
+        double local = 0.0, stolen = 0.0, parallel = 0.0;
+        if(workers > 0){
+            local = bestOf(10, [&](){
+                JobCounter root;
+                jobSystem.run(&root, [&](){
+                    JobCounter counter;
+                    for(size_t i = 0; i < jobCount; i++) jobSystem.run(&counter, empty);
+                    jobSystem.wait(counter);
+                });
+                jobSystem.wait(root);
+            });
+        }
+
+        // spawning worker doesn't help, every job has to be stolen
+        if(workers > 1){
+            stolen = bestOf(10, [&](){
+                JobCounter root;
+                jobSystem.run(&root, [&](){
+                    JobCounter counter;
+                    for(size_t i = 0; i < jobCount; i++) jobSystem.run(&counter, empty);
+                    while(!counter.isDone()) std::this_thread::yield();
+                });
+                jobSystem.wait(root);
+            });
+        }
+
+        // one index per batch, so every index is a job
+        parallel = bestOf(10, [&](){
+            jobSystem.parallelFor(jobCount, 1, [](size_t begin, size_t end){
+                executed.fetch_add(end - begin, std::memory_order_relaxed);
+            });
+        });
+
+        printf("%3u workers : external %7.1f ns/job", workers, nsPerJob(external));
+        if(workers > 0) printf(", local %7.1f ns/job", nsPerJob(local));
+        if(workers > 1) printf(", stolen %7.1f ns/job", nsPerJob(stolen));
+        printf(", parallelFor %7.1f ns/index\n", nsPerJob(parallel));
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+// Measures obj load throughput in MB/s of parallel parser for increasing
+// thread counts and compares it with tinyobj loader.
+//
+// usage : obj_parser_benchmark [size in MB] [path of generated file]
+
+#include "ObjParser.hpp"
+#include "tiny_obj_loader.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+namespace {
+
+// write a wavy grid with normals and texture coordinates until file reaches given size
+size_t generateObj(const char* path, size_t targetSize){
+    FILE* file = fopen(path, "wb");
+    if(file == nullptr) return 0;
+
+    // rows of grid are added until file is big enough, each row has fixed width
+    const uint32_t width = 1024;
+    size_t written = 0;
+
+    written += fprintf(file, "# generated by obj_parser_benchmark\no grid\n");
+    uint32_t row = 0;
+    while(written < targetSize){
+        for(uint32_t x = 0; x < width; x++){
+            float fx = x * 0.01f, fz = row * 0.01f;
+            float y = std::sin(fx * 3.1f) * std::cos(fz * 2.3f);
+            written += fprintf(file, "v %.6f %.6f %.6f\n", fx, y, fz);
+            written += fprintf(file, "vn %.6f %.6f %.6f\n", 0.f, 1.f, 0.f);
+            written += fprintf(file, "vt %.6f %.6f\n", fx, fz);
+        }
+
+        // quads between this row and previous one
+        if(row > 0){
+            uint32_t a = (row - 1) * width + 1, b = row * width + 1;
+            for(uint32_t x = 0; x + 1 < width; x++){
+                written += fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n",
+                                   a + x, a + x, a + x, a + x + 1, a + x + 1, a + x + 1,
+                                   b + x + 1, b + x + 1, b + x + 1, b + x, b + x, b + x);
+            }
+        }
+        row++;
+    }
+
+    fclose(file);
+    return written;
+}
+
+// run given function a few times and return best time in seconds
+template<typename Func>
+double bestOf(uint32_t runs, Func&& func){
+    double best = 1e30;
+    for(uint32_t r = 0; r < runs; r++){
+        auto start = std::chrono::high_resolution_clock::now();
+        func();
+        auto stop = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double>(stop - start).count());
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+    size_t sizeMB = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+    std::string path = argc > 2 ? argv[2] : "obj_parser_benchmark.obj";
+
+    std::cout << "Generating " << sizeMB << " MB obj file " << path << std::endl;
+    size_t size = generateObj(path.c_str(), sizeMB << 20);
+    if(size == 0){
+        std::cerr << "[ERROR] Failed to write " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+    double megabytes = size / double(1 << 20);
+
+    // warm page cache, so disk speed isn't measured
+    ObjData data;
+    parseObjFile(path.c_str(), data);
+    std::cout << data.positions.size() / 3 << " positions, " << data.faceSizes.size() << " faces" << std::endl;
+
+    // powers of two up to all cores of host
+    size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> threadCounts;
+    for(size_t threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    double singleThreaded = 0.0;
+    for(size_t threads : threadCounts){
+        double seconds = bestOf(3, [&](){ parseObjFile(path.c_str(), data, threads); });
+        if(threads == 1) singleThreaded = seconds;
+
+        printf("parseObjFile %3zu threads : %8.1f MB/s, speedup %5.2fx\n",
+               threads, megabytes / seconds, singleThreaded / seconds);
+    }
+
+    // baseline, single threaded line by line parsing
+    double tinyobjSeconds = bestOf(1, [&](){
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+        tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str(), nullptr);
+    });
+    printf("tinyobj                  : %8.1f MB/s\n", megabytes / tinyobjSeconds);
+
+    std::remove(path.c_str());
+    return EXIT_SUCCESS;
+}
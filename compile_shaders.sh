@@ -1,4 +0,0 @@
-#!/bin/zsh
-glslc shaders/triangle.vert -o shaders/compiled/triangle.vert.spv
-glslc shaders/triangle.frag -o shaders/compiled/triangle.frag.spv
-
@@ -0,0 +1,38 @@
+#version 450
+
+// only position stream is bound in depth only passes
+// works for both full precision and unorm16 packed positions
+layout (location = 0) in vec3 vPosition;
+
+// invariant so mesh shaders compute exactly same depth as this prepass
+invariant gl_Position;
+
+#define MAX_LIGHTS 16
+
+struct PointLight {
+    vec4 position;
+    vec4 color;
+};
+
+// get uniform data
+layout(set = 0, binding = 0) uniform UniformData {
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    vec4 ambient;
+    vec3 viewPosition;
+    uint numPointLights;
+    PointLight pointLights[MAX_LIGHTS];
+} uniformData;
+
+// push constants
+layout( push_constant ) uniform constants {
+    mat4 modelMatrix;
+    mat3x4 normalMatrix;
+    vec4 color;
+} pushData;
+
+void main(){
+    // same operations in same order as mesh shaders, so depth matches exactly in shading pass
+    vec4 vPositionWorldSpace = pushData.modelMatrix * vec4(vPosition, 1.f);
+    gl_Position = uniformData.projectionMatrix * uniformData.viewMatrix * vPositionWorldSpace;
+}
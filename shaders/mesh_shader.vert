@@ -10,6 +10,9 @@ layout (location = 0) out vec3 fragColor;
 layout (location = 1) out vec3 fragPosWorld;
 layout (location = 2) out vec3 fragNormalWorld;
 
+// depth has to be bit identical to depth_only.vert, shading pass tests against prepass depth
+invariant gl_Position;
+
 #define MAX_LIGHTS 16
 
 struct PointLight {
@@ -35,7 +38,8 @@ layout(set = 0, binding = 0) uniform UniformData {
 // push constants
 layout( push_constant ) uniform constants {
     mat4 modelMatrix;
-    mat4 normalMatrix;
+    mat3x4 normalMatrix;
+    vec4 color;
 } pushData;
 
 void main(){
@@ -43,12 +47,12 @@ void main(){
     vec4 vPositionWorldSpace = pushData.modelMatrix * vec4(vPosition, 1.f);
 
     // calculate normal in world space
-    fragNormalWorld = normalize(mat3(pushData.modelMatrix) * vNormal);
+    fragNormalWorld = normalize(mat3(pushData.normalMatrix) * vNormal);
     fragPosWorld = vPositionWorldSpace.xyz;
-    fragColor = vColor;
+    fragColor = vColor * pushData.color.rgb;
 
     // calculate position in eye space
     gl_Position = uniformData.projectionMatrix * uniformData.viewMatrix * vPositionWorldSpace;
 
-    fragColor = vColor;
+    fragColor = vColor * pushData.color.rgb;
 }
@@ -0,0 +1,69 @@
+#version 450
+
+// get packed vertex data
+// position is unorm16 in [0, 1], dequantized by model matrix
+layout (location = 0) in vec3 vPosition;
+// color is unorm8
+layout (location = 1) in vec3 vColor;
+// normal is octahedral encoded snorm16
+layout (location = 2) in vec2 vNormal;
+
+// give out fragment color
+layout (location = 0) out vec3 fragColor;
+layout (location = 1) out vec3 fragPosWorld;
+layout (location = 2) out vec3 fragNormalWorld;
+
+// depth has to be bit identical to depth_only.vert, shading pass tests against prepass depth
+invariant gl_Position;
+
+#define MAX_LIGHTS 16
+
+struct PointLight {
+    vec4 position;
+    vec4 color;
+};
+
+struct DirectionalLight {
+    vec4 direction;
+    vec4 color;
+};
+
+// get uniform data
+layout(set = 0, binding = 0) uniform UniformData {
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    vec4 ambient;
+    vec3 viewPosition;
+    uint numPointLights;
+    PointLight pointLights[MAX_LIGHTS];
+} uniformData;
+
+// push constants
+layout( push_constant ) uniform constants {
+    mat4 modelMatrix;
+    mat3x4 normalMatrix;
+    vec4 color;
+} pushData;
+
+// decode octahedral mapped unit vector
+vec3 octDecode(vec2 e){
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main(){
+    // calculate position of vertex in world space
+    vec4 vPositionWorldSpace = pushData.modelMatrix * vec4(vPosition, 1.f);
+
+    // calculate normal in world space
+    // normal matrix is of object only, dequantization doesn't apply to normals
+    fragNormalWorld = normalize(mat3(pushData.normalMatrix) * octDecode(vNormal));
+    fragPosWorld = vPositionWorldSpace.xyz;
+    fragColor = vColor * pushData.color.rgb;
+
+    // calculate position in eye space
+    gl_Position = uniformData.projectionMatrix * uniformData.viewMatrix * vPositionWorldSpace;
+}
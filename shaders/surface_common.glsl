@@ -0,0 +1,61 @@
+// Shared part of surface kernels.
+// A kernel defines vec3 surfacePoint(vec2 uv, float time) and includes this file.
+// Every invocation writes one grid point of the surface straight into the
+// full precision vertex streams of geometry buffer.
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// position stream, 3 floats per vertex
+layout (std430, set = 0, binding = 0) writeonly buffer Positions {
+    float positions[];
+};
+
+// attribute stream, color and normal per vertex
+layout (std430, set = 0, binding = 1) writeonly buffer Attributes {
+    float attributes[];
+};
+
+// parameters of this update, matches SurfaceParameters on host
+layout (push_constant) uniform SurfaceParameters {
+    vec2 rangeMin;
+    vec2 rangeMax;
+    vec4 color;
+    uvec2 resolution;
+    float time;
+    uint vertexOffset;
+} params;
+
+vec2 gridPoint(uvec2 id){
+    vec2 step = (params.rangeMax - params.rangeMin) / vec2(max(params.resolution - 1u, uvec2(1)));
+    return params.rangeMin + vec2(id) * step;
+}
+
+void main(){
+    uvec2 id = gl_GlobalInvocationID.xy;
+    if(id.x >= params.resolution.x || id.y >= params.resolution.y) return;
+
+    vec2 uv = gridPoint(id);
+    vec3 position = surfacePoint(uv, params.time);
+
+    // smooth normal from central differences, one sided at borders
+    vec2 uv0 = gridPoint(max(id, uvec2(1)) - 1u);
+    vec2 uv1 = gridPoint(min(id + 1u, params.resolution - 1u));
+    vec3 tangentU = surfacePoint(vec2(uv1.x, uv.y), params.time) - surfacePoint(vec2(uv0.x, uv.y), params.time);
+    vec3 tangentV = surfacePoint(vec2(uv.x, uv1.y), params.time) - surfacePoint(vec2(uv.x, uv0.y), params.time);
+    vec3 normal = cross(tangentV, tangentU);
+    float len = length(normal);
+    normal = len > 0.0 ? normal / len : vec3(0, 1, 0);
+
+    uint vertex = params.vertexOffset + id.y * params.resolution.x + id.x;
+
+    positions[3 * vertex + 0] = position.x;
+    positions[3 * vertex + 1] = position.y;
+    positions[3 * vertex + 2] = position.z;
+
+    attributes[6 * vertex + 0] = params.color.r;
+    attributes[6 * vertex + 1] = params.color.g;
+    attributes[6 * vertex + 2] = params.color.b;
+    attributes[6 * vertex + 3] = normal.x;
+    attributes[6 * vertex + 4] = normal.y;
+    attributes[6 * vertex + 5] = normal.z;
+}
@@ -0,0 +1,89 @@
+#version 450
+
+// integer grid coordinates of patch vertex in x and z
+layout (location = 0) in vec3 vGrid;
+// node drawn by this instance, xy is minimum corner, z is size and w is level
+layout (location = 1) in vec4 iNode;
+
+// same outputs as mesh shader, terrain is shaded by mesh fragment shader
+layout (location = 0) out vec3 fragColor;
+layout (location = 1) out vec3 fragPosWorld;
+layout (location = 2) out vec3 fragNormalWorld;
+
+#define MAX_LIGHTS 16
+
+struct PointLight {
+    vec4 position;
+    vec4 color;
+};
+
+// get uniform data
+layout(set = 0, binding = 0) uniform UniformData {
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    vec4 ambient;
+    vec3 viewPosition;
+    uint numPointLights;
+    PointLight pointLights[MAX_LIGHTS];
+} uniformData;
+
+// heightmap samples, row by row
+layout (std430, set = 1, binding = 0) readonly buffer Heights {
+    float heights[];
+};
+
+// matches TerrainParameters on host
+layout (push_constant) uniform TerrainParameters {
+    vec2 origin;
+    float size;
+    float lodRange;
+    float morphRatio;
+    uint heightResolution;
+    uint patchResolution;
+    float padding;
+    vec4 color;
+} terrain;
+
+float heightAt(uint i, uint j){
+    return heights[j * terrain.heightResolution + i];
+}
+
+// bilinear sample of heightmap at world x and z
+float sampleHeight(vec2 world){
+    float last = float(terrain.heightResolution - 1u);
+    vec2 uv = clamp((world - terrain.origin) / terrain.size * last, vec2(0.0), vec2(last));
+    uvec2 p = min(uvec2(uv), uvec2(terrain.heightResolution - 2u));
+    vec2 f = uv - vec2(p);
+
+    float h0 = mix(heightAt(p.x, p.y), heightAt(p.x + 1u, p.y), f.x);
+    float h1 = mix(heightAt(p.x, p.y + 1u), heightAt(p.x + 1u, p.y + 1u), f.x);
+    return mix(h0, h1, f.y);
+}
+
+void main(){
+    float cellSize = iNode.z / float(terrain.patchResolution);
+    vec2 world = iNode.xy + vGrid.xz * cellSize;
+
+    // morph factor from distance, 0 inside range of node level and 1 at its end
+    float range = terrain.lodRange * exp2(iNode.w);
+    float morphStart = range * (1.0 - terrain.morphRatio);
+    float distance = length(vec3(world.x, sampleHeight(world), world.y) - uniformData.viewPosition);
+    float morph = clamp((distance - morphStart) / (range - morphStart), 0.0, 1.0);
+
+    // odd grid vertices slide onto their even neighbours, turning patch into grid of next level
+    vec2 odd = fract(vGrid.xz * 0.5) * 2.0;
+    world -= odd * cellSize * morph;
+
+    float height = sampleHeight(world);
+
+    // normal from central differences at spacing of grid, so far nodes are shaded smoother
+    float h = cellSize * mix(1.0, 2.0, morph);
+    float dx = sampleHeight(world + vec2(h, 0.0)) - sampleHeight(world - vec2(h, 0.0));
+    float dz = sampleHeight(world + vec2(0.0, h)) - sampleHeight(world - vec2(0.0, h));
+    fragNormalWorld = normalize(vec3(-dx, 2.0 * h, -dz));
+
+    fragPosWorld = vec3(world.x, height, world.y);
+    fragColor = terrain.color.rgb;
+
+    gl_Position = uniformData.projectionMatrix * uniformData.viewMatrix * vec4(fragPosWorld, 1.0);
+}
@@ -4,6 +4,9 @@
 #include <glm/geometric.hpp>
 #include <glm/gtx/rotate_vector.hpp>
 
+#include <cmath>
+#include <algorithm>
+
 #include "KeyboardState.hpp"
 #include "MouseState.hpp"
 
@@ -96,3 +99,24 @@ float Camera::getFieldOfView() const{
     return fieldOfView;
 }
 
+void Camera::setClipPlanes(float near, float far){
+    nearPlane = near;
+    farPlane = far;
+
+    // update projection matrix
+    projectionMatrix = glm::perspective(glm::radians(fieldOfView), aspectRatio, nearPlane, farPlane);
+    projectionMatrix[1][1] *= -1; // flip Y axis
+}
+
+Frustum Camera::getFrustum() const{
+    return Frustum::fromMatrix(projectionMatrix * viewMatrix);
+}
+
+float Camera::getProjectedSize(float worldSize, float distance, float viewportHeight) const{
+    // objects closer than near plane are clipped anyways
+    distance = std::max(distance, nearPlane);
+
+    // height of view frustum at given distance maps to viewport height
+    float frustumHeight = 2.f * distance * std::tan(glm::radians(fieldOfView) / 2.f);
+    return worldSize * viewportHeight / frustumHeight;
+}
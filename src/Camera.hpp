@@ -13,6 +13,8 @@
 #include <SDL2/SDL.h>
 #include <iostream>
 
+#include "Frustum.hpp"
+
 class Camera{
 public:
     /**
@@ -78,6 +80,38 @@ public:
     /// get field of view of camera
     float getFieldOfView() const;
 
+    /**
+     * @brief Set distances of near and far clipping planes.
+     *
+     * @param near Distance of near plane, must be positive.
+     * @param far Distance of far plane, must be greater than near.
+     * */
+    void setClipPlanes(float near, float far);
+
+    /// get distance of near clipping plane
+    inline float getNearPlane() const { return nearPlane; }
+
+    /// get distance of far clipping plane
+    inline float getFarPlane() const { return farPlane; }
+
+    /**
+     * @brief Get view frustum of camera in world space.
+     *
+     * @return Frustum
+     * */
+    Frustum getFrustum() const;
+
+    /**
+     * @brief Get size in pixels of a world space length seen from given distance.
+     * Used to convert object space errors to screen space errors.
+     *
+     * @param[in] worldSize Length in world space units.
+     * @param[in] distance Distance of that length from camera.
+     * @param[in] viewportHeight Height of viewport in pixels.
+     * @return float Projected size in pixels.
+     * */
+    float getProjectedSize(float worldSize, float distance, float viewportHeight) const;
+
     /// glm::vec3 alias for x, y and z axis
     static inline const glm::vec3 XAxis = glm::vec3(1, 0, 0), YAxis = glm::vec3(0, 1, 0), ZAxis = glm::vec3(0, 0, 1);
 
@@ -8,4 +8,9 @@
 #define MIN_WINDOW_WIDTH 800
 #define MIN_WINDOW_HEIGHT 600
 
+// directory of compiled shaders, set by build to where it compiles them
+#ifndef SHADER_DIR
+#error "SHADER_DIR has to be defined as directory of compiled shaders"
+#endif
+
 #endif//CONFIG_HPP
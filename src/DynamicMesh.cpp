@@ -0,0 +1,75 @@
+#include "DynamicMesh.hpp"
+
+#include <algorithm>
+
+void DynamicMesh::markDirty(uint32_t first, uint32_t count){
+    if(count == 0) return;
+
+    for(FrameCopy& copy : frames){
+        copy.dirty.push_back({first, count});
+
+        // too many scattered edits, one covering range is cheaper to track
+        if(copy.dirty.size() > maxDirtyRanges){
+            uint32_t begin = first, end = first + count;
+            for(const VertexRange& range : copy.dirty){
+                begin = std::min(begin, range.first);
+                end = std::max(end, range.first + range.count);
+            }
+            copy.dirty.assign(1, {begin, end - begin});
+        }
+    }
+}
+
+void DynamicMesh::markAllDirty(){
+    for(FrameCopy& copy : frames){
+        copy.dirty.assign(1, {0, static_cast<uint32_t>(vertices.size())});
+    }
+}
+
+Vertex* DynamicMesh::editVertices(uint32_t first, uint32_t count){
+    markDirty(first, count);
+    return vertices.data() + first;
+}
+
+size_t DynamicMesh::update(VmaAllocator allocator, size_t frame){
+    FrameCopy& copy = frames[frame];
+    if(copy.dirty.empty()) return 0;
+
+    // overlapping and touching ranges are copied once
+    std::sort(copy.dirty.begin(), copy.dirty.end(),
+              [](const VertexRange& a, const VertexRange& b){ return a.first < b.first; });
+    size_t merged = 0;
+    for(size_t i = 1; i < copy.dirty.size(); i++){
+        VertexRange& last = copy.dirty[merged];
+        const VertexRange& range = copy.dirty[i];
+        if(range.first <= last.first + last.count){
+            last.count = std::max(last.first + last.count, range.first + range.count) - last.first;
+        }else copy.dirty[++merged] = range;
+    }
+    copy.dirty.resize(merged + 1);
+
+    size_t copied = 0;
+    const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    for(const VertexRange& range : copy.dirty){
+        uint32_t begin = std::min(range.first, vertexCount);
+        uint32_t end = std::min(range.first + range.count, vertexCount);
+        if(begin == end) continue;
+
+        // split vertices in streams of full precision format, written in order for write combining
+        for(uint32_t i = begin; i < end; i++){
+            copy.positions[i] = vertices[i].position;
+            copy.attributes[i].color = vertices[i].color;
+            copy.attributes[i].normal = vertices[i].normal;
+        }
+
+        // no-op on host coherent memory
+        vmaFlushAllocation(allocator, copy.positionBuffer.allocation,
+                           VkDeviceSize(begin) * sizeof(glm::vec3), VkDeviceSize(end - begin) * sizeof(glm::vec3));
+        vmaFlushAllocation(allocator, copy.attributeBuffer.allocation,
+                           VkDeviceSize(begin) * sizeof(VertexAttributes), VkDeviceSize(end - begin) * sizeof(VertexAttributes));
+        copied += end - begin;
+    }
+    copy.dirty.clear();
+
+    return copied;
+}
@@ -0,0 +1,81 @@
+#ifndef DYNAMIC_MESH_HPP
+#define DYNAMIC_MESH_HPP
+
+#include <vector>
+
+#include "Common.hpp"
+#include "AllocatedBuffer.hpp"
+#include "Vertex.hpp"
+#include "Mesh.hpp"
+
+// a range of vertices, first vertex and number of vertices
+struct VertexRange {
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+/**
+ * @brief Vertices of a mesh that change while it's drawn.
+ * Every frame in flight has its own copy of vertex streams in host visible
+ * memory, mapped for whole lifetime of mesh. Edited ranges are marked dirty
+ * and copied into copy of a frame just before that frame is recorded, so
+ * cost of an update depends on size of edit rather than size of mesh.
+ * Buffers are never recreated, number of vertices is fixed at creation.
+ * */
+struct DynamicMesh {
+    // mesh drawn by render objects, holds indices and bounds
+    MeshHandle mesh;
+
+    // vertices on cpu, source of all copies, moved here from mesh at creation
+    std::vector<Vertex> vertices;
+
+    // vertex streams of one frame in flight
+    struct FrameCopy {
+        AllocatedBuffer positionBuffer = {};
+        AllocatedBuffer attributeBuffer = {};
+        // persistently mapped streams
+        glm::vec3* positions = nullptr;
+        VertexAttributes* attributes = nullptr;
+        // ranges edited since this copy was last written
+        std::vector<VertexRange> dirty;
+    };
+    std::vector<FrameCopy> frames;
+
+    /**
+     * @brief Mark vertices as edited, they're copied to gpu before next frames are drawn.
+     *
+     * @param first First edited vertex.
+     * @param count Number of edited vertices.
+     * */
+    void markDirty(uint32_t first, uint32_t count);
+
+    /// mark all vertices as edited
+    void markAllDirty();
+
+    /**
+     * @brief Get vertices to edit, range is marked dirty.
+     *
+     * @param first First vertex to edit.
+     * @param count Number of vertices to edit.
+     * @return Vertex* Pointer to first vertex.
+     * */
+    Vertex* editVertices(uint32_t first, uint32_t count);
+
+    /**
+     * @brief Copy dirty ranges of a frame from vertices to its mapped streams.
+     * Frame must not be in use by gpu.
+     *
+     * @param allocator Allocator of frame buffers, used to flush non coherent memory.
+     * @param frame Index of frame in flight.
+     * @return size_t Number of vertices copied.
+     * */
+    size_t update(VmaAllocator allocator, size_t frame);
+
+    /// maximum number of separate dirty ranges kept per frame, beyond this they're merged into one
+    static constexpr size_t maxDirtyRanges = 64;
+};
+
+/// reference to a dynamic mesh created by a renderer
+using DynamicMeshHandle = Handle<DynamicMesh>;
+
+#endif//DYNAMIC_MESH_HPP
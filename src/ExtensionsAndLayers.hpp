@@ -26,6 +26,13 @@ static std::vector<const char *> requiredExtensions = {};
 static std::vector<const char *> requiredLayers = {};
 #endif
 
+/**
+ * @brief Check if an instance extension is present on host system.
+ * @param extensionName [in] name of extension to look for.
+ * @return SUCCESS if extension is available, FAILED otherwise.
+ */
+ReturnCode checkIfExtensionIsAvailable(const char* extensionName);
+
 /****************************************************************************************************************
  * @brief Get names of required extension names and layer names that are present on
  * host system. This function will clear the output vectors and then add names
@@ -0,0 +1,56 @@
+#include "FrameArena.hpp"
+
+#include <algorithm>
+
+void FrameArena::init(size_t initialCapacity){
+    destroy();
+    if(initialCapacity == 0) return;
+
+    blocks.emplace_back(new uint8_t[initialCapacity]);
+    blockAllocations++;
+    current = blocks.back().get();
+    capacity = initialCapacity;
+    reserved = initialCapacity;
+}
+
+void FrameArena::destroy(){
+    blocks.clear();
+    current = nullptr;
+    capacity = 0;
+    used = 0;
+    allocated = 0;
+    reserved = 0;
+}
+
+void* FrameArena::allocateSlow(size_t size, size_t alignment){
+    // new block fits this allocation and leaves room for more
+    size_t blockSize = std::max(size + alignment, std::max<size_t>(capacity * 2, 64 * 1024));
+    blocks.emplace_back(new uint8_t[blockSize]);
+    blockAllocations++;
+    current = blocks.back().get();
+    capacity = blockSize;
+    reserved += blockSize;
+
+    // new operator aligns to max_align_t at least, larger alignments are rounded up within block
+    size_t offset = (reinterpret_cast<uintptr_t>(current) + alignment - 1) & ~uintptr_t(alignment - 1);
+    offset -= reinterpret_cast<uintptr_t>(current);
+    used = offset + size;
+    allocated += size;
+    return current + offset;
+}
+
+void FrameArena::reset(){
+    peak = std::max(peak, allocated);
+
+    // frame didn't fit in one block, replace all with one that fits all of them
+    if(blocks.size() > 1){
+        blocks.clear();
+        blocks.emplace_back(new uint8_t[reserved]);
+        blockAllocations++;
+        current = blocks.back().get();
+        capacity = reserved;
+    }
+
+    used = 0;
+    allocated = 0;
+}
@@ -0,0 +1,109 @@
+#ifndef FRAME_ARENA_HPP
+#define FRAME_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+/**
+ * @brief Linear allocator for data that lives for one frame.
+ * Allocating bumps an offset and freeing does nothing, everything is
+ * released at once by reset(). When a block runs out another one is
+ * allocated from heap, and on reset blocks are merged into one big
+ * enough for whole frame, so once frames stop growing arena never
+ * touches heap again.
+ * */
+class FrameArena {
+public:
+    /**
+     * @brief Allocate first block, arena works without it but starts with a heap allocation.
+     *
+     * @param capacity Size of first block in bytes.
+     * */
+    void init(size_t capacity);
+
+    /// free all blocks, nothing allocated from arena may be used afterwards
+    void destroy();
+
+    /**
+     * @brief Allocate memory valid until next reset().
+     *
+     * @param size Size in bytes.
+     * @param alignment Alignment in bytes, has to be a power of two.
+     * @return void* Allocated memory, never null.
+     * */
+    inline void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+        uintptr_t begin = reinterpret_cast<uintptr_t>(current);
+        size_t offset = ((begin + used + alignment - 1) & ~uintptr_t(alignment - 1)) - begin;
+        if(offset + size > capacity) return allocateSlow(size, alignment);
+        used = offset + size;
+        allocated += size;
+        return current + offset;
+    }
+
+    /// release everything allocated since last reset, grows block if frame didn't fit
+    void reset();
+
+    /// bytes allocated since last reset
+    inline size_t getAllocated() const { return allocated; }
+    /// most bytes allocated within one frame
+    inline size_t getPeak() const { return peak; }
+    /// number of heap allocations made for blocks, stays constant at steady state
+    inline size_t getBlockAllocations() const { return blockAllocations; }
+
+private:
+    void* allocateSlow(size_t size, size_t alignment);
+
+    std::vector<std::unique_ptr<uint8_t[]>> blocks;
+    uint8_t* current = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+
+    // total over all blocks, what next reset has to fit into one block
+    size_t allocated = 0;
+    size_t reserved = 0;
+    size_t peak = 0;
+    size_t blockAllocations = 0;
+};
+
+/**
+ * @brief Standard allocator handing out memory of a FrameArena.
+ * Containers using it must not outlive next reset() of arena.
+ * Deallocation does nothing, memory comes back on reset.
+ * */
+template<typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator(FrameArena& arena) : arena(&arena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.getArena()) {}
+
+    inline T* allocate(size_t count) {
+        return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+    }
+    inline void deallocate(T*, size_t) {}
+
+    inline FrameArena* getArena() const { return arena; }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.getArena(); }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.getArena(); }
+
+private:
+    FrameArena* arena;
+};
+
+// containers living in a frame arena
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+using ArenaUnorderedMap = std::unordered_map<Key, Value, Hash, std::equal_to<Key>,
+                                             ArenaAllocator<std::pair<const Key, Value>>>;
+
+#endif//FRAME_ARENA_HPP
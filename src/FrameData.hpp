@@ -3,6 +3,7 @@
 
 #include "Common.hpp"
 #include "AllocatedBuffer.hpp"
+#include "FrameArena.hpp"
 
 struct FrameData{
     // synchronization per frame
@@ -16,6 +17,17 @@ struct FrameData{
     // camera data (uniform data) per frame
     AllocatedBuffer uniformBuffer;
     VkDescriptorSet globalDescriptorSet;
+
+    // vertex streams surface kernels write to, rewritten when geometry buffer grows
+    VkDescriptorSet surfaceDescriptorSet;
+    VkBuffer surfacePositionBuffer = VK_NULL_HANDLE;
+    VkBuffer surfaceAttributeBuffer = VK_NULL_HANDLE;
+
+    // terrain nodes drawn in this frame, instance data of terrain patches
+    AllocatedBuffer terrainNodeBuffer = {};
+
+    // transient cpu data of frame, reset once render fence of frame signals
+    FrameArena arena;
 };
 
 #endif//FRAME_DATA_HPP
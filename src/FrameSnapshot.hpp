@@ -0,0 +1,58 @@
+#ifndef FRAME_SNAPSHOT_HPP
+#define FRAME_SNAPSHOT_HPP
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "UniformData.hpp"
+#include "Frustum.hpp"
+#include "Mesh.hpp"
+#include "Material.hpp"
+
+// state of one render object needed to draw it
+struct ObjectSnapshot {
+    glm::mat4 modelMatrix;
+    glm::mat3x4 normalMatrix;
+    glm::vec4 color;
+    MeshHandle mesh;
+    MaterialHandle material;
+    // index of object in renderObjects, identifies object across snapshots
+    uint32_t object;
+};
+
+/**
+ * @brief Everything renderer needs to draw one frame of scene.
+ * Captured by simulation thread with Renderer::captureSnapshot() and drawn
+ * by render thread with Renderer::draw(), so render thread never reads
+ * objects or camera while simulation changes them. Snapshot isn't changed
+ * once it's handed over.
+ * */
+struct FrameSnapshot {
+    // number of simulation step snapshot was captured in
+    uint64_t frame = 0;
+    // simulation time in seconds
+    float time = 0.f;
+
+    // camera matrices, view position and lights, copied to uniform buffer as is
+    UniformData uniformData;
+    // camera frustum, in world space
+    Frustum frustum;
+    // vertical field of view of camera in degrees and distance of its near plane
+    float fieldOfView = 70.f;
+    float nearPlane = 0.1f;
+
+    // every render object, in order of renderObjects
+    std::vector<ObjectSnapshot> objects;
+
+    /// same as Camera::getProjectedSize() for camera of snapshot
+    inline float getProjectedSize(float worldSize, float distance, float viewportHeight) const {
+        distance = std::max(distance, nearPlane);
+        float frustumHeight = 2.f * distance * std::tan(glm::radians(fieldOfView) / 2.f);
+        return worldSize * viewportHeight / frustumHeight;
+    }
+};
+
+#endif//FRAME_SNAPSHOT_HPP
@@ -0,0 +1,41 @@
+#include "Frustum.hpp"
+
+// planes are sums and differences of rows of clip matrix (Gribb and Hartmann)
+Frustum Frustum::fromMatrix(const glm::mat4& m){
+    // glm matrices are column major, m[column][row]
+    auto row = [&](int r){ return glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]); };
+    glm::vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+    Frustum frustum;
+    frustum.planes[0] = r3 + r0; // left
+    frustum.planes[1] = r3 - r0; // right
+    frustum.planes[2] = r3 + r1; // bottom
+    frustum.planes[3] = r3 - r1; // top
+    frustum.planes[4] = r2;      // near, vulkan clips depth below 0
+    frustum.planes[5] = r3 - r2; // far
+
+    // normalize so sphere tests can compare against radius
+    for(glm::vec4& plane : frustum.planes){
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    return frustum;
+}
+
+bool Frustum::intersectsBox(const glm::vec3& min, const glm::vec3& max) const{
+    for(const glm::vec4& plane : planes){
+        // corner of box farthest along plane normal
+        glm::vec3 corner(plane.x >= 0.f ? max.x : min.x,
+                         plane.y >= 0.f ? max.y : min.y,
+                         plane.z >= 0.f ? max.z : min.z);
+        if(glm::dot(glm::vec3(plane), corner) + plane.w < 0.f) return false;
+    }
+    return true;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const{
+    for(const glm::vec4& plane : planes){
+        if(glm::dot(glm::vec3(plane), center) + plane.w < -radius) return false;
+    }
+    return true;
+}
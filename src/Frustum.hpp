@@ -0,0 +1,43 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <array>
+#include <glm/glm.hpp>
+
+// view frustum as six planes facing inwards
+// xyz of a plane is its normal and w its distance, points inside have dot(xyz, p) + w >= 0
+struct Frustum {
+    // left, right, bottom, top, near and far planes
+    std::array<glm::vec4, 6> planes;
+
+    /**
+     * @brief Extract frustum planes from a view projection matrix.
+     * Near plane is put where vulkan clips, at clip space depth 0.
+     *
+     * @param viewProjection Projection matrix multiplied by view matrix.
+     * @return Frustum in world space.
+     * */
+    static Frustum fromMatrix(const glm::mat4& viewProjection);
+
+    /**
+     * @brief Check if an axis aligned box is at least partially inside frustum.
+     * Conservative, boxes near frustum corners may be reported inside.
+     *
+     * @param min Minimum corner of box.
+     * @param max Maximum corner of box.
+     * @return false if box is completely outside.
+     * */
+    bool intersectsBox(const glm::vec3& min, const glm::vec3& max) const;
+
+    /**
+     * @brief Check if a sphere is at least partially inside frustum.
+     * Conservative, spheres near frustum corners may be reported inside.
+     *
+     * @param center Center of sphere.
+     * @param radius Radius of sphere.
+     * @return false if sphere is completely outside.
+     * */
+    bool intersectsSphere(const glm::vec3& center, float radius) const;
+};
+
+#endif//FRUSTUM_HPP
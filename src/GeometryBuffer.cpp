@@ -0,0 +1,203 @@
+#include "GeometryBuffer.hpp"
+#include "Vertex.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// usage of vertex stream buffers, transfer src is needed to copy them on growth
+// and storage lets compute kernels generate vertices in place
+constexpr VkBufferUsageFlags vertexBufferUsage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                 VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+// usage of index buffer
+constexpr VkBufferUsageFlags indexBufferUsage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                                                VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                                VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+} // namespace
+
+void GeometryBuffer::init(VkDevice device, VmaAllocator allocator, MemoryBudget* budget, CopyFunction copy){
+    this->device = device;
+    this->allocator = allocator;
+    this->budget = budget;
+    this->copy = copy;
+}
+
+void GeometryBuffer::destroy(){
+    for(VertexStreams& streams : vertexStreams){
+        if(streams.positions.buffer != VK_NULL_HANDLE){
+            destroyBuffer(streams.positions);
+            destroyBuffer(streams.attributes);
+        }
+        streams = VertexStreams();
+    }
+
+    if(indexBuffer.buffer != VK_NULL_HANDLE){
+        destroyBuffer(indexBuffer);
+    }
+    indexBuffer = {};
+    indexAllocator = RangeAllocator();
+}
+
+uint32_t GeometryBuffer::allocateVertices(VertexFormat format, uint32_t count){
+    VertexStreams& streams = vertexStreams[static_cast<size_t>(format)];
+
+    size_t offset = streams.allocator.allocate(count);
+    if(offset == RangeAllocator::invalidOffset){
+        // new space is appended after old, so it fits even if old space is fragmented
+        growVertexStreams(format, streams.allocator.getCapacity() + count);
+        offset = streams.allocator.allocate(count);
+    }
+
+    return static_cast<uint32_t>(offset);
+}
+
+void GeometryBuffer::freeVertices(VertexFormat format, uint32_t vertexOffset){
+    vertexStreams[static_cast<size_t>(format)].allocator.free(vertexOffset);
+}
+
+uint32_t GeometryBuffer::allocateIndices(VkIndexType type, uint32_t count){
+    size_t indexSize = getIndexSize(type);
+    size_t size = count * indexSize;
+
+    // both index types live in same buffer, aligning to index size keeps
+    // every range addressable with firstIndex of its own type
+    size_t offset = indexAllocator.allocate(size, indexSize);
+    if(offset == RangeAllocator::invalidOffset){
+        // new space is appended after old, so it fits even if old space is fragmented
+        growIndexBuffer(indexAllocator.getCapacity() + size + indexSize);
+        offset = indexAllocator.allocate(size, indexSize);
+    }
+
+    return static_cast<uint32_t>(offset / indexSize);
+}
+
+void GeometryBuffer::freeIndices(VkIndexType type, uint32_t firstIndex){
+    indexAllocator.free(firstIndex * getIndexSize(type));
+}
+
+uint32_t GeometryBuffer::moveVertices(VkCommandBuffer cmd, VertexFormat format, uint32_t vertexOffset){
+    VertexStreams& streams = vertexStreams[static_cast<size_t>(format)];
+    size_t count = streams.allocator.getAllocationSize(vertexOffset);
+
+    // new range has to end before old one, so copy never overlaps and data only moves down
+    size_t offset = streams.allocator.allocate(count, 1, vertexOffset);
+    if(offset == RangeAllocator::invalidOffset) return invalidOffset;
+
+    size_t positionStride = getPositionStride(format);
+    VkBufferCopy positionRegion = {};
+    positionRegion.srcOffset = vertexOffset * positionStride;
+    positionRegion.dstOffset = offset * positionStride;
+    positionRegion.size = count * positionStride;
+    vkCmdCopyBuffer(cmd, streams.positions.buffer, streams.positions.buffer, 1, &positionRegion);
+
+    size_t attributeStride = getAttributeStride(format);
+    VkBufferCopy attributeRegion = {};
+    attributeRegion.srcOffset = vertexOffset * attributeStride;
+    attributeRegion.dstOffset = offset * attributeStride;
+    attributeRegion.size = count * attributeStride;
+    vkCmdCopyBuffer(cmd, streams.attributes.buffer, streams.attributes.buffer, 1, &attributeRegion);
+
+    return static_cast<uint32_t>(offset);
+}
+
+uint32_t GeometryBuffer::moveIndices(VkCommandBuffer cmd, VkIndexType type, uint32_t firstIndex){
+    size_t indexSize = getIndexSize(type);
+    size_t oldOffset = firstIndex * indexSize;
+    size_t size = indexAllocator.getAllocationSize(oldOffset);
+
+    size_t offset = indexAllocator.allocate(size, indexSize, oldOffset);
+    if(offset == RangeAllocator::invalidOffset) return invalidOffset;
+
+    VkBufferCopy region = {};
+    region.srcOffset = oldOffset;
+    region.dstOffset = offset;
+    region.size = size;
+    vkCmdCopyBuffer(cmd, indexBuffer.buffer, indexBuffer.buffer, 1, &region);
+
+    return static_cast<uint32_t>(offset / indexSize);
+}
+
+float GeometryBuffer::getVertexFragmentation(VertexFormat format) const{
+    return getFragmentation(vertexStreams[static_cast<size_t>(format)].allocator);
+}
+
+float GeometryBuffer::getIndexFragmentation() const{
+    return getFragmentation(indexAllocator);
+}
+
+float GeometryBuffer::getFragmentation(const RangeAllocator& allocator){
+    size_t freeSize = allocator.getCapacity() - allocator.getUsedSize();
+    if(freeSize == 0) return 0.f;
+    return 1.f - allocator.getLargestFreeRange() / float(freeSize);
+}
+
+AllocatedBuffer GeometryBuffer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage){
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = STYPE(BUFFER_CREATE_INFO);
+    bufferInfo.pNext = nullptr;
+    bufferInfo.flags = 0;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+    AllocatedBuffer allocatedBuffer;
+    VKCHECK(vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &allocatedBuffer.buffer, &allocatedBuffer.allocation, nullptr));
+    if(budget) budget->track(MemoryCategory::Mesh, allocatedBuffer.allocation);
+    return allocatedBuffer;
+}
+
+void GeometryBuffer::destroyBuffer(AllocatedBuffer& buffer){
+    if(budget) budget->untrack(MemoryCategory::Mesh, buffer.allocation);
+    vmaDestroyBuffer(allocator, buffer.buffer, buffer.allocation);
+    buffer = {};
+}
+
+void GeometryBuffer::growBuffer(AllocatedBuffer& buffer, VkDeviceSize oldSize, VkDeviceSize newSize, VkBufferUsageFlags usage){
+    AllocatedBuffer newBuffer = createBuffer(newSize, usage);
+
+    if(buffer.buffer != VK_NULL_HANDLE){
+        copy(buffer.buffer, newBuffer.buffer, oldSize);
+        destroyBuffer(buffer);
+    }
+
+    buffer = newBuffer;
+}
+
+void GeometryBuffer::growVertexStreams(VertexFormat format, size_t minCapacity){
+    VertexStreams& streams = vertexStreams[static_cast<size_t>(format)];
+
+    size_t oldCapacity = streams.allocator.getCapacity();
+    size_t newCapacity = std::max(oldCapacity * 2, initialVertexCapacity);
+    while(newCapacity < minCapacity) newCapacity *= 2;
+
+    // old buffers may still be in use by frames in flight
+    if(oldCapacity > 0) vkDeviceWaitIdle(device);
+
+    growBuffer(streams.positions, oldCapacity * getPositionStride(format),
+               newCapacity * getPositionStride(format), vertexBufferUsage);
+    growBuffer(streams.attributes, oldCapacity * getAttributeStride(format),
+               newCapacity * getAttributeStride(format), vertexBufferUsage);
+    streams.allocator.grow(newCapacity);
+
+    std::cout << "[INFO] Geometry buffer vertex streams grown to " << newCapacity << " vertices" << std::endl;
+}
+
+void GeometryBuffer::growIndexBuffer(size_t minCapacity){
+    size_t oldCapacity = indexAllocator.getCapacity();
+    size_t newCapacity = std::max(oldCapacity * 2, initialIndexCapacity);
+    while(newCapacity < minCapacity) newCapacity *= 2;
+
+    // old buffer may still be in use by frames in flight
+    if(oldCapacity > 0) vkDeviceWaitIdle(device);
+
+    growBuffer(indexBuffer, oldCapacity, newCapacity, indexBufferUsage);
+    indexAllocator.grow(newCapacity);
+
+    std::cout << "[INFO] Geometry buffer index buffer grown to " << newCapacity << " bytes" << std::endl;
+}
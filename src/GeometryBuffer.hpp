@@ -0,0 +1,164 @@
+#ifndef GEOMETRY_BUFFER_HPP
+#define GEOMETRY_BUFFER_HPP
+
+#include <array>
+#include <functional>
+
+#include "AllocatedBuffer.hpp"
+#include "RangeAllocator.hpp"
+#include "VertexFormat.hpp"
+#include "MemoryBudget.hpp"
+
+/**
+ * @brief Vertex and index buffers shared by all meshes.
+ * Every mesh is a range suballocated from these buffers, so a whole
+ * frame is drawn with a single set of buffer bindings per vertex format
+ * and meshes are selected with firstIndex and vertexOffset of draws.
+ * Buffers grow by reallocation and copy when they run out of space.
+ * Ranges can be moved towards start of buffers with moveVertices() and
+ * moveIndices(), so free space fragmented by freed meshes merges again.
+ * */
+class GeometryBuffer {
+public:
+    /// offset returned when a range can't be moved
+    static constexpr uint32_t invalidOffset = UINT32_MAX;
+
+    // copies size bytes from start of src to start of dst on gpu, blocking
+    using CopyFunction = std::function<void(VkBuffer src, VkBuffer dst, VkDeviceSize size)>;
+
+    /**
+     * @brief Initialize geometry buffer. Buffers are created on first allocation.
+     *
+     * @param device Device buffers are used on.
+     * @param allocator Allocator to create buffers from.
+     * @param budget Budget buffers are counted towards as mesh memory, can be null.
+     * @param copy Function used to move contents of buffers when they grow.
+     * */
+    void init(VkDevice device, VmaAllocator allocator, MemoryBudget* budget, CopyFunction copy);
+
+    /**
+     * @brief Destroy all buffers.
+     * */
+    void destroy();
+
+    /**
+     * @brief Allocate vertices in both streams of given format.
+     *
+     * @param format Vertex format of allocated vertices.
+     * @param count Number of vertices.
+     * @return uint32_t Offset of first vertex in streams, in vertices.
+     * */
+    uint32_t allocateVertices(VertexFormat format, uint32_t count);
+
+    /**
+     * @brief Free vertices allocated with allocateVertices().
+     * Vertices must not be in use by gpu anymore.
+     *
+     * @param format Vertex format of allocated vertices.
+     * @param vertexOffset Offset returned by allocateVertices().
+     * */
+    void freeVertices(VertexFormat format, uint32_t vertexOffset);
+
+    /**
+     * @brief Allocate indices of given type in index buffer.
+     *
+     * @param type Type of indices.
+     * @param count Number of indices.
+     * @return uint32_t First index of allocated range, in units of index type.
+     * */
+    uint32_t allocateIndices(VkIndexType type, uint32_t count);
+
+    /**
+     * @brief Free indices allocated with allocateIndices().
+     * Indices must not be in use by gpu anymore.
+     *
+     * @param type Type of indices.
+     * @param firstIndex Index returned by allocateIndices().
+     * */
+    void freeIndices(VkIndexType type, uint32_t firstIndex);
+
+    /**
+     * @brief Copy vertices to a free range closer to start of streams.
+     * Old range stays allocated since frames in flight may still draw from it,
+     * it has to be freed with freeVertices() once they are done.
+     *
+     * @param cmd Command buffer copy is recorded into, its writes need a barrier before use.
+     * @param format Vertex format of vertices.
+     * @param vertexOffset Offset returned by allocateVertices().
+     * @return uint32_t New offset of vertices, or invalidOffset if no free range before them fits.
+     * */
+    uint32_t moveVertices(VkCommandBuffer cmd, VertexFormat format, uint32_t vertexOffset);
+
+    /**
+     * @brief Copy indices to a free range closer to start of index buffer.
+     * Old range stays allocated like with moveVertices().
+     *
+     * @param cmd Command buffer copy is recorded into, its writes need a barrier before use.
+     * @param type Type of indices.
+     * @param firstIndex Index returned by allocateIndices().
+     * @return uint32_t New first index, or invalidOffset if no free range before them fits.
+     * */
+    uint32_t moveIndices(VkCommandBuffer cmd, VkIndexType type, uint32_t firstIndex);
+
+    /// part of free vertex space of a format not in its largest free range, 0 when free space is contiguous
+    float getVertexFragmentation(VertexFormat format) const;
+    /// part of free index space not in its largest free range
+    float getIndexFragmentation() const;
+
+    /// position stream buffer of given format, null if nothing was allocated yet
+    inline VkBuffer getPositionBuffer(VertexFormat format) const {
+        return vertexStreams[static_cast<size_t>(format)].positions.buffer;
+    }
+
+    /// attribute stream buffer of given format, null if nothing was allocated yet
+    inline VkBuffer getAttributeBuffer(VertexFormat format) const {
+        return vertexStreams[static_cast<size_t>(format)].attributes.buffer;
+    }
+
+    /// index buffer holding both 16 and 32 bit indices, null if nothing was allocated yet
+    inline VkBuffer getIndexBuffer() const { return indexBuffer.buffer; }
+
+    /// size of an index of given type in bytes
+    static inline size_t getIndexSize(VkIndexType type) {
+        return type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+private:
+    // both streams of a vertex format share one allocator counting vertices
+    struct VertexStreams {
+        AllocatedBuffer positions = {};
+        AllocatedBuffer attributes = {};
+        RangeAllocator allocator;
+    };
+
+    // part of free space of allocator outside of its largest free range
+    static float getFragmentation(const RangeAllocator& allocator);
+
+    // create buffer of given size and usage in gpu memory
+    AllocatedBuffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage);
+    // destroy buffer made by createBuffer()
+    void destroyBuffer(AllocatedBuffer& buffer);
+    // replace buffer with a bigger one, keeping old contents
+    void growBuffer(AllocatedBuffer& buffer, VkDeviceSize oldSize, VkDeviceSize newSize, VkBufferUsageFlags usage);
+    // grow vertex streams of a format to hold atleast given number of vertices
+    void growVertexStreams(VertexFormat format, size_t minCapacity);
+    // grow index buffer to hold atleast given number of bytes
+    void growIndexBuffer(size_t minCapacity);
+
+    VkDevice device = VK_NULL_HANDLE;
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    MemoryBudget* budget = nullptr;
+    CopyFunction copy;
+
+    // vertex streams of every vertex format
+    std::array<VertexStreams, VertexFormatCount> vertexStreams;
+
+    // index buffer, allocator counts bytes
+    AllocatedBuffer indexBuffer = {};
+    RangeAllocator indexAllocator;
+
+    // starting sizes, buffers double in size when full
+    static constexpr size_t initialVertexCapacity = 1 << 16;
+    static constexpr size_t initialIndexCapacity = 1 << 20;
+};
+
+#endif//GEOMETRY_BUFFER_HPP
@@ -0,0 +1,61 @@
+#ifndef GPU_SURFACE_HPP
+#define GPU_SURFACE_HPP
+
+#include <glm/glm.hpp>
+
+#include "Common.hpp"
+#include "Mesh.hpp"
+
+// parameters of a surface kernel, pushed as constants with every update
+// layout matches SurfaceParameters block of shaders/surface_common.glsl
+struct SurfaceParameters {
+    // parameter range spanned by grid, x and y of height functions or u and v of parametric ones
+    glm::vec2 rangeMin = glm::vec2(-1.f);
+    glm::vec2 rangeMax = glm::vec2(1.f);
+    // color of all vertices, w is unused
+    glm::vec4 color = glm::vec4(0.25f, 0.25f, 0.25f, 1.f);
+    // number of grid points in u and v, fixed at creation
+    uint32_t resolutionX = 0;
+    uint32_t resolutionY = 0;
+    // animation time, kernels are free to interpret it
+    float time = 0.f;
+    // first vertex of surface in geometry buffer, set by renderer
+    uint32_t vertexOffset = 0;
+};
+
+// A grid surface whose vertices are generated on gpu by a compute kernel.
+// Index grid is uploaded once at creation, updates only push parameters.
+struct GpuSurface {
+    // mesh drawn by render objects, its vertices are owned by the kernel
+    MeshHandle mesh;
+    // compute pipeline of kernel
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    // parameters of next update
+    SurfaceParameters parameters;
+    // vertices are regenerated on next draw if set, reset after update is recorded
+    bool dirty = true;
+
+    /**
+     * @brief Set animation time and request an update.
+     *
+     * @param time Time passed to kernel.
+     * */
+    inline void setTime(float time) { parameters.time = time; dirty = true; }
+
+    /**
+     * @brief Set parameter range spanned by grid and request an update.
+     *
+     * @param rangeMin Parameters of first grid point.
+     * @param rangeMax Parameters of last grid point.
+     * */
+    inline void setRange(const glm::vec2& rangeMin, const glm::vec2& rangeMax) {
+        parameters.rangeMin = rangeMin;
+        parameters.rangeMax = rangeMax;
+        dirty = true;
+    }
+};
+
+/// reference to a gpu surface created by a renderer
+using GpuSurfaceHandle = Handle<GpuSurface>;
+
+#endif//GPU_SURFACE_HPP
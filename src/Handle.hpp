@@ -0,0 +1,46 @@
+#ifndef HANDLE_HPP
+#define HANDLE_HPP
+
+#include <cstdint>
+#include <functional>
+
+/**
+ * @brief 32 bit reference to an element of a Pool<T>.
+ * Low bits are index of a slot in pool, high bits are generation of that slot.
+ * Every time a slot is freed its generation changes, so handles of destroyed
+ * elements are detected in O(1) instead of pointing at whatever reuses the slot.
+ * Default constructed handle is null and never valid.
+ * */
+template<typename T>
+struct Handle {
+    static constexpr uint32_t indexBits = 20;
+    static constexpr uint32_t indexMask = (1u << indexBits) - 1;
+    /// maximum number of slots a pool can have
+    static constexpr uint32_t maxSlots = indexMask + 1;
+    /// generations wrap around after this value, 0 is reserved for null handles
+    static constexpr uint32_t maxGeneration = (1u << (32 - indexBits)) - 1;
+
+    uint32_t value = 0;
+
+    static constexpr Handle make(uint32_t index, uint32_t generation) {
+        return Handle{(generation << indexBits) | (index & indexMask)};
+    }
+
+    constexpr uint32_t getIndex() const { return value & indexMask; }
+    constexpr uint32_t getGeneration() const { return value >> indexBits; }
+
+    constexpr bool isNull() const { return value == 0; }
+    constexpr explicit operator bool() const { return value != 0; }
+
+    constexpr bool operator==(const Handle& other) const { return value == other.value; }
+    constexpr bool operator!=(const Handle& other) const { return value != other.value; }
+};
+
+namespace std {
+    template<typename T>
+    struct hash<Handle<T>> {
+        size_t operator()(const Handle<T>& handle) const { return std::hash<uint32_t>()(handle.value); }
+    };
+}
+
+#endif//HANDLE_HPP
@@ -0,0 +1,262 @@
+#include "JobSystem.hpp"
+
+#include <iostream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+    // jobs are allocated from a ring per thread, so allocating one is a thread local increment
+    struct JobRing {
+        std::unique_ptr<Job[]> jobs{new Job[JobSystem::maxJobsPerThread]};
+        size_t next = 0;
+    };
+    static_assert((JobSystem::maxJobsPerThread & (JobSystem::maxJobsPerThread - 1)) == 0, "ring size has to be a power of two");
+    thread_local JobRing jobRing;
+
+    // system and index of worker running on this thread, null for other threads
+    thread_local JobSystem* currentSystem = nullptr;
+    thread_local uint32_t currentWorker = 0;
+    // where thread starts looking for jobs to steal
+    thread_local uint32_t stealStart = 0;
+}
+
+bool WorkStealingQueue::push(Job* job){
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if(b - t >= capacity) return false;
+
+    jobs[b & mask].store(job, std::memory_order_relaxed);
+    // job has to be visible before thieves see new bottom
+    bottom.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+Job* WorkStealingQueue::pop(){
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    // thieves have to see reserved bottom before top is read
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+
+    if(t > b){
+        // deque was empty
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = jobs[b & mask].load(std::memory_order_relaxed);
+    if(t == b){
+        // last job, thieves may be taking it too
+        if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)){
+            job = nullptr;
+        }
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job* WorkStealingQueue::steal(){
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if(t >= b) return nullptr;
+
+    Job* job = jobs[t & mask].load(std::memory_order_relaxed);
+    // lost race against owner or another thief
+    if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)){
+        return nullptr;
+    }
+    return job;
+}
+
+JobSystem::~JobSystem(){
+    destroy();
+}
+
+void JobSystem::init(uint32_t workerCount, bool pinWorkers){
+    destroy();
+
+    if(workerCount == 0){
+        workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    }
+#ifndef __linux__
+    if(pinWorkers){
+        std::cerr << "[WARNING] Pinning job system workers isn't supported on this platform" << std::endl;
+        pinWorkers = false;
+    }
+#endif
+
+    // all deques have to exist before any worker starts stealing
+    workers.reserve(workerCount);
+    for(uint32_t i = 0; i < workerCount; i++){
+        workers.push_back(std::make_unique<Worker>());
+    }
+    running = true;
+    for(uint32_t i = 0; i < workerCount; i++){
+        workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i, pinWorkers);
+    }
+}
+
+void JobSystem::destroy(){
+    if(workers.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        running = false;
+    }
+    wakeUp.notify_all();
+    for(auto& worker : workers){
+        worker->thread.join();
+    }
+    workers.clear();
+}
+
+void JobSystem::wait(JobCounter& counter){
+    while(!counter.isDone()){
+        Job* job = findJob();
+        if(job){
+            execute(job);
+        }else{
+            // remaining jobs are running on other threads
+            std::this_thread::yield();
+        }
+    }
+    // last job may still be releasing lock of counter
+    std::lock_guard<std::mutex> lock(counter.continuationMutex);
+}
+
+Job* JobSystem::allocateJob(){
+    Job* job = &jobRing.jobs[jobRing.next];
+    jobRing.next = (jobRing.next + 1) & (maxJobsPerThread - 1);
+    return job;
+}
+
+void JobSystem::submit(Job* job){
+    // counted before it's queued, so takers never decrement below zero
+    // sleeping workers check queuedJobs after announcing they sleep,
+    // so either they see this job or this sees them sleeping
+    queuedJobs.fetch_add(1, std::memory_order_seq_cst);
+    if(currentSystem == this){
+        if(!workers[currentWorker]->queue.push(job)){
+            // deque is full, caller runs job itself
+            queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            execute(job);
+            return;
+        }
+    }else{
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        sharedQueue.push_back(job);
+        sharedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if(sleeping.load(std::memory_order_seq_cst) > 0){
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wakeUp.notify_one();
+    }
+}
+
+void JobSystem::execute(Job* job){
+    JobCounter* counter = job->counter;
+    job->function(*job);
+    if(!counter) return;
+
+    // every job but last simply decrements counter, last one marks it as
+    // finishing, so waiters keep waiting until continuations are taken
+    uint32_t count = counter->count.load(std::memory_order_relaxed);
+    while(!counter->count.compare_exchange_weak(count, count == 2 ? 1 : count - 2, std::memory_order_acq_rel, std::memory_order_relaxed));
+    if(count != 2) return;
+
+    std::vector<Job*> ready;
+    {
+        std::lock_guard<std::mutex> lock(counter->continuationMutex);
+        ready.swap(counter->continuations);
+        counter->count.store(0, std::memory_order_release);
+    }
+    for(Job* continuation : ready){
+        submit(continuation);
+    }
+}
+
+Job* JobSystem::findJob(){
+    Job* job = nullptr;
+    bool isWorker = currentSystem == this;
+    if(isWorker) job = workers[currentWorker]->queue.pop();
+
+    if(!job && sharedCount.load(std::memory_order_relaxed) > 0){
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        if(!sharedQueue.empty()){
+            job = sharedQueue.front();
+            sharedQueue.pop_front();
+            sharedCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // steal from other workers, starting where last steal succeeded
+    uint32_t workerCount = getWorkerCount();
+    for(uint32_t i = 0; !job && i < workerCount; i++){
+        uint32_t victim = (stealStart + i) % workerCount;
+        if(isWorker && victim == currentWorker) continue;
+        job = workers[victim]->queue.steal();
+        if(job) stealStart = victim;
+    }
+
+    if(job) queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    return job;
+}
+
+void JobSystem::workerLoop(uint32_t index, bool pin){
+    currentSystem = this;
+    currentWorker = index;
+    stealStart = index + 1;
+
+#ifdef __linux__
+    if(pin){
+        // leave first core to thread that started system
+        uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET((index + 1) % cores, &cpus);
+        if(pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0){
+            std::cerr << "[WARNING] Failed to pin job system worker " << index << " to a core" << std::endl;
+        }
+    }
+#endif
+
+    // spin a while before sleeping, jobs often come in bursts
+    constexpr uint32_t spinCount = 64;
+    uint32_t idle = 0;
+    while(running.load(std::memory_order_relaxed)){
+        Job* job = findJob();
+        if(job){
+            execute(job);
+            idle = 0;
+            continue;
+        }
+        if(++idle < spinCount){
+            std::this_thread::yield();
+            continue;
+        }
+
+        sleeping.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeUp.wait(lock, [this](){
+                return queuedJobs.load(std::memory_order_seq_cst) > 0 || !running.load(std::memory_order_relaxed);
+            });
+        }
+        sleeping.fetch_sub(1, std::memory_order_relaxed);
+        idle = 0;
+    }
+
+    currentSystem = nullptr;
+}
+
+JobSystem& getJobSystem(){
+    static JobSystem jobSystem;
+    // magic static makes sure only first caller starts it
+    static bool started = (jobSystem.init(), true);
+    (void)started;
+    return jobSystem;
+}
@@ -0,0 +1,249 @@
+#ifndef JOB_SYSTEM_HPP
+#define JOB_SYSTEM_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <condition_variable>
+
+struct Job;
+
+/**
+ * @brief Counts unfinished jobs.
+ * Every job started with a counter increments it and decrements it once
+ * done, so counter reaching zero means all of them are complete. Jobs
+ * started with runAfter() wait for a counter to reach zero before they're
+ * queued, which is how dependencies between jobs are expressed.
+ * A counter has to outlive all jobs using it.
+ * */
+class JobCounter {
+public:
+    inline bool isDone() const { return count.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+    // twice number of unfinished jobs, odd while last job is queueing
+    // continuations, so waiters don't see zero before counter isn't touched anymore
+    std::atomic<uint32_t> count{0};
+    // jobs waiting for counter to reach zero
+    std::mutex continuationMutex;
+    std::vector<Job*> continuations;
+};
+
+// a queued function, function and its captures are stored in place
+struct alignas(64) Job {
+    static constexpr size_t dataSize = 48;
+
+    void (*function)(Job& job) = nullptr;
+    JobCounter* counter = nullptr;
+    alignas(std::max_align_t) unsigned char data[dataSize];
+};
+
+/**
+ * @brief Chase-Lev work stealing deque of jobs.
+ * Owning thread pushes and pops at bottom without locking, other threads
+ * steal from top, so they take oldest jobs which are usually the largest.
+ * Capacity is fixed, push() fails when deque is full.
+ * */
+class WorkStealingQueue {
+public:
+    static constexpr int64_t capacity = 4096;
+
+    /// add a job, called by owner only
+    bool push(Job* job);
+    /// take newest job, called by owner only
+    Job* pop();
+    /// take oldest job, called by any thread
+    Job* steal();
+
+    inline bool empty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr int64_t mask = capacity - 1;
+    static_assert((capacity & mask) == 0, "capacity has to be a power of two");
+
+    // thieves and owner update different ends, keep them on separate cache lines
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    std::atomic<Job*> jobs[capacity];
+};
+
+/**
+ * @brief Work stealing scheduler all parallel work of engine runs on.
+ * Each worker thread owns a deque, jobs spawned by a worker go to its own
+ * deque and idle workers steal from others, so nested parallelism stays
+ * local and load balances itself. Jobs spawned by threads outside of the
+ * system go to a shared queue. Waiting on a counter runs other jobs in the
+ * meantime instead of blocking, so jobs can wait on jobs they spawned.
+ *
+ * Jobs are allocated from a ring per thread, a thread can't have more than
+ * maxJobsPerThread jobs unfinished at once and has to wait for its jobs
+ * before it exits.
+ * */
+class JobSystem {
+public:
+    static constexpr size_t maxJobsPerThread = 4096;
+
+    JobSystem() = default;
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+    ~JobSystem();
+
+    /**
+     * @brief Start worker threads, restarts them if already running.
+     * Not needed before using getJobSystem(), it starts with defaults on first use.
+     *
+     * @param workerCount Number of workers, 0 to use one less than host cores
+     * since calling thread helps when it waits.
+     * @param pinWorkers Pin each worker to its own core, so OS doesn't move
+     * them and their caches stay warm. Only supported on Linux.
+     * */
+    void init(uint32_t workerCount = 0, bool pinWorkers = false);
+
+    /**
+     * @brief Stop worker threads. Has to be called when no jobs are pending.
+     * Without workers, queued jobs are run only by threads waiting on them.
+     * */
+    void destroy();
+
+    /**
+     * @brief Queue a job.
+     *
+     * @param counter Counter to increment until job is done, can be null.
+     * @param func Function to run, its captures have to fit Job::dataSize.
+     * */
+    template<typename Func>
+    void run(JobCounter* counter, Func&& func) {
+        submit(createJob(counter, std::forward<Func>(func)));
+    }
+
+    /**
+     * @brief Queue a job once all jobs counted by dependency are done.
+     * Job counts towards counter immediately, so waiting on counter waits for it
+     * even before it's queued. Jobs must not be added to dependency meanwhile.
+     *
+     * @param dependency Counter to wait for.
+     * @param counter Counter to increment until job is done, can be null.
+     * @param func Function to run, its captures have to fit Job::dataSize.
+     * */
+    template<typename Func>
+    void runAfter(JobCounter& dependency, JobCounter* counter, Func&& func) {
+        Job* job = createJob(counter, std::forward<Func>(func));
+        {
+            std::lock_guard<std::mutex> lock(dependency.continuationMutex);
+            if(!dependency.isDone()){
+                dependency.continuations.push_back(job);
+                return;
+            }
+        }
+        submit(job);
+    }
+
+    /**
+     * @brief Return once counter reaches zero, running queued jobs meanwhile.
+     * */
+    void wait(JobCounter& counter);
+
+    /**
+     * @brief Call func(begin, end) for consecutive ranges covering [0, count).
+     * Range is split into batches of grainSize indices, batches are distributed
+     * over workers and stolen as needed. Returns after all calls are complete.
+     *
+     * @param count Number of indices to process.
+     * @param grainSize Number of indices per batch, 0 to pick one from worker count.
+     * @param func Function to call for each batch.
+     * */
+    template<typename Func>
+    void parallelFor(size_t count, size_t grainSize, const Func& func) {
+        if(count == 0) return;
+        if(grainSize == 0) grainSize = std::max<size_t>(1, count / (4 * (getWorkerCount() + 1)));
+        if(count <= grainSize){
+            func(size_t(0), count);
+            return;
+        }
+        JobCounter counter;
+        splitRange(counter, 0, count, grainSize, func);
+        wait(counter);
+    }
+
+    /// number of worker threads, not counting threads waiting on jobs
+    inline uint32_t getWorkerCount() const { return static_cast<uint32_t>(workers.size()); }
+
+private:
+    struct Worker {
+        WorkStealingQueue queue;
+        std::thread thread;
+    };
+
+    template<typename Func>
+    Job* createJob(JobCounter* counter, Func&& func) {
+        using Callable = std::decay_t<Func>;
+        static_assert(sizeof(Callable) <= Job::dataSize, "job captures too much, capture a pointer to a struct instead");
+        static_assert(alignof(Callable) <= alignof(std::max_align_t), "job captures are overaligned");
+
+        Job* job = allocateJob();
+        new (job->data) Callable(std::forward<Func>(func));
+        job->function = [](Job& job){
+            Callable* callable = std::launder(reinterpret_cast<Callable*>(job.data));
+            (*callable)();
+            callable->~Callable();
+        };
+        job->counter = counter;
+        if(counter) counter->count.fetch_add(2, std::memory_order_relaxed);
+        return job;
+    }
+
+    // split range in halves until batches are small enough, each half is a job
+    // so thieves take large halves and owner keeps working on small ones
+    template<typename Func>
+    void splitRange(JobCounter& counter, size_t begin, size_t end, size_t grainSize, const Func& func) {
+        while(end - begin > grainSize){
+            size_t middle = begin + (end - begin) / 2;
+            const Func* f = &func;
+            JobCounter* c = &counter;
+            run(&counter, [this, c, middle, end, grainSize, f](){ splitRange(*c, middle, end, grainSize, *f); });
+            end = middle;
+        }
+        func(begin, end);
+    }
+
+    Job* allocateJob();
+    void submit(Job* job);
+    void execute(Job* job);
+    // take a job from own deque, shared queue or another worker, null if there's none
+    Job* findJob();
+    void workerLoop(uint32_t index, bool pin);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> running{false};
+
+    // jobs from threads that aren't workers
+    std::mutex sharedMutex;
+    std::deque<Job*> sharedQueue;
+    std::atomic<size_t> sharedCount{0};
+
+    // idle workers sleep until jobs are queued
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    std::atomic<uint32_t> sleeping{0};
+    std::atomic<size_t> queuedJobs{0};
+};
+
+/**
+ * @brief Job system shared by whole engine.
+ * Started with default settings on first use, call init() on it to change them.
+ * */
+JobSystem& getJobSystem();
+
+#endif//JOB_SYSTEM_HPP
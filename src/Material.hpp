@@ -1,19 +1,37 @@
 #ifndef MATERIAL_H_
 #define MATERIAL_H_
 
+#include <array>
 #include <vulkan/vulkan.h>
 
+#include "VertexFormat.hpp"
+#include "Handle.hpp"
+
 // Materials are applied to objects to give them good looks
 struct Material {
     // light data
     float roughness = 1.f;
 
     // pipeline decides shaders, region, color blending and all
-    VkPipeline pipeline;
+    // there is one variant for every vertex format since vertex
+    // input state and vertex shader depend on format of mesh
+    std::array<VkPipeline, VertexFormatCount> pipelines = {};
 
     // pipeline layout decides what data must be sent to pipeline
     VkPipelineLayout pipelineLayout;
+
+    /**
+     * @brief Get pipeline variant for drawing meshes of given vertex format.
+     *
+     * @param format Vertex format of mesh.
+     * @return VkPipeline
+     * */
+    inline VkPipeline getPipeline(VertexFormat format) const {
+        return pipelines[static_cast<size_t>(format)];
+    }
 };
 
+/// reference to a material registered in a renderer
+using MaterialHandle = Handle<Material>;
 
 #endif // MATERIAL_H_
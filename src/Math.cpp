@@ -9,3 +9,19 @@ glm::vec3 sphericalToCartesian(float radius, float theta, float phi){
 
     return pos;
 }
+
+SinCosTable::SinCosTable(uint32_t steps, float range){
+    sines.resize(steps + 1);
+    cosines.resize(steps + 1);
+    for(uint32_t i = 0; i <= steps; i++){
+        float angle = range * i / steps;
+        sines[i] = std::sin(angle);
+        cosines[i] = std::cos(angle);
+    }
+
+    // exact values at ends, so closed shapes close without cracks
+    if(std::abs(range - 2.f * float(PI)) < 1e-6f){
+        sines[steps] = sines[0];
+        cosines[steps] = cosines[0];
+    }
+}
@@ -1,6 +1,8 @@
 #ifndef MATH_H_
 #define MATH_H_
 
+#include <vector>
+#include <cstdint>
 #include <glm/glm.hpp>
 
 #define PI 3.14159265359
@@ -15,4 +17,26 @@
  * */
 glm::vec3 sphericalToCartesian(float radius, float theta, float phi);
 
+/**
+ * @brief Sines and cosines of evenly spaced angles, computed once.
+ * Generators index this instead of calling sin and cos for every vertex.
+ * Entry i holds angle i * range / steps, for i in [0, steps], so last
+ * entry of a full turn repeats first one.
+ * */
+struct SinCosTable {
+    std::vector<float> sines;
+    std::vector<float> cosines;
+
+    /**
+     * @brief Tabulate given number of steps over given angle range.
+     *
+     * @param steps Number of steps, table has steps + 1 entries.
+     * @param range Angle covered by all steps, in radians.
+     * */
+    SinCosTable(uint32_t steps, float range);
+
+    /// number of steps, one less than number of entries
+    inline uint32_t getSteps() const { return static_cast<uint32_t>(sines.size()) - 1; }
+};
+
 #endif // MATH_H_
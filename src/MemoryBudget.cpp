@@ -0,0 +1,158 @@
+#include "MemoryBudget.hpp"
+
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+namespace {
+
+// bytes in MB, for messages
+double toMB(VkDeviceSize bytes){
+    return bytes / double(1 << 20);
+}
+
+} // namespace
+
+const char* getMemoryCategoryName(MemoryCategory category){
+    switch(category){
+        case MemoryCategory::Mesh: return "mesh";
+        case MemoryCategory::Staging: return "staging";
+        case MemoryCategory::Uniform: return "uniform";
+        case MemoryCategory::Image: return "image";
+    }
+    return "unknown";
+}
+
+void MemoryBudget::init(VmaAllocator allocator, bool budgetExtension){
+    this->allocator = allocator;
+    this->budgetExtension = budgetExtension;
+
+    const VkPhysicalDeviceMemoryProperties* memoryProperties;
+    vmaGetMemoryProperties(allocator, &memoryProperties);
+    heapCount = memoryProperties->memoryHeapCount;
+    for(uint32_t h = 0; h < heapCount; h++){
+        heaps[h].heap = h;
+        heaps[h].size = memoryProperties->memoryHeaps[h].size;
+        heaps[h].deviceLocal = (memoryProperties->memoryHeaps[h].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+
+    categories = {};
+    overThreshold = {};
+    lastDump = std::chrono::steady_clock::now();
+
+    std::cout << "[INFO] Memory budget " << (budgetExtension ? "reported by driver" : "estimated, VK_EXT_memory_budget unavailable") << std::endl;
+}
+
+void MemoryBudget::track(MemoryCategory category, VmaAllocation allocation){
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(allocator, allocation, &info);
+
+    CategoryUsage& usage = categories[static_cast<size_t>(category)];
+    usage.bytes += info.size;
+    usage.allocations++;
+}
+
+void MemoryBudget::untrack(MemoryCategory category, VmaAllocation allocation){
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(allocator, allocation, &info);
+
+    CategoryUsage& usage = categories[static_cast<size_t>(category)];
+    usage.bytes -= std::min(usage.bytes, info.size);
+    if(usage.allocations > 0) usage.allocations--;
+}
+
+void MemoryBudget::update(uint64_t frame){
+    // new frame index makes VMA fetch budget from driver again
+    vmaSetCurrentFrameIndex(allocator, static_cast<uint32_t>(frame));
+
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetBudget(allocator, budgets);
+
+    for(uint32_t h = 0; h < heapCount; h++){
+        HeapBudget& heap = heaps[h];
+        heap.usage = budgets[h].usage;
+        heap.budget = budgets[h].budget;
+        heap.blockBytes = budgets[h].blockBytes;
+        heap.allocationBytes = budgets[h].allocationBytes;
+
+        // warn once per crossing, heap has to drop a bit below threshold to rearm
+        if(heap.budget == 0) continue;
+        float fraction = heap.usage / float(heap.budget);
+        if(!overThreshold[h] && fraction >= warningThreshold){
+            overThreshold[h] = true;
+            if(onWarning){
+                onWarning(heap);
+            }else{
+                std::cerr << "[WARNING] Memory heap " << h << (heap.deviceLocal ? " (device local)" : "")
+                          << " at " << toMB(heap.usage) << " of " << toMB(heap.budget) << " MB budget" << std::endl;
+            }
+        }else if(overThreshold[h] && fraction < warningThreshold - 0.05f){
+            overThreshold[h] = false;
+        }
+    }
+
+    if(!dumpPath.empty()){
+        auto now = std::chrono::steady_clock::now();
+        if(std::chrono::duration<float>(now - lastDump).count() >= dumpInterval){
+            lastDump = now;
+            if(!writeJson(dumpPath)){
+                std::cerr << "[WARNING] Failed to write memory budget to " << dumpPath << std::endl;
+            }
+        }
+    }
+}
+
+std::string MemoryBudget::toJson() const{
+    // number of allocations and blocks VMA made, walks all of its blocks
+    VmaStats stats;
+    vmaCalculateStats(allocator, &stats);
+
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"budgetExtension\": " << (budgetExtension ? "true" : "false") << ",\n";
+
+    json << "  \"heaps\": [\n";
+    for(uint32_t h = 0; h < heapCount; h++){
+        const HeapBudget& heap = heaps[h];
+        json << "    {\"heap\": " << h
+             << ", \"deviceLocal\": " << (heap.deviceLocal ? "true" : "false")
+             << ", \"size\": " << heap.size
+             << ", \"usage\": " << heap.usage
+             << ", \"budget\": " << heap.budget
+             << ", \"blockBytes\": " << heap.blockBytes
+             << ", \"allocationBytes\": " << heap.allocationBytes
+             << ", \"blocks\": " << stats.memoryHeap[h].blockCount
+             << ", \"allocations\": " << stats.memoryHeap[h].allocationCount << "}"
+             << (h + 1 < heapCount ? ",\n" : "\n");
+    }
+    json << "  ],\n";
+
+    json << "  \"categories\": {\n";
+    for(size_t c = 0; c < MemoryCategoryCount; c++){
+        json << "    \"" << getMemoryCategoryName(static_cast<MemoryCategory>(c)) << "\": {\"bytes\": "
+             << categories[c].bytes << ", \"allocations\": " << categories[c].allocations << "}"
+             << (c + 1 < MemoryCategoryCount ? ",\n" : "\n");
+    }
+    json << "  },\n";
+
+    json << "  \"total\": {\"blocks\": " << stats.total.blockCount
+         << ", \"allocations\": " << stats.total.allocationCount
+         << ", \"usedBytes\": " << stats.total.usedBytes
+         << ", \"unusedBytes\": " << stats.total.unusedBytes << "}\n";
+    json << "}\n";
+    return json.str();
+}
+
+bool MemoryBudget::writeJson(const std::string& path) const{
+    // write whole file under another name first, so readers never see half a dump
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::trunc);
+        if(!file) return false;
+        file << toJson();
+        if(!file) return false;
+    }
+    return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,129 @@
+#ifndef MEMORY_BUDGET_HPP
+#define MEMORY_BUDGET_HPP
+
+#include <array>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+#include "vk_mem_alloc.h"
+
+// what gpu memory is used for
+enum class MemoryCategory : uint8_t {
+    // vertex and index buffers of meshes, terrain and dynamic meshes
+    Mesh,
+    // host visible buffers uploads are copied through
+    Staging,
+    // buffers written by cpu every frame, uniforms and instance data
+    Uniform,
+    // images, depth buffer
+    Image
+};
+constexpr size_t MemoryCategoryCount = 4;
+
+/// name of category as it appears in json dump
+const char* getMemoryCategoryName(MemoryCategory category);
+
+/**
+ * @brief Tracks gpu memory use against budget given by driver.
+ * Usage and budget of every heap come from VK_EXT_memory_budget through VMA
+ * if device supports it, otherwise VMA estimates them from its own
+ * allocations. Allocations are also counted per category, so it's visible
+ * what memory is spent on. Like other renderer resources, it belongs to
+ * thread that draws.
+ * */
+class MemoryBudget {
+public:
+    // usage of one memory heap, in bytes
+    struct HeapBudget {
+        uint32_t heap = 0;
+        VkDeviceSize size = 0;
+        bool deviceLocal = false;
+        // estimated usage by whole process and amount it can use without problems
+        VkDeviceSize usage = 0;
+        VkDeviceSize budget = 0;
+        // memory blocks VMA allocated from heap and bytes used by allocations in them
+        VkDeviceSize blockBytes = 0;
+        VkDeviceSize allocationBytes = 0;
+    };
+
+    // tracked allocations of one category
+    struct CategoryUsage {
+        VkDeviceSize bytes = 0;
+        uint32_t allocations = 0;
+    };
+
+    // called with heap whose usage crossed warning threshold
+    using WarningCallback = std::function<void(const HeapBudget& heap)>;
+
+    /**
+     * @brief Start tracking allocations of given allocator.
+     *
+     * @param allocator Allocator, created with VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT if budgetExtension is set.
+     * @param budgetExtension True if VK_EXT_memory_budget is enabled on device.
+     * */
+    void init(VmaAllocator allocator, bool budgetExtension);
+
+    /// count an allocation towards category, called right after allocating
+    void track(MemoryCategory category, VmaAllocation allocation);
+    /// remove an allocation from category, called before freeing it
+    void untrack(MemoryCategory category, VmaAllocation allocation);
+
+    /**
+     * @brief Refresh budget of all heaps, warn about heaps near budget and dump json if it's time.
+     * Cheap enough to call every frame.
+     *
+     * @param frame Number of frame, passed on to VMA so it refreshes budget from driver.
+     * */
+    void update(uint64_t frame);
+
+    /// budget of every heap as of last update()
+    inline const HeapBudget* getHeaps() const { return heaps.data(); }
+    inline uint32_t getHeapCount() const { return heapCount; }
+
+    inline const CategoryUsage& getCategoryUsage(MemoryCategory category) const {
+        return categories[static_cast<size_t>(category)];
+    }
+
+    /// true if budget comes from driver, false if it's estimated by VMA
+    inline bool hasBudgetExtension() const { return budgetExtension; }
+
+    /**
+     * @brief Describe heaps, categories and allocation counts of VMA as json.
+     * Traverses all allocations of VMA, don't call it every frame.
+     * */
+    std::string toJson() const;
+
+    /**
+     * @brief Write toJson() to a file.
+     *
+     * @return bool false if file couldn't be written.
+     * */
+    bool writeJson(const std::string& path) const;
+
+    /// fraction of heap budget usage can reach before onWarning is called
+    float warningThreshold = 0.9f;
+    /// called once when a heap goes over warning threshold, prints a warning if empty
+    WarningCallback onWarning;
+
+    /// file update() periodically writes json dump to, empty to disable dumps
+    std::string dumpPath;
+    /// seconds between json dumps
+    float dumpInterval = 10.f;
+
+private:
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    bool budgetExtension = false;
+
+    uint32_t heapCount = 0;
+    std::array<HeapBudget, VK_MAX_MEMORY_HEAPS> heaps = {};
+    // heaps over warning threshold, warned again only after they drop below it
+    std::array<bool, VK_MAX_MEMORY_HEAPS> overThreshold = {};
+
+    std::array<CategoryUsage, MemoryCategoryCount> categories = {};
+
+    std::chrono::steady_clock::time_point lastDump;
+};
+
+#endif//MEMORY_BUDGET_HPP
@@ -1,93 +1,240 @@
 #include "Mesh.hpp"
 #include "ReturnCode.hpp"
-#include "tiny_obj_loader.h"
+#include "ObjParser.hpp"
 #include "Math.hpp"
 
+#include <glm/gtx/transform.hpp>
+
 #include <cmath>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
 #include <iostream>
+#include <unordered_map>
 
-ReturnCode Mesh::loadFromObj(const char *filename){
-    // attrib will contain the vertex arrays of the file
-    tinyobj::attrib_t attrib;
-    // shapes contains the info for each separate object in the file
-    std::vector<tinyobj::shape_t> shapes;
-    // materials contains the information about the material of each shape, but we won't use it.
-    std::vector<tinyobj::material_t> materials;
-
-    // error and warning output from the load function
-    std::string warn;
-    std::string err;
-
-    // load the OBJ file
-    tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename, nullptr);
-    // make sure to output the warnings to the console, in case there are issues with the file
-    if (!warn.empty()) {
-        std::cout << "WARN: " << warn << std::endl;
+namespace {
+
+// hash of position, normal and texture coordinate indices of a face corner
+struct ObjIndexHash {
+    size_t operator()(const ObjIndex& key) const {
+        size_t h = std::hash<int>()(key.vertex);
+        h ^= std::hash<int>()(key.normal) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<int>()(key.texcoord) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        return h;
     }
-    // if we have any error, print it to the console, and break the mesh loading.
-    // This happens if the file can't be found or is malformed
-    if (!err.empty()) {
-        std::cerr << err << std::endl;
+};
+
+} // namespace
+
+ReturnCode Mesh::loadFromObj(const char *filename){
+    // file is parsed in parallel chunks into flat attribute and corner arrays
+    ObjData obj;
+    if(parseObjFile(filename, obj) != SUCCESS){
         return FAILED;
     }
 
-     // Loop over shapes
-    for (size_t s = 0; s < shapes.size(); s++) {
-        // Loop over faces(polygon)
-        size_t index_offset = 0;
-        for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
-
-            // hardcode loading to triangles
-            size_t fv = 3;
-
-            // Loop over vertices in the face.
-            for (size_t v = 0; v < fv; v++) {
-                // access to vertex
-                tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-
-                //vertex position
-                tinyobj::real_t vx = attrib.vertices[3 * idx.vertex_index + 0];
-                tinyobj::real_t vy = attrib.vertices[3 * idx.vertex_index + 1];
-                tinyobj::real_t vz = attrib.vertices[3 * idx.vertex_index + 2];
-                //vertex normal
-                tinyobj::real_t nx = attrib.normals[3 * idx.normal_index + 0];
-                tinyobj::real_t ny = attrib.normals[3 * idx.normal_index + 1];
-                tinyobj::real_t nz = attrib.normals[3 * idx.normal_index + 2];
-
-                //copy it into our vertex
-                Vertex new_vert;
-                new_vert.position.x = vx;
-                new_vert.position.y = vy;
-                new_vert.position.z = vz;
-
-                new_vert.normal.x = nx;
-                new_vert.normal.y = ny;
-                new_vert.normal.z = nz;
-
-                new_vert.color = new_vert.normal;
-
-                vertices.push_back(new_vert);
+    // a vertex is a unique combination of position, normal and texture coordinate
+    // indices, faces refer to vertices through index buffer so shared ones are stored once
+    std::unordered_map<ObjIndex, uint32_t, ObjIndexHash> uniqueVertices;
+    uniqueVertices.reserve(obj.positions.size() / 3);
+    vertices.reserve(obj.positions.size() / 3);
+
+    // vertices without normal in file get smooth normals computed from faces
+    std::vector<uint8_t> needsNormal;
+    size_t cornerCount = 0;
+
+    // get index of vertex for given face corner, adding vertex if it's new
+    auto getVertexIndex = [&](const ObjIndex& idx){
+        auto it = uniqueVertices.find(idx);
+        if(it != uniqueVertices.end()) return it->second;
+
+        //copy it into our vertex
+        Vertex newVert;
+        newVert.position.x = obj.positions[3 * idx.vertex + 0];
+        newVert.position.y = obj.positions[3 * idx.vertex + 1];
+        newVert.position.z = obj.positions[3 * idx.vertex + 2];
+
+        if(idx.normal >= 0){
+            newVert.normal.x = obj.normals[3 * idx.normal + 0];
+            newVert.normal.y = obj.normals[3 * idx.normal + 1];
+            newVert.normal.z = obj.normals[3 * idx.normal + 2];
+        }else{
+            newVert.normal = glm::vec3(0);
+        }
+
+        newVert.color = newVert.normal;
+
+        uint32_t index = static_cast<uint32_t>(vertices.size());
+        vertices.push_back(newVert);
+        needsNormal.push_back(idx.normal < 0);
+        uniqueVertices.emplace(idx, index);
+        return index;
+    };
+
+    // a fan has two triangles less than corners
+    size_t triangleCount = 0;
+    for(uint32_t faceSize : obj.faceSizes){
+        if(faceSize >= 3) triangleCount += faceSize - 2;
+    }
+    indices.reserve(indices.size() + 3 * triangleCount);
+
+    // Loop over faces(polygon)
+    size_t index_offset = 0;
+    for (size_t f = 0; f < obj.faceSizes.size(); f++) {
+        // number of vertices in this face
+        size_t fv = obj.faceSizes[f];
+        cornerCount += fv;
+
+        // triangulate polygon as a fan around its first vertex
+        if(fv >= 3){
+            uint32_t first = getVertexIndex(obj.corners[index_offset]);
+            uint32_t prev = getVertexIndex(obj.corners[index_offset + 1]);
+            for (size_t v = 2; v < fv; v++) {
+                uint32_t current = getVertexIndex(obj.corners[index_offset + v]);
+                indices.push_back(first);
+                indices.push_back(prev);
+                indices.push_back(current);
+                prev = current;
             }
-            index_offset += fv;
         }
+
+        // points and lines are skipped
+        index_offset += fv;
     }
 
-    std::cout << vertices.size() << "vertices loaded" << std::endl;
+    // accumulate area weighted face normals for vertices that didn't have one
+    if(std::find(needsNormal.begin(), needsNormal.end(), 1) != needsNormal.end()){
+        for(size_t i = 0; i + 2 < indices.size(); i += 3){
+            const glm::vec3& p0 = vertices[indices[i+0]].position;
+            const glm::vec3& p1 = vertices[indices[i+1]].position;
+            const glm::vec3& p2 = vertices[indices[i+2]].position;
+            glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+            for(size_t k = 0; k < 3; k++){
+                if(needsNormal[indices[i+k]]) vertices[indices[i+k]].normal += faceNormal;
+            }
+        }
+
+        for(size_t v = 0; v < vertices.size(); v++){
+            if(!needsNormal[v]) continue;
+            float len = glm::length(vertices[v].normal);
+            vertices[v].normal = len > 0.f ? vertices[v].normal / len : glm::vec3(0, 1, 0);
+            vertices[v].color = vertices[v].normal;
+        }
+    }
+
+    hasIndexBuffer = true;
+
+    // how many face corners share a vertex on average
+    float dedupRatio = vertices.empty() ? 0.f : static_cast<float>(cornerCount) / vertices.size();
+    std::cout << "[INFO] Loaded \"" << filename << "\" : " << vertices.size() << " unique vertices, "
+              << indices.size() / 3 << " triangles, dedup ratio " << dedupRatio << std::endl;
 
     return SUCCESS;
 }
 
+// compute bounding sphere around box containing all vertices
+void Mesh::computeBounds(){
+    if(vertices.empty()){
+        boundsCenter = glm::vec3(0);
+        boundsRadius = 0.f;
+        return;
+    }
+
+    glm::vec3 minPos = vertices[0].position, maxPos = vertices[0].position;
+    for(const Vertex& v : vertices){
+        minPos = glm::min(minPos, v.position);
+        maxPos = glm::max(maxPos, v.position);
+    }
+
+    boundsCenter = (minPos + maxPos) * 0.5f;
+    boundsRadius = 0.f;
+    for(const Vertex& v : vertices){
+        boundsRadius = std::max(boundsRadius, glm::length(v.position - boundsCenter));
+    }
+}
+
+glm::mat4 Mesh::getDequantizationMatrix() const {
+    if(format == VertexFormat::Float) return glm::mat4(1.f);
+
+    // unorm positions are fetched in [0, 1], map them back to quantization range
+    return glm::translate(quantizationOffset) * glm::scale(glm::vec3(quantizationScale));
+}
+
+void Mesh::encodeVertexStreams(std::vector<uint8_t>& positions, std::vector<uint8_t>& attributes){
+    positions.resize(vertices.size() * getPositionStride(format));
+    attributes.resize(vertices.size() * getAttributeStride(format));
+    if(vertices.empty()) return;
+
+    if(format == VertexFormat::Float){
+        glm::vec3* dstPositions = reinterpret_cast<glm::vec3*>(positions.data());
+        VertexAttributes* dstAttributes = reinterpret_cast<VertexAttributes*>(attributes.data());
+        for(size_t i = 0; i < vertices.size(); i++){
+            dstPositions[i] = vertices[i].position;
+            dstAttributes[i] = {vertices[i].color, vertices[i].normal};
+        }
+        return;
+    }
+
+    glm::vec3 minPos = vertices[0].position, maxPos = vertices[0].position;
+    for(const Vertex& v : vertices){
+        minPos = glm::min(minPos, v.position);
+        maxPos = glm::max(maxPos, v.position);
+    }
+
+    // largest extent decides precision of all axes
+    glm::vec3 extent = maxPos - minPos;
+    quantizationOffset = minPos;
+    quantizationScale = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f));
+
+    PackedPosition* dstPositions = reinterpret_cast<PackedPosition*>(positions.data());
+    PackedAttributes* dstAttributes = reinterpret_cast<PackedAttributes*>(attributes.data());
+    for(size_t i = 0; i < vertices.size(); i++){
+        PackedVertex packed = packVertex(vertices[i], quantizationOffset, quantizationScale);
+        dstPositions[i] = packed.position;
+        dstAttributes[i] = packed.attributes;
+    }
+}
+
+void Mesh::encodeIndices(std::vector<uint8_t>& data){
+    // meshes generated on gpu have no vertices on cpu, only their count
+    size_t count = vertices.empty() ? vertexCount : vertices.size();
+
+    // 32 bit indices are needed only when 16 bits can't address all vertices
+    if(count >= 65536){
+        indexType = VK_INDEX_TYPE_UINT32;
+        data.resize(indices.size() * sizeof(uint32_t));
+        memcpy(data.data(), indices.data(), data.size());
+        return;
+    }
+
+    indexType = VK_INDEX_TYPE_UINT16;
+    data.resize(indices.size() * sizeof(uint16_t));
+    uint16_t* dst = reinterpret_cast<uint16_t*>(data.data());
+    for(size_t i = 0; i < indices.size(); i++){
+        dst[i] = static_cast<uint16_t>(indices[i]);
+    }
+}
+
 // create mesh.mesh and store in given mesh object
 void createSphereMesh(Mesh& mesh, uint32_t slices, uint32_t circles, glm::vec3 color){
     slices = slices * 2;
-    float verticalAngleStep = PI / (circles+1);
-    float horizontalAngleStep = 2*PI / slices;
     float radius = 1.0f;
 
+    // angles repeat on every circle and slice, so they're tabulated once
+    SinCosTable horizontal(slices, 2*PI);
+    SinCosTable vertical(circles+1, PI);
+    auto point = [&](uint32_t s, uint32_t c){
+        return radius * glm::vec3(vertical.sines[c] * horizontal.cosines[s], vertical.cosines[c],
+                                  vertical.sines[c] * horizontal.sines[s]);
+    };
+
+    mesh.vertices.reserve(mesh.vertices.size() + 2 + size_t(circles) * slices);
+    mesh.indices.reserve(mesh.indices.size() + size_t(circles) * slices * 6);
+
     // topmost point of sphere
     Vertex v;
     // for topmost point both theta and phi is 0
-    v.position = sphericalToCartesian(radius, 0, 0);
+    v.position = point(0, 0);
     v.normal = glm::normalize(v.position);
     v.color = color;
     mesh.vertices.push_back(v);
@@ -95,7 +242,7 @@ void createSphereMesh(Mesh& mesh, uint32_t slices, uint32_t circles, glm::vec3 c
     // point just below topmost point but on surface of sphere
     // horizontally just below sphere so theta = 0
     // vertically it's just one step below
-    v.position = sphericalToCartesian(radius, 0, verticalAngleStep);
+    v.position = point(0, 1);
     v.normal = glm::normalize(v.position);
     mesh.vertices.push_back(v);
 
@@ -106,7 +253,7 @@ void createSphereMesh(Mesh& mesh, uint32_t slices, uint32_t circles, glm::vec3 c
     // all vertices lie on same circle
     for(uint32_t s = 0; s < slices-1; s++){
         // just horizontal position on sphere changes
-        v.position = sphericalToCartesian(radius, (s+1)*horizontalAngleStep, verticalAngleStep);
+        v.position = point(s+1, 1);
         // normal is just the normalized position in this case
         v.normal = glm::normalize(v.position);
 
@@ -132,7 +279,7 @@ void createSphereMesh(Mesh& mesh, uint32_t slices, uint32_t circles, glm::vec3 c
         uint32_t prevBaseIndex = baseIndex;
 
         // first point on new circle
-        v.position = sphericalToCartesian(radius, 0, (c+1)*verticalAngleStep);
+        v.position = point(0, c+1);
         v.normal = glm::normalize(v.position);
         mesh.vertices.push_back(v);
 
@@ -141,7 +288,7 @@ void createSphereMesh(Mesh& mesh, uint32_t slices, uint32_t circles, glm::vec3 c
 
         for(uint32_t s = 0; s < slices - 1; s++){
             // calculate position of these points
-            v.position = sphericalToCartesian(radius, (s+1)*horizontalAngleStep, (c+1)*verticalAngleStep);
+            v.position = point(s+1, c+1);
             // normal is just the normalized position in this case
             v.normal = glm::normalize(v.position);
 
@@ -178,7 +325,7 @@ void createSphereMesh(Mesh& mesh, uint32_t slices, uint32_t circles, glm::vec3 c
     }
 
     // bottom most point of sphere
-    v.position = sphericalToCartesian(radius, 0, PI); // vertically opposite point to topmost point
+    v.position = point(0, circles+1); // vertically opposite point to topmost point
     v.normal = glm::normalize(v.position);
     mesh.vertices.push_back(v);
 
@@ -232,50 +379,55 @@ void createRectangleMesh(Mesh& mesh, float width, float height, glm::vec3 color)
     mesh.hasIndexBuffer = true;
 }
 
-void createSurface(Mesh& mesh, const std::vector<float>& x, const std::vector<float>& y, float (*z)(float x, float y)){
-    assert((x.size() == y.size()) && "SIZE OF X AND Y VECTORS MUST BE SAME");
-
-    Vertex v1, v2, v3, v4;
-    v1.color = {0.25,0.25,0.25};
-    v2.color = {0.25,0.25,0.25};
-    v3.color = {0.25,0.25,0.25};
-    v4.color = {0.25,0.25,0.25};
-
-    for(uint32_t i = 0; i < x.size()-1; i++){
-        for(uint32_t j = 0; j < y.size()-1; j++){
-            // generate vertices of this cell's quad
-            v1.position = {x[i], z(x[i], y[j]), y[j]};
-            v2.position = {x[i+1], z(x[i+1], y[j]) , y[j]};
-            v3.position = {x[i+1], z(x[i+1], y[j+1]), y[j+1]};
-            v4.position = {x[i], z(x[i], y[j+1]), y[j+1]};
-
-            // normals correspondig to first triangle
-            v4.normal = glm::cross(v2.position - v1.position, v4.position - v1.position);
-            v2.normal = v4.normal;
-            v1.normal = v4.normal;
-
-            // v4.color = v4.normal;
-            // v2.color = v2.normal;
-            // v1.color = v1.normal;
-
-            // push first triangle
-            mesh.vertices.push_back(v4);
-            mesh.vertices.push_back(v2);
-            mesh.vertices.push_back(v1);
-
-            // normals correspondig to second triangle
-            v4.normal = glm::cross(v4.position - v3.position, v2.position - v3.position);
-            v3.normal = v4.normal;
-            v2.normal = v4.normal;
-
-            // v4.color = v4.normal;
-            // v3.color = v3.normal;
-            // v2.color = v2.normal;
-
-            // push second triangle
-            mesh.vertices.push_back(v4);
-            mesh.vertices.push_back(v3);
-            mesh.vertices.push_back(v2);
+void createSurfaceFromHeights(Mesh& mesh, const std::vector<float>& x, const std::vector<float>& y,
+                              const std::vector<float>& heights){
+    assert(heights.size() == x.size() * y.size() && "ONE HEIGHT PER GRID POINT IS REQUIRED");
+
+    size_t nx = x.size(), ny = y.size();
+    if(nx < 2 || ny < 2) return;
+
+    // every grid point is a single vertex shared by up to six triangles
+    mesh.vertices.resize(nx * ny);
+    createGridIndices(mesh.indices, nx, ny);
+    mesh.hasIndexBuffer = true;
+
+    auto height = [&](size_t i, size_t j){ return heights[j * nx + i]; };
+
+    // rows are independent, so vertices and indices are written in parallel
+    parallelFor(ny, [&](size_t j){
+        // neighbours for central differences, one sided at borders
+        size_t j0 = j > 0 ? j - 1 : j, j1 = j + 1 < ny ? j + 1 : j;
+
+        for(size_t i = 0; i < nx; i++){
+            size_t i0 = i > 0 ? i - 1 : i, i1 = i + 1 < nx ? i + 1 : i;
+
+            // tangents along both grid directions, their cross product is the smooth normal
+            glm::vec3 tangentX = {x[i1] - x[i0], height(i1, j) - height(i0, j), 0.f};
+            glm::vec3 tangentY = {0.f, height(i, j1) - height(i, j0), y[j1] - y[j0]};
+            glm::vec3 normal = glm::cross(tangentY, tangentX);
+            float len = glm::length(normal);
+
+            Vertex& v = mesh.vertices[j * nx + i];
+            v.position = {x[i], height(i, j), y[j]};
+            v.normal = len > 0.f ? normal / len : glm::vec3(0, 1, 0);
+            v.color = {0.25, 0.25, 0.25};
+        }
+    });
+}
+
+void createGridIndices(std::vector<uint32_t>& indices, size_t width, size_t height){
+    indices.clear();
+    if(width < 2 || height < 2) return;
+    indices.resize((width - 1) * (height - 1) * 6);
+
+    parallelFor(height - 1, [&](size_t j){
+        // two triangles per cell, v1 (i, j), v2 (i+1, j), v3 (i+1, j+1), v4 (i, j+1)
+        uint32_t* cell = indices.data() + j * (width - 1) * 6;
+        for(size_t i = 0; i + 1 < width; i++, cell += 6){
+            uint32_t v1 = static_cast<uint32_t>(j * width + i), v2 = v1 + 1;
+            uint32_t v4 = static_cast<uint32_t>((j + 1) * width + i), v3 = v4 + 1;
+            cell[0] = v4; cell[1] = v2; cell[2] = v1;
+            cell[3] = v4; cell[4] = v3; cell[5] = v2;
         }
-    }
+    });
 }
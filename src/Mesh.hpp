@@ -9,21 +9,112 @@
 #define MESH_HPP
 
 #include "Vertex.hpp"
-#include "AllocatedBuffer.hpp"
 #include "ReturnCode.hpp"
+#include "MeshLod.hpp"
+#include "VertexFormat.hpp"
+#include "Parallel.hpp"
+#include "Handle.hpp"
+
+struct Mesh;
+struct DynamicMesh;
+
+/// reference to a mesh registered in a renderer
+using MeshHandle = Handle<Mesh>;
 
 struct Mesh{
-    // vertex buffer
+    // vertices, split in position and attribute streams on gpu
     std::vector<Vertex> vertices;
-    AllocatedBuffer vertexBuffer;
 
     // indices buffer
     bool hasIndexBuffer = false;
     std::vector<uint32_t> indices;
-    AllocatedBuffer indexBuffer;
+
+    // location of mesh in geometry buffer of renderer, set on upload
+    // first vertex of mesh in vertex streams of its format
+    uint32_t vertexOffset = 0;
+    // number of vertices on gpu
+    uint32_t vertexCount = 0;
+    // first index of mesh in index buffer, in units of indexType
+    uint32_t firstIndex = 0;
+    // number of indices of all levels of detail on gpu
+    uint32_t indexCount = 0;
+    // set while mesh data is in geometry buffer
+    bool uploaded = false;
+    // ticket of upload batch carrying mesh data, mesh is drawable once it completes
+    uint64_t uploadTicket = 0;
+    // last frame an object using mesh was visible, least recently drawn meshes are evicted first
+    size_t lastDrawnFrame = 0;
+    // set when gpu data of a streamed mesh was evicted, it's loaded again once visible
+    bool evicted = false;
+
+    // levels of detail, first one is full detail mesh
+    // all levels are stored one after another in indices
+    // empty if mesh has no index buffer
+    std::vector<MeshLod> lods;
+
+    // set once triangles and vertices are reordered for gpu caches
+    bool optimized = false;
+
+    // drawn instead of this mesh while it isn't ready, e.g. while it's streamed in
+    // can be a placeholder or a coarser version of same mesh, registered in same renderer
+    MeshHandle fallback;
+
+    // set for meshes created with createDynamicMesh() of renderer, their
+    // vertices live in host visible buffers of that instead of geometry buffer
+    Handle<DynamicMesh> dynamic;
+
+    // layout of vertices on gpu, choose before uploading mesh
+    VertexFormat format = VertexFormat::Float;
+    // type of indices on gpu, 16 bit is selected on upload
+    // when mesh has less than 65536 vertices
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+
+    // packed positions are stored relative to this range,
+    // position = quantizationOffset + stored * quantizationScale
+    // a single scale for all axes keeps normals transformable by model matrix
+    glm::vec3 quantizationOffset = glm::vec3(0);
+    float quantizationScale = 1.f;
+
+    // bounding sphere in object space
+    glm::vec3 boundsCenter = glm::vec3(0);
+    float boundsRadius = 0.f;
+
+    /**
+     * @brief Compute bounding sphere of mesh from vertex positions.
+     * */
+    void computeBounds();
+
+    /**
+     * @brief Get matrix converting positions stored on gpu to object space.
+     * Identity for full precision vertices.
+     *
+     * @return glm::mat4
+     * */
+    glm::mat4 getDequantizationMatrix() const;
+
+    /**
+     * @brief Encode vertices in layout of mesh format, one buffer per stream.
+     * Quantization range is computed from vertex positions for packed format.
+     *
+     * @param[out] positions Position stream, bound to binding 0.
+     * @param[out] attributes Attribute stream, bound to binding 1.
+     * */
+    void encodeVertexStreams(std::vector<uint8_t>& positions, std::vector<uint8_t>& attributes);
+
+    /**
+     * @brief Encode indices with smallest index type that addresses all vertices.
+     * 16 bit indices are used when mesh has less than 65536 vertices.
+     * Vertex count is taken from vertexCount if vertices are empty.
+     * Sets indexType.
+     *
+     * @param[out] data Encoded index buffer.
+     * */
+    void encodeIndices(std::vector<uint8_t>& data);
 
     /**
      * @brief Load an obj file to mesh.
+     * Face corners with same position, normal and texture coordinate share
+     * a single vertex through index buffer. Polygons are triangulated as fans.
      * @param[in] filename.
      * @return SUCCESS on success, FAILED otherwise.
      */
@@ -49,11 +140,51 @@ void createSphereMesh(Mesh& mesh, uint32_t slices, uint32_t circles, glm::vec3 c
  * */
 void createRectangleMesh(Mesh& mesh, float width, float height, glm::vec3 color = {0.1f, 0.1f, 0.1f});
 
+/**
+ * @brief Create triangle list of a grid of points.
+ * Point (i, j) is vertex j * width + i, every cell is split into two triangles.
+ *
+ * @param[out] indices Triangle list, 6 indices per cell.
+ * @param[in] width Number of points per row.
+ * @param[in] height Number of rows.
+ * */
+void createGridIndices(std::vector<uint32_t>& indices, size_t width, size_t height);
+
+/**
+ * @brief Create an indexed grid surface from heights sampled at grid points.
+ * Grid point (i, j) is at (x[i], heights[j * x.size() + i], y[j]).
+ * Normals are smooth, computed from neighbouring samples.
+ *
+ * @param[out] mesh Mesh object to store vertex data into.
+ * @param[in] x Grid coordinates along x axis.
+ * @param[in] y Grid coordinates along z axis.
+ * @param[in] heights Height of every grid point, row by row.
+ * */
+void createSurfaceFromHeights(Mesh& mesh, const std::vector<float>& x, const std::vector<float>& y,
+                              const std::vector<float>& heights);
+
 /**
  * @brief Create a surface for given x, y vectors and z function.
+ * z is evaluated once per grid point, rows are evaluated in parallel.
+ * Passing a lambda or function object lets z be inlined into the row loop.
  *
  * @param[out] mesh Mesh object to store vertex data into.
+ * @param[in] x Grid coordinates along x axis.
+ * @param[in] y Grid coordinates along z axis.
+ * @param[in] z Callable returning height for given x and y.
  * */
-void createSurface(Mesh& mesh, const std::vector<float>& x, const std::vector<float>& y, float (*z)(float x, float y));
+template<typename ZFunction>
+void createSurface(Mesh& mesh, const std::vector<float>& x, const std::vector<float>& y, ZFunction&& z){
+    std::vector<float> heights(x.size() * y.size());
+    parallelFor(y.size(), [&](size_t j){
+        float* row = heights.data() + j * x.size();
+        const float yj = y[j];
+        for(size_t i = 0; i < x.size(); i++){
+            row[i] = z(x[i], yj);
+        }
+    });
+
+    createSurfaceFromHeights(mesh, x, y, heights);
+}
 
 #endif//MESH_HPP
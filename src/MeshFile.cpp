@@ -0,0 +1,263 @@
+#include "MeshFile.hpp"
+#include "MeshOptimizer.hpp"
+#include "Simplifier.hpp"
+
+#include <fstream>
+#include <algorithm>
+#include <type_traits>
+#include <iostream>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static_assert(std::is_trivially_copyable<MeshLod>::value, "levels of detail are stored as raw bytes");
+
+namespace {
+
+inline uint64_t alignUp(uint64_t value, uint64_t alignment){
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// place section of given size after previous one
+MeshFileSection placeSection(uint64_t& fileSize, uint64_t size){
+    MeshFileSection section;
+    section.offset = alignUp(fileSize, meshFileAlignment);
+    section.size = size;
+    fileSize = section.offset + size;
+    return section;
+}
+
+// check that a section lies within file
+inline bool isSectionValid(const MeshFileSection& section, size_t fileSize){
+    return section.offset % meshFileAlignment == 0 && section.offset <= fileSize &&
+           section.size <= fileSize - section.offset;
+}
+
+// modification time of file, false if it doesn't exist
+bool getModificationTime(const std::string& path, struct timespec& time){
+    struct stat info;
+    if(stat(path.c_str(), &info) != 0) return false;
+    time = info.st_mtim;
+    return true;
+}
+
+inline bool isOlder(const struct timespec& a, const struct timespec& b){
+    return a.tv_sec < b.tv_sec || (a.tv_sec == b.tv_sec && a.tv_nsec < b.tv_nsec);
+}
+
+} // namespace
+
+ReturnCode writeMeshFile(const char* filename, Mesh& mesh){
+    if(mesh.vertices.empty()) return FAILED;
+    if(mesh.boundsRadius == 0.f) mesh.computeBounds();
+
+    // encode data exactly as it's going to be uploaded
+    std::vector<uint8_t> positions, attributes, indices;
+    mesh.encodeVertexStreams(positions, attributes);
+    if(mesh.hasIndexBuffer && !mesh.indices.empty()) mesh.encodeIndices(indices);
+
+    MeshFileHeader header;
+    std::copy(meshFileMagic, meshFileMagic + 4, header.magic);
+    header.version = meshFileVersion;
+    header.format = static_cast<uint32_t>(mesh.format);
+    header.indexType = static_cast<uint32_t>(mesh.indexType);
+    header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    header.indexCount = static_cast<uint32_t>(indices.empty() ? 0 : mesh.indices.size());
+    header.lodCount = static_cast<uint32_t>(mesh.lods.size());
+    header.hasIndexBuffer = mesh.hasIndexBuffer ? 1 : 0;
+    for(int i = 0; i < 3; i++){
+        header.boundsCenter[i] = mesh.boundsCenter[i];
+        header.quantizationOffset[i] = mesh.quantizationOffset[i];
+    }
+    header.boundsRadius = mesh.boundsRadius;
+    header.quantizationScale = mesh.quantizationScale;
+
+    uint64_t fileSize = sizeof(MeshFileHeader);
+    header.positions = placeSection(fileSize, positions.size());
+    header.attributes = placeSection(fileSize, attributes.size());
+    header.indices = placeSection(fileSize, indices.size());
+    header.lods = placeSection(fileSize, mesh.lods.size() * sizeof(MeshLod));
+
+    // assemble whole file in memory, it's written only once per cache miss
+    std::vector<uint8_t> contents(fileSize, 0);
+    memcpy(contents.data(), &header, sizeof(header));
+    memcpy(contents.data() + header.positions.offset, positions.data(), positions.size());
+    memcpy(contents.data() + header.attributes.offset, attributes.data(), attributes.size());
+    memcpy(contents.data() + header.indices.offset, indices.data(), indices.size());
+    memcpy(contents.data() + header.lods.offset, mesh.lods.data(), header.lods.size);
+
+    // unique temporary name, other threads or processes may build same file
+    std::string tempName = std::string(filename) + ".tmp" + std::to_string(getpid()) + "_" +
+                           std::to_string(reinterpret_cast<uintptr_t>(&mesh));
+    {
+        std::ofstream file(tempName, std::ios::binary | std::ios::trunc);
+        if(!file.is_open()) return FAILED;
+
+        file.write(reinterpret_cast<const char*>(contents.data()), contents.size());
+        if(!file.good()){
+            file.close();
+            std::remove(tempName.c_str());
+            return FAILED;
+        }
+    }
+
+    if(std::rename(tempName.c_str(), filename) != 0){
+        std::remove(tempName.c_str());
+        return FAILED;
+    }
+
+    return SUCCESS;
+}
+
+MappedMeshFile::~MappedMeshFile(){
+    close();
+}
+
+MappedMeshFile::MappedMeshFile(MappedMeshFile&& other) noexcept
+    : data(other.data), size(other.size){
+    other.data = nullptr;
+    other.size = 0;
+}
+
+MappedMeshFile& MappedMeshFile::operator=(MappedMeshFile&& other) noexcept{
+    if(this != &other){
+        close();
+        data = other.data;
+        size = other.size;
+        other.data = nullptr;
+        other.size = 0;
+    }
+    return *this;
+}
+
+ReturnCode MappedMeshFile::open(const char* filename){
+    close();
+
+    int fd = ::open(filename, O_RDONLY);
+    if(fd < 0) return FAILED;
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(MeshFileHeader)){
+        ::close(fd);
+        return FAILED;
+    }
+
+    // mapping stays valid after closing descriptor
+    size_t fileSize = static_cast<size_t>(info.st_size);
+    void* mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(mapped == MAP_FAILED) return FAILED;
+
+    data = static_cast<const uint8_t*>(mapped);
+    size = fileSize;
+
+    // whole file is read front to back on upload
+    madvise(mapped, fileSize, MADV_SEQUENTIAL);
+
+    // reject files that don't match what this build expects
+    const MeshFileHeader& header = getHeader();
+    bool valid = std::equal(meshFileMagic, meshFileMagic + 4, header.magic) &&
+                 header.version == meshFileVersion &&
+                 header.format < VertexFormatCount &&
+                 (header.indexType == VK_INDEX_TYPE_UINT16 || header.indexType == VK_INDEX_TYPE_UINT32) &&
+                 isSectionValid(header.positions, size) && isSectionValid(header.attributes, size) &&
+                 isSectionValid(header.indices, size) && isSectionValid(header.lods, size);
+
+    if(valid){
+        VertexFormat format = static_cast<VertexFormat>(header.format);
+        size_t indexSize = header.indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+        valid = header.positions.size == uint64_t(header.vertexCount) * getPositionStride(format) &&
+                header.attributes.size == uint64_t(header.vertexCount) * getAttributeStride(format) &&
+                header.indices.size == uint64_t(header.indexCount) * indexSize &&
+                header.lods.size == uint64_t(header.lodCount) * sizeof(MeshLod);
+    }
+
+    if(!valid){
+        close();
+        return FAILED;
+    }
+
+    return SUCCESS;
+}
+
+void MappedMeshFile::close(){
+    if(data != nullptr){
+        munmap(const_cast<uint8_t*>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+}
+
+void MappedMeshFile::describe(Mesh& mesh) const{
+    const MeshFileHeader& header = getHeader();
+
+    mesh.vertices.clear();
+    mesh.indices.clear();
+    mesh.hasIndexBuffer = header.hasIndexBuffer != 0;
+    mesh.format = static_cast<VertexFormat>(header.format);
+    mesh.indexType = static_cast<VkIndexType>(header.indexType);
+    mesh.vertexCount = header.vertexCount;
+    mesh.indexCount = header.indexCount;
+    mesh.boundsCenter = glm::vec3(header.boundsCenter[0], header.boundsCenter[1], header.boundsCenter[2]);
+    mesh.boundsRadius = header.boundsRadius;
+    mesh.quantizationOffset = glm::vec3(header.quantizationOffset[0], header.quantizationOffset[1],
+                                        header.quantizationOffset[2]);
+    mesh.quantizationScale = header.quantizationScale;
+
+    // levels are small and needed after file is unmapped, so they are copied
+    mesh.lods.resize(header.lodCount);
+    memcpy(mesh.lods.data(), getSection(header.lods), header.lods.size);
+
+    // data in file is already optimized
+    mesh.optimized = true;
+}
+
+std::string getMeshCachePath(const std::string& objPath){
+    size_t dot = objPath.find_last_of('.');
+    size_t slash = objPath.find_last_of("/\\");
+    if(dot == std::string::npos || (slash != std::string::npos && dot < slash)) return objPath + ".dmesh";
+    return objPath.substr(0, dot) + ".dmesh";
+}
+
+ReturnCode openCachedMeshFile(const std::string& path, VertexFormat format, MappedMeshFile& file, Mesh* parsed){
+    // binary files are opened as they are
+    bool isObj = path.size() >= 4 && path.compare(path.size() - 4, 4, ".obj") == 0;
+    if(!isObj) return file.open(path.c_str());
+
+    std::string cachePath = getMeshCachePath(path);
+
+    // use cache if it's up to date
+    struct timespec objTime, cacheTime;
+    bool hasObj = getModificationTime(path, objTime);
+    if(getModificationTime(cachePath, cacheTime) && (!hasObj || !isOlder(cacheTime, objTime))){
+        if(file.open(cachePath.c_str()) == SUCCESS &&
+           file.getHeader().format == static_cast<uint32_t>(format)){
+            return SUCCESS;
+        }
+        file.close();
+    }
+
+    if(!hasObj) return FAILED;
+
+    // cache miss, build mesh once and store it in binary form
+    Mesh local;
+    Mesh& mesh = parsed != nullptr ? *parsed : local;
+    mesh.format = format;
+    if(mesh.loadFromObj(path.c_str()) != SUCCESS || mesh.vertices.empty()) return FAILED;
+    generateMeshLods(mesh);
+    optimizeMesh(mesh);
+
+    // parsed mesh can still be used if cache can't be written, e.g. in a read only directory
+    if(writeMeshFile(cachePath.c_str(), mesh) != SUCCESS || file.open(cachePath.c_str()) != SUCCESS){
+        std::cerr << "[WARNING] Failed to write mesh cache " << cachePath << std::endl;
+        return parsed != nullptr ? INCOMPLETE : FAILED;
+    }
+    std::cout << "[INFO] Built mesh cache " << cachePath << std::endl;
+
+    // mesh is read from file instead
+    if(parsed != nullptr) *parsed = Mesh{};
+    return SUCCESS;
+}
@@ -0,0 +1,144 @@
+#ifndef MESH_FILE_HPP
+#define MESH_FILE_HPP
+
+#include <string>
+#include <cstdint>
+
+#include "Mesh.hpp"
+#include "ReturnCode.hpp"
+
+// Binary mesh files (.dmesh) store meshes exactly as they are laid out in
+// geometry buffer, so loading is a memcpy from mapped file to staging memory.
+// Layout is a header followed by sections, each aligned to meshFileAlignment:
+//  - position stream, vertexCount * getPositionStride(format) bytes
+//  - attribute stream, vertexCount * getAttributeStride(format) bytes
+//  - indices of all levels of detail, indexCount indices of indexType
+//  - levels of detail, lodCount MeshLod entries
+// Everything is stored in host byte order.
+
+/// magic number at start of every mesh file
+constexpr char meshFileMagic[4] = {'D', 'M', 'S', 'H'};
+/// files of other versions are rejected, and rebuilt if they are a cache
+constexpr uint32_t meshFileVersion = 1;
+/// alignment of sections in file
+constexpr uint64_t meshFileAlignment = 64;
+
+// location of a section in file, relative to start of file
+struct MeshFileSection {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+struct MeshFileHeader {
+    char magic[4] = {};
+    uint32_t version = 0;
+
+    // VertexFormat and VkIndexType of encoded data
+    uint32_t format = 0;
+    uint32_t indexType = 0;
+
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    uint32_t lodCount = 0;
+    uint32_t hasIndexBuffer = 0;
+
+    // bounding sphere in object space
+    float boundsCenter[3] = {};
+    float boundsRadius = 0.f;
+
+    // quantization range of packed positions
+    float quantizationOffset[3] = {};
+    float quantizationScale = 1.f;
+
+    MeshFileSection positions;
+    MeshFileSection attributes;
+    MeshFileSection indices;
+    MeshFileSection lods;
+};
+
+/**
+ * @brief Write mesh to a binary mesh file, encoded in vertex format of mesh.
+ * File is written to a temporary file first and renamed, so readers
+ * never see a partially written file.
+ *
+ * @param filename Path of file to write.
+ * @param mesh Mesh with cpu side vertices, indices and levels of detail.
+ * @return SUCCESS on success, FAILED otherwise.
+ * */
+ReturnCode writeMeshFile(const char* filename, Mesh& mesh);
+
+/**
+ * @brief A binary mesh file mapped read only to memory.
+ * Sections can be passed directly to uploads, no copies are made on cpu.
+ * */
+class MappedMeshFile {
+public:
+    MappedMeshFile() = default;
+    ~MappedMeshFile();
+
+    MappedMeshFile(MappedMeshFile&& other) noexcept;
+    MappedMeshFile& operator=(MappedMeshFile&& other) noexcept;
+    MappedMeshFile(const MappedMeshFile&) = delete;
+    MappedMeshFile& operator=(const MappedMeshFile&) = delete;
+
+    /**
+     * @brief Map file and validate its header and sections.
+     *
+     * @param filename Path of mesh file.
+     * @return SUCCESS on success, FAILED if file can't be mapped or is invalid.
+     * */
+    ReturnCode open(const char* filename);
+
+    /**
+     * @brief Unmap file.
+     * */
+    void close();
+
+    /// true if a valid file is mapped
+    inline bool isOpen() const { return data != nullptr; }
+
+    /// header of mapped file
+    inline const MeshFileHeader& getHeader() const { return *reinterpret_cast<const MeshFileHeader*>(data); }
+
+    /// pointer to contents of given section
+    inline const uint8_t* getSection(const MeshFileSection& section) const { return data + section.offset; }
+
+    /**
+     * @brief Fill mesh metadata from header and lods section.
+     * Counts, bounds, levels of detail, formats and quantization are set,
+     * vertices and indices stay on disk until mesh is uploaded.
+     *
+     * @param mesh Mesh to describe.
+     * */
+    void describe(Mesh& mesh) const;
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+/**
+ * @brief Get path of binary cache of an obj file.
+ * Cache lives next to obj file, with .dmesh extension.
+ *
+ * @param objPath Path of obj file.
+ * @return std::string Path of cache file.
+ * */
+std::string getMeshCachePath(const std::string& objPath);
+
+/**
+ * @brief Open binary version of an obj file, building it if needed.
+ * Cache is rebuilt if it's missing, older than obj file, of another
+ * version or encoded in another vertex format. Building parses obj file,
+ * generates levels of detail and optimizes mesh. Paths not ending in .obj
+ * are opened as mesh files directly.
+ *
+ * @param path Path of obj or mesh file.
+ * @param format Vertex format mesh should be encoded in.
+ * @param[out] file Mapped mesh file.
+ * @param[out] parsed If not null, receives parsed mesh when cache can't be written.
+ * @return SUCCESS if file is mapped, INCOMPLETE if only parsed mesh is available, FAILED otherwise.
+ * */
+ReturnCode openCachedMeshFile(const std::string& path, VertexFormat format, MappedMeshFile& file,
+                              Mesh* parsed = nullptr);
+
+#endif//MESH_FILE_HPP
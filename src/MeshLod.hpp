@@ -0,0 +1,18 @@
+#ifndef MESH_LOD_HPP
+#define MESH_LOD_HPP
+
+#include <cstdint>
+
+// A single level of detail of a mesh.
+// All levels of a mesh share the same vertex buffer and are stored
+// one after another in the same index buffer.
+struct MeshLod {
+    // first index of this level in index buffer
+    uint32_t firstIndex = 0;
+    // number of indices in this level
+    uint32_t indexCount = 0;
+    // maximum deviation from full detail mesh in object space units
+    float error = 0.f;
+};
+
+#endif//MESH_LOD_HPP
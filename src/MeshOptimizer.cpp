@@ -0,0 +1,376 @@
+#include "MeshOptimizer.hpp"
+#include "Mesh.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cfloat>
+
+namespace {
+
+// size of LRU cache modelled by vertex cache optimization
+constexpr uint32_t forsythCacheSize = 32;
+
+// size of FIFO cache used for finding cluster boundaries
+constexpr uint32_t clusterCacheSize = 16;
+
+// score of a vertex from Forsyth's paper, depends on its position in
+// LRU cache and on number of triangles still using it
+float forsythVertexScore(int32_t cachePosition, uint32_t remainingTriangles){
+    // no triangle needs this vertex anymore
+    if(remainingTriangles == 0) return -1.f;
+
+    float score = 0.f;
+    if(cachePosition >= 0){
+        // vertices of last triangle get a fixed score so that
+        // the same triangle strip direction isn't favoured
+        if(cachePosition < 3){
+            score = 0.75f;
+        }else{
+            float scale = 1.f / (forsythCacheSize - 3);
+            score = std::pow(1.f - (cachePosition - 3) * scale, 1.5f);
+        }
+    }
+
+    // bonus for vertices with few remaining triangles, gets rid of them quickly
+    score += 2.f / std::sqrt(static_cast<float>(remainingTriangles));
+    return score;
+}
+
+// simulated FIFO cache, a vertex is cached if it was added in last cacheSize misses
+struct FifoCache {
+    std::vector<uint32_t> timestamps;
+    uint32_t cacheSize;
+    uint32_t time;
+
+    FifoCache(size_t vertexCount, uint32_t size)
+        : timestamps(vertexCount, 0), cacheSize(size), time(size + 1) {}
+
+    // returns true on cache miss
+    bool access(uint32_t v){
+        if(time - timestamps[v] > cacheSize){
+            timestamps[v] = time++;
+            return true;
+        }
+        return false;
+    }
+
+    // empty cache without touching timestamps
+    void reset(){ time += cacheSize + 1; }
+};
+
+// number of cache misses caused by a triangle
+inline uint32_t triangleMisses(FifoCache& cache, const uint32_t* tri){
+    return cache.access(tri[0]) + cache.access(tri[1]) + cache.access(tri[2]);
+}
+
+inline size_t maxIndex(const uint32_t* indices, size_t indexCount){
+    uint32_t maxIdx = 0;
+    for(size_t i = 0; i < indexCount; i++) maxIdx = std::max(maxIdx, indices[i]);
+    return indexCount ? size_t(maxIdx) + 1 : 0;
+}
+
+} // namespace
+
+float computeAcmr(const uint32_t* indices, size_t indexCount, uint32_t cacheSize){
+    size_t triangleCount = indexCount / 3;
+    if(triangleCount == 0) return 0.f;
+
+    FifoCache cache(maxIndex(indices, indexCount), cacheSize);
+    size_t misses = 0;
+    for(size_t i = 0; i < triangleCount * 3; i += 3){
+        misses += triangleMisses(cache, &indices[i]);
+    }
+
+    return static_cast<float>(misses) / triangleCount;
+}
+
+float computeAtvr(const uint32_t* indices, size_t indexCount, uint32_t cacheSize){
+    size_t vertexCount = maxIndex(indices, indexCount);
+    if(vertexCount == 0) return 0.f;
+
+    // count only vertices actually referenced
+    std::vector<uint8_t> used(vertexCount, 0);
+    size_t uniqueCount = 0;
+    for(size_t i = 0; i < indexCount; i++){
+        if(!used[indices[i]]){
+            used[indices[i]] = 1;
+            uniqueCount++;
+        }
+    }
+
+    FifoCache cache(vertexCount, cacheSize);
+    size_t misses = 0;
+    for(size_t i = 0; i + 2 < indexCount; i += 3){
+        misses += triangleMisses(cache, &indices[i]);
+    }
+
+    return static_cast<float>(misses) / uniqueCount;
+}
+
+void optimizeVertexCache(uint32_t* dst, const uint32_t* indices, size_t indexCount, size_t vertexCount){
+    const size_t triangleCount = indexCount / 3;
+    if(triangleCount == 0) return;
+
+    // triangles using each vertex, only first remainingTriangles[v] entries are still live
+    std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+    for(size_t i = 0; i < triangleCount * 3; i++) remainingTriangles[indices[i]]++;
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    std::partial_sum(remainingTriangles.begin(), remainingTriangles.end(), adjacencyOffsets.begin() + 1);
+
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for(size_t i = 0; i < triangleCount * 3; i++){
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    // initial scores
+    std::vector<int32_t> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for(size_t v = 0; v < vertexCount; v++){
+        vertexScore[v] = forsythVertexScore(-1, remainingTriangles[v]);
+    }
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    for(size_t t = 0; t < triangleCount; t++){
+        const uint32_t* tri = &indices[3*t];
+        triangleScore[t] = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+    }
+
+    // LRU cache, one extra triangle worth of space for vertices getting evicted
+    uint32_t cache[forsythCacheSize + 3];
+    uint32_t newCache[forsythCacheSize + 3];
+    uint32_t cacheCount = 0;
+
+    // start with best triangle overall
+    int64_t best = std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+
+    // used to find a new starting triangle when cache has no candidates
+    size_t cursor = 0;
+
+    for(size_t out = 0; out < triangleCount; out++){
+        if(best < 0){
+            while(emitted[cursor]) cursor++;
+            best = static_cast<int64_t>(cursor);
+        }
+
+        const uint32_t* tri = &indices[3*best];
+        dst[3*out+0] = tri[0];
+        dst[3*out+1] = tri[1];
+        dst[3*out+2] = tri[2];
+        emitted[best] = 1;
+
+        // remove emitted triangle from live adjacency of its vertices
+        for(int k = 0; k < 3; k++){
+            uint32_t v = tri[k];
+            uint32_t* adj = &adjacency[adjacencyOffsets[v]];
+            uint32_t count = remainingTriangles[v];
+            for(uint32_t a = 0; a < count; a++){
+                if(adj[a] == static_cast<uint32_t>(best)){
+                    std::swap(adj[a], adj[count - 1]);
+                    remainingTriangles[v]--;
+                    break;
+                }
+            }
+        }
+
+        // emitted vertices move to front of cache
+        uint32_t newCount = 0;
+        for(int k = 0; k < 3; k++){
+            if(std::find(newCache, newCache + newCount, tri[k]) == newCache + newCount){
+                newCache[newCount++] = tri[k];
+            }
+        }
+        for(uint32_t c = 0; c < cacheCount; c++){
+            uint32_t v = cache[c];
+            if(v != tri[0] && v != tri[1] && v != tri[2]) newCache[newCount++] = v;
+        }
+
+        // update scores of all vertices whose cache position changed,
+        // including ones that just got evicted, and of their triangles
+        for(uint32_t c = 0; c < newCount; c++){
+            uint32_t v = newCache[c];
+            cachePosition[v] = c < forsythCacheSize ? static_cast<int32_t>(c) : -1;
+
+            float score = forsythVertexScore(cachePosition[v], remainingTriangles[v]);
+            float delta = score - vertexScore[v];
+            vertexScore[v] = score;
+
+            const uint32_t* adj = &adjacency[adjacencyOffsets[v]];
+            for(uint32_t a = 0; a < remainingTriangles[v]; a++){
+                triangleScore[adj[a]] += delta;
+            }
+        }
+
+        cacheCount = std::min(newCount, forsythCacheSize);
+        std::copy(newCache, newCache + cacheCount, cache);
+
+        // next triangle is the best one using a cached vertex
+        best = -1;
+        float bestScore = -FLT_MAX;
+        for(uint32_t c = 0; c < cacheCount; c++){
+            uint32_t v = cache[c];
+            const uint32_t* adj = &adjacency[adjacencyOffsets[v]];
+            for(uint32_t a = 0; a < remainingTriangles[v]; a++){
+                if(triangleScore[adj[a]] > bestScore){
+                    bestScore = triangleScore[adj[a]];
+                    best = adj[a];
+                }
+            }
+        }
+    }
+}
+
+void optimizeOverdraw(uint32_t* dst, const uint32_t* indices, size_t indexCount,
+                      const std::vector<Vertex>& vertices, float threshold){
+    const size_t triangleCount = indexCount / 3;
+    if(triangleCount == 0) return;
+
+    FifoCache cache(vertices.size(), clusterCacheSize);
+
+    // hard boundaries are triangles where cache is completely cold
+    std::vector<uint32_t> hardBoundaries;
+    for(size_t t = 0; t < triangleCount; t++){
+        if(triangleMisses(cache, &indices[3*t]) == 3) hardBoundaries.push_back(static_cast<uint32_t>(t));
+    }
+    hardBoundaries.push_back(static_cast<uint32_t>(triangleCount));
+
+    // split each hard cluster further wherever cache efficiency so far
+    // is within threshold of efficiency of whole cluster
+    std::vector<uint32_t> clusters;
+    for(size_t h = 0; h + 1 < hardBoundaries.size(); h++){
+        uint32_t start = hardBoundaries[h], end = hardBoundaries[h+1];
+
+        cache.reset();
+        uint32_t clusterMisses = 0;
+        for(uint32_t t = start; t < end; t++) clusterMisses += triangleMisses(cache, &indices[3*t]);
+        float clusterThreshold = threshold * clusterMisses / (end - start);
+
+        cache.reset();
+        clusters.push_back(start);
+        uint32_t misses = 0, triangles = 0;
+        for(uint32_t t = start; t < end; t++){
+            misses += triangleMisses(cache, &indices[3*t]);
+            triangles++;
+
+            if(t + 1 < end && static_cast<float>(misses) / triangles <= clusterThreshold){
+                clusters.push_back(t + 1);
+                misses = 0;
+                triangles = 0;
+                cache.reset();
+            }
+        }
+    }
+    clusters.push_back(static_cast<uint32_t>(triangleCount));
+
+    // area weighted centroid of whole triangle list
+    glm::vec3 meshCentroid(0.f);
+    float meshArea = 0.f;
+    for(size_t t = 0; t < triangleCount; t++){
+        const glm::vec3& p0 = vertices[indices[3*t+0]].position;
+        const glm::vec3& p1 = vertices[indices[3*t+1]].position;
+        const glm::vec3& p2 = vertices[indices[3*t+2]].position;
+        float area = glm::length(glm::cross(p1 - p0, p2 - p0));
+        meshCentroid += (p0 + p1 + p2) * (area / 3.f);
+        meshArea += area;
+    }
+    if(meshArea > 0.f) meshCentroid /= meshArea;
+
+    // clusters facing away from centre are likely to occlude others, draw them first
+    size_t clusterCount = clusters.size() - 1;
+    std::vector<float> sortKeys(clusterCount);
+    for(size_t c = 0; c < clusterCount; c++){
+        glm::vec3 centroid(0.f), normal(0.f);
+        float area = 0.f;
+        for(uint32_t t = clusters[c]; t < clusters[c+1]; t++){
+            const glm::vec3& p0 = vertices[indices[3*t+0]].position;
+            const glm::vec3& p1 = vertices[indices[3*t+1]].position;
+            const glm::vec3& p2 = vertices[indices[3*t+2]].position;
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float a = glm::length(n);
+            centroid += (p0 + p1 + p2) * (a / 3.f);
+            normal += n;
+            area += a;
+        }
+
+        float normalLength = glm::length(normal);
+        if(area > 0.f && normalLength > 0.f){
+            centroid /= area;
+            sortKeys[c] = glm::dot(centroid - meshCentroid, normal / normalLength);
+        }else{
+            sortKeys[c] = 0.f;
+        }
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    size_t out = 0;
+    for(uint32_t c : order){
+        for(uint32_t t = clusters[c]; t < clusters[c+1]; t++){
+            dst[out++] = indices[3*t+0];
+            dst[out++] = indices[3*t+1];
+            dst[out++] = indices[3*t+2];
+        }
+    }
+}
+
+void optimizeVertexFetch(Mesh& mesh){
+    const uint32_t unused = UINT32_MAX;
+    std::vector<uint32_t> remap(mesh.vertices.size(), unused);
+
+    // number vertices in order of first use, full detail level comes first in indices
+    uint32_t next = 0;
+    for(uint32_t& idx : mesh.indices){
+        if(remap[idx] == unused) remap[idx] = next++;
+        idx = remap[idx];
+    }
+
+    std::vector<Vertex> vertices(next);
+    for(size_t v = 0; v < mesh.vertices.size(); v++){
+        if(remap[v] != unused) vertices[remap[v]] = mesh.vertices[v];
+    }
+    mesh.vertices.swap(vertices);
+}
+
+MeshOptimizationStats optimizeMesh(Mesh& mesh){
+    MeshOptimizationStats stats;
+    if(!mesh.hasIndexBuffer || mesh.optimized || mesh.indices.empty()) return stats;
+
+    // optimize each level separately, whole index buffer if mesh has no levels
+    std::vector<MeshLod> ranges = mesh.lods;
+    if(ranges.empty()) ranges.push_back(MeshLod{0, static_cast<uint32_t>(mesh.indices.size()), 0.f});
+
+    const uint32_t* fullDetail = &mesh.indices[ranges[0].firstIndex];
+    stats.acmrBefore = computeAcmr(fullDetail, ranges[0].indexCount);
+    stats.atvrBefore = computeAtvr(fullDetail, ranges[0].indexCount);
+
+    std::vector<uint32_t> cacheOptimized, overdrawOptimized;
+    for(const MeshLod& range : ranges){
+        uint32_t* indices = &mesh.indices[range.firstIndex];
+
+        cacheOptimized.resize(range.indexCount);
+        optimizeVertexCache(cacheOptimized.data(), indices, range.indexCount, mesh.vertices.size());
+
+        overdrawOptimized.resize(range.indexCount);
+        optimizeOverdraw(overdrawOptimized.data(), cacheOptimized.data(), range.indexCount, mesh.vertices);
+
+        std::copy(overdrawOptimized.begin(), overdrawOptimized.end(), indices);
+    }
+
+    optimizeVertexFetch(mesh);
+
+    fullDetail = &mesh.indices[ranges[0].firstIndex];
+    stats.acmrAfter = computeAcmr(fullDetail, ranges[0].indexCount);
+    stats.atvrAfter = computeAtvr(fullDetail, ranges[0].indexCount);
+
+    mesh.optimized = true;
+    return stats;
+}
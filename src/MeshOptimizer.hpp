@@ -0,0 +1,82 @@
+#ifndef MESH_OPTIMIZER_HPP
+#define MESH_OPTIMIZER_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "Vertex.hpp"
+
+struct Mesh;
+
+// vertex cache efficiency of full detail level before and after optimization
+struct MeshOptimizationStats {
+    // average cache miss ratio, vertex shader invocations per triangle (0.5 to 3)
+    float acmrBefore = 0.f, acmrAfter = 0.f;
+    // average transform to vertex ratio, vertex shader invocations per vertex (1 is ideal)
+    float atvrBefore = 0.f, atvrAfter = 0.f;
+};
+
+/**
+ * @brief Average cache miss ratio of triangle list for a FIFO vertex cache.
+ *
+ * @param indices Triangle list.
+ * @param indexCount Number of indices in triangle list.
+ * @param cacheSize Number of entries in simulated post transform cache.
+ * @return float Cache misses per triangle.
+ * */
+float computeAcmr(const uint32_t* indices, size_t indexCount, uint32_t cacheSize = 16);
+
+/**
+ * @brief Average transform to vertex ratio of triangle list for a FIFO vertex cache.
+ *
+ * @param indices Triangle list.
+ * @param indexCount Number of indices in triangle list.
+ * @param cacheSize Number of entries in simulated post transform cache.
+ * @return float Cache misses per unique referenced vertex.
+ * */
+float computeAtvr(const uint32_t* indices, size_t indexCount, uint32_t cacheSize = 16);
+
+/**
+ * @brief Reorder triangles to maximize post transform vertex cache hits.
+ * Uses Forsyth's linear speed vertex cache optimization.
+ *
+ * @param[out] dst Reordered triangle list, must not alias indices.
+ * @param[in] indices Triangle list.
+ * @param[in] indexCount Number of indices in triangle list.
+ * @param[in] vertexCount Number of vertices referenced by indices.
+ * */
+void optimizeVertexCache(uint32_t* dst, const uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+/**
+ * @brief Reorder clusters of triangles so outward facing ones are drawn first.
+ * Triangle list is split into clusters at points where vertex cache is
+ * cold anyway, so cache efficiency degrades by at most given threshold.
+ * Must be run after optimizeVertexCache().
+ *
+ * @param[out] dst Reordered triangle list, must not alias indices.
+ * @param[in] indices Triangle list.
+ * @param[in] indexCount Number of indices in triangle list.
+ * @param[in] vertices Vertex array referenced by indices.
+ * @param[in] threshold Allowed ACMR increase of a cluster, 1.05 means 5%.
+ * */
+void optimizeOverdraw(uint32_t* dst, const uint32_t* indices, size_t indexCount,
+                      const std::vector<Vertex>& vertices, float threshold = 1.05f);
+
+/**
+ * @brief Reorder vertices in order of first use by index buffer.
+ * Unreferenced vertices are removed.
+ *
+ * @param mesh Mesh to reorder vertices of.
+ * */
+void optimizeVertexFetch(Mesh& mesh);
+
+/**
+ * @brief Run all optimizations on every level of detail of given mesh.
+ * Does nothing for meshes without index buffer or already optimized meshes.
+ *
+ * @param mesh Mesh to optimize.
+ * @return MeshOptimizationStats Cache efficiency before and after optimization.
+ * */
+MeshOptimizationStats optimizeMesh(Mesh& mesh);
+
+#endif//MESH_OPTIMIZER_HPP
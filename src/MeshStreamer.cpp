@@ -0,0 +1,133 @@
+#include "MeshStreamer.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <iostream>
+
+namespace {
+
+// priority of meshes no object is using right now
+constexpr float unusedPriority = std::numeric_limits<float>::max();
+
+} // namespace
+
+void MeshStreamer::init(uint32_t workerCount){
+    if(workerCount == 0){
+        // leave rest of cores to main loop and parallel loops
+        workerCount = std::max(1u, std::thread::hardware_concurrency() / 2);
+    }
+
+    stopping = false;
+    workers.reserve(workerCount);
+    for(uint32_t i = 0; i < workerCount; i++){
+        workers.emplace_back(&MeshStreamer::work, this);
+    }
+}
+
+void MeshStreamer::destroy(){
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeup.notify_all();
+
+    for(std::thread& worker : workers){
+        worker.join();
+    }
+    workers.clear();
+
+    waiting.clear();
+    loading.clear();
+    loaded.clear();
+}
+
+void MeshStreamer::request(MeshHandle target, const std::string& path, VertexFormat format){
+    Request request;
+    request.target = target;
+    request.path = path;
+    request.format = format;
+    request.priority = unusedPriority;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        waiting.push_back(std::move(request));
+    }
+    wakeup.notify_one();
+}
+
+void MeshStreamer::updatePriorities(const DistanceMap& distances){
+    auto priorityOf = [&](MeshHandle mesh){
+        auto it = distances.find(mesh);
+        return it != distances.end() ? it->second : unusedPriority;
+    };
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for(Request& request : waiting){
+        request.priority = priorityOf(request.target);
+    }
+    for(auto& [mesh, priority] : loading){
+        priority = priorityOf(mesh);
+    }
+    for(auto& [priority, mesh] : loaded){
+        priority = priorityOf(mesh.target);
+    }
+}
+
+void MeshStreamer::collectLoaded(ArenaVector<LoadedMesh>& result, size_t maxCount){
+    std::lock_guard<std::mutex> lock(mutex);
+    if(loaded.empty()) return;
+
+    // nearest meshes first, rest stays for next call
+    size_t count = std::min(maxCount, loaded.size());
+    std::partial_sort(loaded.begin(), loaded.begin() + count, loaded.end(),
+                      [](const auto& a, const auto& b){ return a.first < b.first; });
+
+    for(size_t i = 0; i < count; i++){
+        result.push_back(std::move(loaded[i].second));
+    }
+    loaded.erase(loaded.begin(), loaded.begin() + count);
+}
+
+bool MeshStreamer::isPending(MeshHandle target){
+    std::lock_guard<std::mutex> lock(mutex);
+    if(loading.count(target)) return true;
+    for(const Request& request : waiting){
+        if(request.target == target) return true;
+    }
+    for(const auto& [priority, mesh] : loaded){
+        if(mesh.target == target) return true;
+    }
+    return false;
+}
+
+void MeshStreamer::work(){
+    while(true){
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeup.wait(lock, [this](){ return stopping || !waiting.empty(); });
+            if(stopping) return;
+
+            // serve nearest request, there are only a few waiting at a time
+            auto nearest = std::min_element(waiting.begin(), waiting.end(),
+                [](const Request& a, const Request& b){ return a.priority < b.priority; });
+            request = std::move(*nearest);
+            waiting.erase(nearest);
+            loading[request.target] = request.priority;
+        }
+
+        // do all cpu side processing here, so upload only has to copy
+        LoadedMesh result;
+        result.target = request.target;
+        result.mesh.format = request.format;
+        if(openCachedMeshFile(request.path, request.format, result.file, &result.mesh) == FAILED){
+            std::cerr << "[ERROR] Failed to stream mesh " << request.path << std::endl;
+            result.failed = true;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        float priority = loading[request.target];
+        loading.erase(request.target);
+        loaded.emplace_back(priority, std::move(result));
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef MESH_STREAMER_HPP
+#define MESH_STREAMER_HPP
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+
+#include "Mesh.hpp"
+#include "MeshFile.hpp"
+#include "FrameArena.hpp"
+
+/**
+ * @brief Loads meshes from disk on worker threads.
+ * Requests are served nearest first, priorities can be updated while
+ * requests wait. Workers map binary mesh files, building the cache of
+ * obj files if needed, so only uploading is left for the thread owning
+ * the renderer. Target meshes are never touched by workers,
+ * loaded data is handed over through collectLoaded().
+ * */
+class MeshStreamer {
+public:
+    /**
+     * @brief Start worker threads.
+     *
+     * @param workerCount Number of workers, 0 to use half of host cores.
+     * */
+    void init(uint32_t workerCount = 0);
+
+    /**
+     * @brief Stop worker threads. Requests not yet loaded are dropped.
+     * Blocks until files being parsed are done.
+     * */
+    void destroy();
+
+    /**
+     * @brief Queue loading of an obj file into given mesh.
+     *
+     * @param target Mesh to load into, collector has to check it still exists.
+     * @param path Path of obj or binary mesh file.
+     * @param format Vertex format mesh is going to be uploaded with.
+     * */
+    void request(MeshHandle target, const std::string& path, VertexFormat format);
+
+    // distance from camera of nearest object using each mesh, built every frame
+    using DistanceMap = ArenaUnorderedMap<MeshHandle, float>;
+
+    /**
+     * @brief Update priorities of waiting requests.
+     * Requests of meshes not in given map are served last.
+     *
+     * @param distances Distance from camera of nearest object using each mesh.
+     * */
+    void updatePriorities(const DistanceMap& distances);
+
+    // a loaded mesh, ready for upload
+    struct LoadedMesh {
+        MeshHandle target;
+        // mapped binary file of mesh
+        MappedMeshFile file;
+        // parsed mesh, used only if file isn't open
+        Mesh mesh;
+        bool failed = false;
+    };
+
+    /**
+     * @brief Take meshes loaded by workers since last call, nearest first.
+     *
+     * @param[out] loaded Loaded meshes are appended here.
+     * @param maxCount Maximum number of meshes to take, rest is kept for next call.
+     * */
+    void collectLoaded(ArenaVector<LoadedMesh>& loaded, size_t maxCount);
+
+    /**
+     * @brief Check if given mesh has a request that isn't collected yet.
+     * */
+    bool isPending(MeshHandle target);
+private:
+    struct Request {
+        MeshHandle target;
+        std::string path;
+        VertexFormat format = VertexFormat::Float;
+        // distance from camera, lower is served first
+        float priority = 0.f;
+    };
+
+    // worker thread loop
+    void work();
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stopping = false;
+
+    // requests waiting for a worker
+    std::vector<Request> waiting;
+    // requests being parsed right now, with their current priority
+    std::unordered_map<MeshHandle, float> loading;
+    // meshes parsed and waiting to be collected
+    std::vector<std::pair<float, LoadedMesh>> loaded;
+};
+
+#endif//MESH_STREAMER_HPP
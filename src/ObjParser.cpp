@@ -0,0 +1,343 @@
+#include "ObjParser.hpp"
+#include "Parallel.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+
+// chunks are at least this big, smaller ones aren't worth a thread
+constexpr size_t minChunkSize = 1 << 20;
+// upper limit of chunks, so per chunk arrays don't cost more than they save
+constexpr size_t maxChunkCount = 1024;
+
+// exactly representable powers of ten
+constexpr double powersOf10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline void skipSpaces(const char*& p, const char* end){
+    while(p < end && isSpace(*p)) p++;
+}
+
+inline void skipLine(const char*& p, const char* end){
+    const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+    p = eol != nullptr ? eol + 1 : end;
+}
+
+inline int32_t parseInt(const char*& p, const char* end){
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')){
+        negative = *p == '-';
+        p++;
+    }
+
+    int32_t value = 0;
+    while(p < end && isDigit(*p)){
+        value = value * 10 + (*p - '0');
+        p++;
+    }
+    return negative ? -value : value;
+}
+
+// components of a face corner index
+enum ObjComponent : uint8_t {
+    VertexComponent = 1,
+    NormalComponent = 2,
+    TexcoordComponent = 4,
+};
+
+// geometry of a line aligned piece of obj file
+struct ObjChunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    ObjData data;
+    // corners whose indices were relative to end of attribute arrays at that line,
+    // they are stored relative to start of chunk and rebased when merging
+    std::vector<std::pair<size_t, uint8_t>> relativeCorners;
+    // set if a face had a zero index, which obj doesn't allow
+    bool invalid = false;
+};
+
+// convert obj index of an attribute to zero based index
+// returns true if index is relative and has to be rebased
+inline bool resolveIndex(int32_t index, size_t localCount, int32_t& resolved, bool& invalid){
+    if(index > 0){
+        resolved = index - 1;
+        return false;
+    }
+    if(index == 0) invalid = true;
+    resolved = static_cast<int32_t>(localCount) + index;
+    return true;
+}
+
+// parse all lines of a chunk
+void parseChunk(ObjChunk& chunk){
+    const char* p = chunk.begin;
+    const char* end = chunk.end;
+    ObjData& data = chunk.data;
+
+    // rough guess, about 30 bytes per line with a float or index triple
+    size_t estimatedLines = (end - p) / 30;
+    data.positions.reserve(estimatedLines * 3 / 2);
+    data.corners.reserve(estimatedLines * 3 / 2);
+
+    while(p < end){
+        skipSpaces(p, end);
+        if(p + 1 >= end){
+            p = end;
+            break;
+        }
+
+        if(p[0] == 'v' && isSpace(p[1])){
+            // position, optional w and vertex colors are ignored
+            p += 2;
+            for(int i = 0; i < 3; i++){
+                skipSpaces(p, end);
+                data.positions.push_back(parseObjFloat(p, end));
+            }
+        }else if(p[0] == 'v' && p[1] == 'n' && p + 2 < end && isSpace(p[2])){
+            p += 3;
+            for(int i = 0; i < 3; i++){
+                skipSpaces(p, end);
+                data.normals.push_back(parseObjFloat(p, end));
+            }
+        }else if(p[0] == 'v' && p[1] == 't' && p + 2 < end && isSpace(p[2])){
+            // optional w coordinate is ignored
+            p += 3;
+            for(int i = 0; i < 2; i++){
+                skipSpaces(p, end);
+                data.texcoords.push_back(parseObjFloat(p, end));
+            }
+        }else if(p[0] == 'f' && isSpace(p[1])){
+            // corners are v, v/t, v//n or v/t/n
+            p += 2;
+            uint32_t faceSize = 0;
+            while(true){
+                skipSpaces(p, end);
+                if(p >= end || !(isDigit(*p) || *p == '-' || *p == '+')) break;
+
+                ObjIndex corner;
+                uint8_t relative = 0;
+                if(resolveIndex(parseInt(p, end), data.positions.size() / 3, corner.vertex, chunk.invalid)){
+                    relative |= VertexComponent;
+                }
+                if(p < end && *p == '/'){
+                    p++;
+                    if(p < end && *p != '/'){
+                        if(resolveIndex(parseInt(p, end), data.texcoords.size() / 2, corner.texcoord, chunk.invalid)){
+                            relative |= TexcoordComponent;
+                        }
+                    }
+                    if(p < end && *p == '/'){
+                        p++;
+                        if(resolveIndex(parseInt(p, end), data.normals.size() / 3, corner.normal, chunk.invalid)){
+                            relative |= NormalComponent;
+                        }
+                    }
+                }
+
+                if(relative != 0) chunk.relativeCorners.emplace_back(data.corners.size(), relative);
+                data.corners.push_back(corner);
+                faceSize++;
+            }
+            data.faceSizes.push_back(faceSize);
+        }
+
+        // rest of line, comments and unsupported statements
+        skipLine(p, end);
+    }
+}
+
+// copy array of a chunk to its place in merged array
+template<typename T>
+inline void copyRange(std::vector<T>& dst, size_t offset, const std::vector<T>& src){
+    if(!src.empty()) memcpy(dst.data() + offset, src.data(), src.size() * sizeof(T));
+}
+
+// check that an index refers to an existing element, -1 means not present
+inline bool isIndexValid(int32_t index, size_t count){
+    return index >= -1 && (index < 0 || static_cast<size_t>(index) < count);
+}
+
+} // namespace
+
+float parseObjFloat(const char*& p, const char* end){
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')){
+        negative = *p == '-';
+        p++;
+    }
+
+    // accumulate up to 19 significant digits, rest only shifts exponent
+    uint64_t mantissa = 0;
+    int32_t exponent = 0;
+    int32_t digits = 0;
+    while(p < end && isDigit(*p)){
+        if(digits < 19){
+            mantissa = mantissa * 10 + (*p - '0');
+            if(mantissa != 0) digits++;
+        }else exponent++;
+        p++;
+    }
+
+    if(p < end && *p == '.'){
+        p++;
+        while(p < end && isDigit(*p)){
+            if(digits < 19){
+                mantissa = mantissa * 10 + (*p - '0');
+                if(mantissa != 0) digits++;
+                exponent--;
+            }
+            p++;
+        }
+    }
+
+    if(p < end && (*p == 'e' || *p == 'E')){
+        const char* start = p++;
+        if(p < end && (isDigit(*p) || ((*p == '-' || *p == '+') && p + 1 < end && isDigit(p[1])))){
+            exponent += parseInt(p, end);
+        }else p = start;
+    }
+
+    double value = static_cast<double>(mantissa);
+    if(mantissa != 0 && exponent != 0){
+        int32_t magnitude = exponent < 0 ? -exponent : exponent;
+        double scale = magnitude <= 22 ? powersOf10[magnitude] : std::pow(10.0, magnitude);
+        value = exponent < 0 ? value / scale : value * scale;
+    }
+
+    return static_cast<float>(negative ? -value : value);
+}
+
+ReturnCode parseObj(const char* text, size_t size, ObjData& data, size_t maxThreads){
+    data = ObjData{};
+    if(size == 0) return SUCCESS;
+
+    // split text at line ends close to evenly spaced positions
+    size_t chunkCount = std::min(std::max<size_t>(size / minChunkSize, 1), maxChunkCount);
+    std::vector<ObjChunk> chunks(chunkCount);
+    const char* end = text + size;
+    const char* begin = text;
+    for(size_t c = 0; c < chunkCount; c++){
+        const char* split = c + 1 == chunkCount ? end : text + size * (c + 1) / chunkCount;
+        if(split < begin) split = begin;
+        if(split < end){
+            const char* eol = static_cast<const char*>(memchr(split, '\n', end - split));
+            split = eol != nullptr ? eol + 1 : end;
+        }
+
+        chunks[c].begin = begin;
+        chunks[c].end = split;
+        begin = split;
+    }
+
+    parallelFor(chunkCount, [&](size_t c){ parseChunk(chunks[c]); }, maxThreads);
+
+    // offsets of chunks in merged arrays are prefix sums of chunk sizes
+    struct ChunkOffsets { size_t positions, normals, texcoords, corners, faces; };
+    std::vector<ChunkOffsets> offsets(chunkCount + 1, ChunkOffsets{0, 0, 0, 0, 0});
+    for(size_t c = 0; c < chunkCount; c++){
+        const ObjData& chunkData = chunks[c].data;
+        offsets[c + 1].positions = offsets[c].positions + chunkData.positions.size();
+        offsets[c + 1].normals = offsets[c].normals + chunkData.normals.size();
+        offsets[c + 1].texcoords = offsets[c].texcoords + chunkData.texcoords.size();
+        offsets[c + 1].corners = offsets[c].corners + chunkData.corners.size();
+        offsets[c + 1].faces = offsets[c].faces + chunkData.faceSizes.size();
+    }
+
+    const ChunkOffsets& total = offsets[chunkCount];
+    data.positions.resize(total.positions);
+    data.normals.resize(total.normals);
+    data.texcoords.resize(total.texcoords);
+    data.corners.resize(total.corners);
+    data.faceSizes.resize(total.faces);
+
+    size_t positionCount = total.positions / 3, normalCount = total.normals / 3, texcoordCount = total.texcoords / 2;
+
+    // chunks are copied to their place in parallel, relative indices are rebased on the way
+    std::atomic<bool> valid{true};
+    parallelFor(chunkCount, [&](size_t c){
+        ObjChunk& chunk = chunks[c];
+        const ChunkOffsets& offset = offsets[c];
+        copyRange(data.positions, offset.positions, chunk.data.positions);
+        copyRange(data.normals, offset.normals, chunk.data.normals);
+        copyRange(data.texcoords, offset.texcoords, chunk.data.texcoords);
+        copyRange(data.corners, offset.corners, chunk.data.corners);
+        copyRange(data.faceSizes, offset.faces, chunk.data.faceSizes);
+
+        ObjIndex* corners = data.corners.data() + offset.corners;
+        for(const auto& [corner, components] : chunk.relativeCorners){
+            if(components & VertexComponent) corners[corner].vertex += static_cast<int32_t>(offset.positions / 3);
+            if(components & NormalComponent) corners[corner].normal += static_cast<int32_t>(offset.normals / 3);
+            if(components & TexcoordComponent) corners[corner].texcoord += static_cast<int32_t>(offset.texcoords / 2);
+        }
+
+        bool chunkValid = !chunk.invalid;
+        for(size_t i = 0; i < chunk.data.corners.size() && chunkValid; i++){
+            chunkValid = corners[i].vertex >= 0 && isIndexValid(corners[i].vertex, positionCount) &&
+                         isIndexValid(corners[i].normal, normalCount) &&
+                         isIndexValid(corners[i].texcoord, texcoordCount);
+        }
+        if(!chunkValid) valid = false;
+
+        // free chunk memory early, merged arrays are as big
+        chunk.data = ObjData{};
+    }, maxThreads);
+
+    if(!valid){
+        std::cerr << "[ERROR] Obj face refers to a missing vertex attribute" << std::endl;
+        data = ObjData{};
+        return FAILED;
+    }
+
+    return SUCCESS;
+}
+
+ReturnCode parseObjFile(const char* filename, ObjData& data, size_t maxThreads){
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0){
+        std::cerr << "[ERROR] Failed to open obj file " << filename << std::endl;
+        return FAILED;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0){
+        close(fd);
+        return FAILED;
+    }
+
+    size_t size = static_cast<size_t>(info.st_size);
+    if(size == 0){
+        close(fd);
+        data = ObjData{};
+        return SUCCESS;
+    }
+
+    // mapping stays valid after closing descriptor
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED){
+        std::cerr << "[ERROR] Failed to map obj file " << filename << std::endl;
+        return FAILED;
+    }
+
+    // chunks are read concurrently, so ask for whole file to be read ahead
+    madvise(mapped, size, MADV_WILLNEED);
+
+    ReturnCode result = parseObj(static_cast<const char*>(mapped), size, data, maxThreads);
+    munmap(mapped, size);
+    return result;
+}
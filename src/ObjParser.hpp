@@ -0,0 +1,70 @@
+#ifndef OBJ_PARSER_HPP
+#define OBJ_PARSER_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "ReturnCode.hpp"
+
+// position, normal and texture coordinate indices of a face corner in obj file
+// indices are zero based, -1 if corner doesn't have that attribute
+struct ObjIndex {
+    int32_t vertex = -1;
+    int32_t normal = -1;
+    int32_t texcoord = -1;
+
+    bool operator==(const ObjIndex& other) const {
+        return vertex == other.vertex && normal == other.normal && texcoord == other.texcoord;
+    }
+};
+
+// geometry of an obj file, all objects and groups are merged
+struct ObjData {
+    // 3 floats per position
+    std::vector<float> positions;
+    // 3 floats per normal
+    std::vector<float> normals;
+    // 2 floats per texture coordinate
+    std::vector<float> texcoords;
+    // corners of all faces, one face after another
+    std::vector<ObjIndex> corners;
+    // number of corners of every face
+    std::vector<uint32_t> faceSizes;
+};
+
+/**
+ * @brief Parse a float, without locale and without allocating.
+ * Accepts optional sign, digits, fraction and exponent.
+ *
+ * @param[in,out] p Start of number, moved past it.
+ * @param[in] end End of text.
+ * @return float Parsed value, 0 if there's no number at p.
+ * */
+float parseObjFloat(const char*& p, const char* end);
+
+/**
+ * @brief Parse obj text in memory.
+ * Text is split into line aligned chunks that are parsed in parallel,
+ * per chunk arrays are merged with prefix sums of their sizes.
+ * Only v, vn, vt and f statements are read, everything else is skipped.
+ *
+ * @param[in] text Obj file contents.
+ * @param[in] size Size of text in bytes.
+ * @param[out] data Parsed geometry.
+ * @param[in] maxThreads Number of threads to use, 0 to use all cores.
+ * @return SUCCESS on success, FAILED if a face refers to a missing attribute.
+ * */
+ReturnCode parseObj(const char* text, size_t size, ObjData& data, size_t maxThreads = 0);
+
+/**
+ * @brief Memory map an obj file and parse it in parallel.
+ *
+ * @param[in] filename Path of obj file.
+ * @param[out] data Parsed geometry.
+ * @param[in] maxThreads Number of threads to use, 0 to use all cores.
+ * @return SUCCESS on success, FAILED if file can't be read or is malformed.
+ * */
+ReturnCode parseObjFile(const char* filename, ObjData& data, size_t maxThreads = 0);
+
+#endif//OBJ_PARSER_HPP
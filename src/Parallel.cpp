@@ -0,0 +1,37 @@
+#include "Parallel.hpp"
+#include "JobSystem.hpp"
+
+#include <atomic>
+#include <algorithm>
+
+void parallelFor(size_t count, const std::function<void(size_t)>& func, size_t maxThreads){
+    if(count == 0) return;
+
+    // don't start more jobs than there is work
+    JobSystem& jobSystem = getJobSystem();
+    size_t numThreads = jobSystem.getWorkerCount() + 1;
+    if(maxThreads > 0) numThreads = std::min(numThreads, maxThreads);
+    numThreads = std::min(numThreads, count);
+
+    // nothing to gain from jobs in this case
+    if(numThreads == 1){
+        for(size_t i = 0; i < count; i++) func(i);
+        return;
+    }
+
+    // each job keeps picking next unprocessed index
+    std::atomic<size_t> next{0};
+    auto worker = [&](){
+        for(size_t i = next++; i < count; i = next++){
+            func(i);
+        }
+    };
+
+    // calling thread works too, and runs other jobs while it waits for rest
+    JobCounter counter;
+    for(size_t t = 0; t < numThreads - 1; t++){
+        jobSystem.run(&counter, [&worker](){ worker(); });
+    }
+    worker();
+    jobSystem.wait(counter);
+}
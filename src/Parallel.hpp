@@ -0,0 +1,19 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * @brief Call func(i) for every i in [0, count) using all cores of host.
+ * Calls are distributed dynamically over workers of getJobSystem(), so
+ * uneven work per index is balanced automatically. Can be called from
+ * inside jobs. Returns after all calls are complete.
+ *
+ * @param count Number of indices to process.
+ * @param func Function to call for each index.
+ * @param maxThreads Maximum number of threads to use, 0 to use all cores.
+ * */
+void parallelFor(size_t count, const std::function<void(size_t)>& func, size_t maxThreads = 0);
+
+#endif//PARALLEL_HPP
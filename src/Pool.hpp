@@ -0,0 +1,146 @@
+#ifndef POOL_HPP
+#define POOL_HPP
+
+#include <vector>
+#include <unordered_map>
+
+#include "Handle.hpp"
+#include "StringId.hpp"
+
+/**
+ * @brief Storage of elements referenced by generational handles.
+ * Elements are kept packed in one array, so iterating a pool walks contiguous
+ * memory. Handles point to slots, slots point into packed array. Destroying an
+ * element moves last element into its place, so handles stay valid but
+ * pointers returned by get() are valid only until next create() or destroy().
+ * Elements can optionally be registered under a name and found by it.
+ * */
+template<typename T>
+class Pool {
+public:
+    using HandleType = Handle<T>;
+
+    /**
+     * @brief Add an element to pool.
+     *
+     * @param element Element to move into pool.
+     * @param name Name to find element by, empty for none. Name of an existing
+     * element is moved over to the new one.
+     * @return HandleType Handle of element, null if pool is full.
+     * */
+    HandleType create(T&& element = T{}, StringId name = {}) {
+        uint32_t slot;
+        if(!freeSlots.empty()){
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }else{
+            if(slots.size() >= HandleType::maxSlots) return HandleType{};
+            slot = static_cast<uint32_t>(slots.size());
+            slots.push_back({0, 1});
+        }
+
+        slots[slot].item = static_cast<uint32_t>(items.size());
+        items.push_back(std::move(element));
+        itemSlots.push_back(slot);
+        itemNames.push_back(name);
+
+        HandleType handle = HandleType::make(slot, slots[slot].generation);
+        if(!name.isEmpty()){
+            auto [it, inserted] = names.emplace(name, handle);
+            if(!inserted){
+                // old element keeps existing, it's just not found by name anymore
+                if(isValid(it->second)) itemNames[slots[it->second.getIndex()].item] = StringId{};
+                it->second = handle;
+            }
+        }
+        return handle;
+    }
+
+    /**
+     * @brief Remove an element, its handle and all copies of it become invalid.
+     *
+     * @return bool false if handle wasn't valid.
+     * */
+    bool destroy(HandleType handle) {
+        if(!isValid(handle)) return false;
+
+        uint32_t slot = handle.getIndex();
+        uint32_t item = slots[slot].item;
+        if(!itemNames[item].isEmpty()) names.erase(itemNames[item]);
+
+        // fill hole with last element to keep array packed
+        uint32_t last = static_cast<uint32_t>(items.size() - 1);
+        if(item != last){
+            items[item] = std::move(items[last]);
+            itemSlots[item] = itemSlots[last];
+            itemNames[item] = itemNames[last];
+            slots[itemSlots[item]].item = item;
+        }
+        items.pop_back();
+        itemSlots.pop_back();
+        itemNames.pop_back();
+
+        // skip generation 0, so no valid handle is ever null
+        uint32_t& generation = slots[slot].generation;
+        generation = generation == HandleType::maxGeneration ? 1 : generation + 1;
+        freeSlots.push_back(slot);
+        return true;
+    }
+
+    /// remove all elements, all handles become invalid
+    void clear() {
+        while(!items.empty()) destroy(getHandle(items.size() - 1));
+    }
+
+    /// check in O(1) if handle refers to an element of pool
+    inline bool isValid(HandleType handle) const {
+        uint32_t slot = handle.getIndex();
+        return !handle.isNull() && slot < slots.size() && slots[slot].generation == handle.getGeneration();
+    }
+
+    /// get element, nullptr if handle isn't valid
+    inline T* get(HandleType handle) { return isValid(handle) ? &items[slots[handle.getIndex()].item] : nullptr; }
+    inline const T* get(HandleType handle) const { return isValid(handle) ? &items[slots[handle.getIndex()].item] : nullptr; }
+
+    /// find element by name, null handle if there's none
+    inline HandleType find(StringId name) const {
+        auto it = names.find(name);
+        return it != names.end() ? it->second : HandleType{};
+    }
+
+    /// handle of element at given position of packed array
+    inline HandleType getHandle(size_t item) const {
+        uint32_t slot = itemSlots[item];
+        return HandleType::make(slot, slots[slot].generation);
+    }
+
+    inline size_t size() const { return items.size(); }
+    inline bool empty() const { return items.empty(); }
+
+    // iterate packed elements
+    inline T& operator[](size_t item) { return items[item]; }
+    inline const T& operator[](size_t item) const { return items[item]; }
+    inline typename std::vector<T>::iterator begin() { return items.begin(); }
+    inline typename std::vector<T>::iterator end() { return items.end(); }
+    inline typename std::vector<T>::const_iterator begin() const { return items.begin(); }
+    inline typename std::vector<T>::const_iterator end() const { return items.end(); }
+
+private:
+    struct Slot {
+        // position of element in packed array
+        uint32_t item = 0;
+        uint32_t generation = 1;
+    };
+
+    // packed elements, with slot and name of each
+    std::vector<T> items;
+    std::vector<uint32_t> itemSlots;
+    std::vector<StringId> itemNames;
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+
+    std::unordered_map<StringId, HandleType> names;
+};
+
+#endif//POOL_HPP
@@ -0,0 +1,306 @@
+#include "Primitives.hpp"
+#include "Math.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+// primitives are colored per object, vertices are left white
+const glm::vec3 white = glm::vec3(1.f);
+
+// clear mesh and reserve exact space for primitive
+void beginPrimitive(Mesh& mesh, size_t vertexCount, size_t indexCount){
+    mesh.vertices.clear();
+    mesh.indices.clear();
+    mesh.vertices.reserve(vertexCount);
+    mesh.indices.reserve(indexCount);
+    mesh.hasIndexBuffer = true;
+}
+
+uint32_t addVertex(Mesh& mesh, const glm::vec3& position, const glm::vec3& normal){
+    mesh.vertices.push_back({position, white, normal});
+    return static_cast<uint32_t>(mesh.vertices.size() - 1);
+}
+
+// triangle facing side its vertices are anticlockwise from
+void addTriangle(Mesh& mesh, uint32_t a, uint32_t b, uint32_t c){
+    mesh.indices.insert(mesh.indices.end(), {a, b, c});
+}
+
+// quad of four vertices going around it, split along a-c diagonal
+void addQuad(Mesh& mesh, uint32_t a, uint32_t b, uint32_t c, uint32_t d){
+    mesh.indices.insert(mesh.indices.end(), {a, b, c, a, c, d});
+}
+
+const char* getPrimitiveTypeName(PrimitiveType type){
+    switch(type){
+        case PrimitiveType::UVSphere: return "uvsphere";
+        case PrimitiveType::Icosphere: return "icosphere";
+        case PrimitiveType::Cube: return "cube";
+        case PrimitiveType::Cylinder: return "cylinder";
+        case PrimitiveType::Cone: return "cone";
+        case PrimitiveType::Torus: return "torus";
+        case PrimitiveType::Grid: return "grid";
+    }
+    return "unknown";
+}
+
+} // namespace
+
+void createPrimitive(Mesh& mesh, PrimitiveType type, uint32_t tessellation){
+    switch(type){
+        case PrimitiveType::UVSphere: createUVSphere(mesh, tessellation); break;
+        case PrimitiveType::Icosphere: createIcosphere(mesh, tessellation); break;
+        case PrimitiveType::Cube: createCube(mesh, tessellation); break;
+        case PrimitiveType::Cylinder: createCylinder(mesh, tessellation); break;
+        case PrimitiveType::Cone: createCone(mesh, tessellation); break;
+        case PrimitiveType::Torus: createTorus(mesh, tessellation); break;
+        case PrimitiveType::Grid: createGrid(mesh, tessellation); break;
+    }
+}
+
+uint32_t clampTessellation(PrimitiveType type, uint32_t tessellation){
+    switch(type){
+        case PrimitiveType::UVSphere:
+        case PrimitiveType::Cylinder:
+        case PrimitiveType::Cone:
+        case PrimitiveType::Torus: return std::max(tessellation, 3u);
+        case PrimitiveType::Cube:
+        case PrimitiveType::Grid: return std::max(tessellation, 1u);
+        case PrimitiveType::Icosphere: return std::min(tessellation, maxIcosphereSubdivisions);
+    }
+    return tessellation;
+}
+
+std::string getPrimitiveName(PrimitiveType type, uint32_t tessellation){
+    return std::string("primitive/") + getPrimitiveTypeName(type) + "/" + std::to_string(tessellation);
+}
+
+void createUVSphere(Mesh& mesh, uint32_t segments){
+    segments = std::max(segments, 3u);
+    uint32_t rings = std::max(segments / 2, 2u);
+
+    SinCosTable around(segments, 2.f * PI);
+    SinCosTable down(rings, PI);
+
+    beginPrimitive(mesh, 2 + size_t(rings - 1) * segments, size_t(rings - 1) * segments * 6);
+
+    // poles and rings between them, normal of unit sphere is its position
+    uint32_t top = addVertex(mesh, {0.f, 1.f, 0.f}, {0.f, 1.f, 0.f});
+    for(uint32_t k = 1; k < rings; k++){
+        for(uint32_t i = 0; i < segments; i++){
+            glm::vec3 p(down.sines[k] * around.cosines[i], down.cosines[k], down.sines[k] * around.sines[i]);
+            addVertex(mesh, p, p);
+        }
+    }
+    uint32_t bottom = addVertex(mesh, {0.f, -1.f, 0.f}, {0.f, -1.f, 0.f});
+
+    auto ring = [&](uint32_t k, uint32_t i){ return 1 + (k - 1) * segments + i % segments; };
+
+    for(uint32_t i = 0; i < segments; i++){
+        addTriangle(mesh, top, ring(1, i + 1), ring(1, i));
+    }
+    for(uint32_t k = 1; k + 1 < rings; k++){
+        for(uint32_t i = 0; i < segments; i++){
+            addQuad(mesh, ring(k, i), ring(k, i + 1), ring(k + 1, i + 1), ring(k + 1, i));
+        }
+    }
+    for(uint32_t i = 0; i < segments; i++){
+        addTriangle(mesh, ring(rings - 1, i), ring(rings - 1, i + 1), bottom);
+    }
+}
+
+void createIcosphere(Mesh& mesh, uint32_t subdivisions){
+    subdivisions = std::min(subdivisions, maxIcosphereSubdivisions);
+
+    // every subdivision splits each triangle in four
+    size_t faceCount = size_t(20) << (2 * subdivisions);
+    beginPrimitive(mesh, faceCount / 2 + 2, faceCount * 3);
+
+    // icosahedron from three orthogonal golden rectangles
+    const float t = (1.f + std::sqrt(5.f)) / 2.f;
+    const glm::vec3 corners[12] = {
+        {-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+        {0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+        {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}
+    };
+    for(const glm::vec3& corner : corners){
+        glm::vec3 p = glm::normalize(corner);
+        addVertex(mesh, p, p);
+    }
+
+    mesh.indices = {
+        0, 11, 5,  0, 5, 1,  0, 1, 7,  0, 7, 10,  0, 10, 11,
+        1, 5, 9,  5, 11, 4,  11, 10, 2,  10, 7, 6,  7, 1, 8,
+        3, 9, 4,  3, 4, 2,  3, 2, 6,  3, 6, 8,  3, 8, 9,
+        4, 9, 5,  2, 4, 11,  6, 2, 10,  8, 6, 7,  9, 8, 1
+    };
+
+    // edges shared by two triangles get a single midpoint
+    std::unordered_map<uint64_t, uint32_t> midpoints;
+    auto midpoint = [&](uint32_t a, uint32_t b){
+        uint64_t key = (uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+        auto [it, inserted] = midpoints.emplace(key, 0);
+        if(inserted){
+            glm::vec3 p = glm::normalize(mesh.vertices[a].position + mesh.vertices[b].position);
+            it->second = addVertex(mesh, p, p);
+        }
+        return it->second;
+    };
+
+    std::vector<uint32_t> subdivided;
+    for(uint32_t s = 0; s < subdivisions; s++){
+        midpoints.clear();
+        midpoints.reserve(mesh.indices.size() / 2);
+        subdivided.clear();
+        subdivided.reserve(mesh.indices.size() * 4);
+        for(size_t f = 0; f < mesh.indices.size(); f += 3){
+            uint32_t a = mesh.indices[f], b = mesh.indices[f + 1], c = mesh.indices[f + 2];
+            uint32_t ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+            subdivided.insert(subdivided.end(), {a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca});
+        }
+        mesh.indices.swap(subdivided);
+    }
+}
+
+void createCube(Mesh& mesh, uint32_t cells){
+    cells = std::max(cells, 1u);
+    uint32_t width = cells + 1;
+    beginPrimitive(mesh, 6 * size_t(width) * width, 6 * size_t(cells) * cells * 6);
+
+    // normal and two axes spanning every face, normal = cross(u, v)
+    const glm::vec3 faces[6][3] = {
+        {{ 1, 0, 0}, {0, 1, 0}, {0, 0, 1}},
+        {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}},
+        {{0,  1, 0}, {0, 0, 1}, {1, 0, 0}},
+        {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}},
+        {{0, 0,  1}, {1, 0, 0}, {0, 1, 0}},
+        {{0, 0, -1}, {0, 1, 0}, {1, 0, 0}}
+    };
+
+    float step = 2.f / cells;
+    for(const auto& [normal, u, v] : faces){
+        // faces don't share vertices, so their normals stay flat
+        uint32_t base = static_cast<uint32_t>(mesh.vertices.size());
+        for(uint32_t j = 0; j < width; j++){
+            for(uint32_t i = 0; i < width; i++){
+                addVertex(mesh, normal + (i * step - 1.f) * u + (j * step - 1.f) * v, normal);
+            }
+        }
+
+        for(uint32_t j = 0; j < cells; j++){
+            for(uint32_t i = 0; i < cells; i++){
+                uint32_t a = base + j * width + i;
+                addQuad(mesh, a, a + 1, a + width + 1, a + width);
+            }
+        }
+    }
+}
+
+void createCylinder(Mesh& mesh, uint32_t segments){
+    segments = std::max(segments, 3u);
+    SinCosTable around(segments, 2.f * PI);
+
+    // side rings and caps have separate vertices, caps are flat
+    beginPrimitive(mesh, 4 * size_t(segments) + 2, 12 * size_t(segments));
+
+    uint32_t side = static_cast<uint32_t>(mesh.vertices.size());
+    for(float y : {-1.f, 1.f}){
+        for(uint32_t i = 0; i < segments; i++){
+            glm::vec3 normal(around.cosines[i], 0.f, around.sines[i]);
+            addVertex(mesh, normal + glm::vec3(0.f, y, 0.f), normal);
+        }
+    }
+    for(uint32_t i = 0; i < segments; i++){
+        uint32_t next = (i + 1) % segments;
+        addQuad(mesh, side + i, side + segments + i, side + segments + next, side + next);
+    }
+
+    for(float y : {-1.f, 1.f}){
+        glm::vec3 normal(0.f, y, 0.f);
+        uint32_t center = addVertex(mesh, normal, normal);
+        for(uint32_t i = 0; i < segments; i++){
+            addVertex(mesh, {around.cosines[i], y, around.sines[i]}, normal);
+        }
+        for(uint32_t i = 0; i < segments; i++){
+            uint32_t a = center + 1 + i, b = center + 1 + (i + 1) % segments;
+            if(y < 0.f) addTriangle(mesh, center, a, b);
+            else addTriangle(mesh, center, b, a);
+        }
+    }
+}
+
+void createCone(Mesh& mesh, uint32_t segments){
+    segments = std::max(segments, 3u);
+    // even entries are around base, odd ones halfway between for normals at apex
+    SinCosTable around(2 * segments, 2.f * PI);
+
+    beginPrimitive(mesh, 3 * size_t(segments) + 1, 6 * size_t(segments));
+
+    // side normals lean up, slope of side is 2 units up per unit in
+    auto sideNormal = [&](uint32_t k){
+        return glm::normalize(glm::vec3(2.f * around.cosines[k], 1.f, 2.f * around.sines[k]));
+    };
+
+    // apex is split per segment so every side triangle is smoothly shaded
+    uint32_t base = static_cast<uint32_t>(mesh.vertices.size());
+    for(uint32_t i = 0; i < segments; i++){
+        addVertex(mesh, {around.cosines[2 * i], -1.f, around.sines[2 * i]}, sideNormal(2 * i));
+        addVertex(mesh, {0.f, 1.f, 0.f}, sideNormal(2 * i + 1));
+    }
+    for(uint32_t i = 0; i < segments; i++){
+        uint32_t next = (i + 1) % segments;
+        addTriangle(mesh, base + 2 * i, base + 2 * i + 1, base + 2 * next);
+    }
+
+    glm::vec3 down(0.f, -1.f, 0.f);
+    uint32_t center = addVertex(mesh, down, down);
+    for(uint32_t i = 0; i < segments; i++){
+        addVertex(mesh, {around.cosines[2 * i], -1.f, around.sines[2 * i]}, down);
+    }
+    for(uint32_t i = 0; i < segments; i++){
+        addTriangle(mesh, center, center + 1 + i, center + 1 + (i + 1) % segments);
+    }
+}
+
+void createTorus(Mesh& mesh, uint32_t segments){
+    segments = std::max(segments, 3u);
+    uint32_t tubeSegments = std::max(segments / 2, 3u);
+    const float radius = 0.8f;
+    const float tubeRadius = 0.2f;
+
+    SinCosTable around(segments, 2.f * PI);
+    SinCosTable tube(tubeSegments, 2.f * PI);
+
+    beginPrimitive(mesh, size_t(segments) * tubeSegments, size_t(segments) * tubeSegments * 6);
+
+    for(uint32_t i = 0; i < segments; i++){
+        glm::vec3 direction(around.cosines[i], 0.f, around.sines[i]);
+        for(uint32_t j = 0; j < tubeSegments; j++){
+            glm::vec3 normal = tube.cosines[j] * direction + glm::vec3(0.f, tube.sines[j], 0.f);
+            addVertex(mesh, radius * direction + tubeRadius * normal, normal);
+        }
+    }
+
+    auto vertex = [&](uint32_t i, uint32_t j){ return (i % segments) * tubeSegments + j % tubeSegments; };
+    for(uint32_t i = 0; i < segments; i++){
+        for(uint32_t j = 0; j < tubeSegments; j++){
+            addQuad(mesh, vertex(i, j), vertex(i, j + 1), vertex(i + 1, j + 1), vertex(i + 1, j));
+        }
+    }
+}
+
+void createGrid(Mesh& mesh, uint32_t cells){
+    cells = std::max(cells, 1u);
+    uint32_t width = cells + 1;
+    beginPrimitive(mesh, size_t(width) * width, size_t(cells) * cells * 6);
+
+    float step = 2.f / cells;
+    for(uint32_t j = 0; j < width; j++){
+        for(uint32_t i = 0; i < width; i++){
+            addVertex(mesh, {i * step - 1.f, 0.f, j * step - 1.f}, {0.f, 1.f, 0.f});
+        }
+    }
+    createGridIndices(mesh.indices, width, width);
+}
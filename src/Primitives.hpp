@@ -0,0 +1,75 @@
+#ifndef PRIMITIVES_HPP
+#define PRIMITIVES_HPP
+
+#include <string>
+
+#include "Mesh.hpp"
+
+// shapes of primitive library
+// all of them fit in [-1, 1] cube around origin and have white vertices,
+// so they're colored per object with RenderObject::setColor()
+enum class PrimitiveType : uint32_t {
+    // sphere of radius 1 made of rings, tessellation is number of segments around
+    UVSphere,
+    // sphere of radius 1 made of subdivided icosahedron, tessellation is number of subdivisions
+    Icosphere,
+    // cube of side 2 with flat faces, tessellation is number of cells along every edge
+    Cube,
+    // cylinder of radius 1 along y from -1 to 1, tessellation is number of segments around
+    Cylinder,
+    // cone of radius 1 with base at y = -1 and apex at y = 1, tessellation is number of segments around
+    Cone,
+    // torus of radius 0.8 around y with tube of radius 0.2, tessellation is number of segments around
+    Torus,
+    // flat square from -1 to 1 in x and z facing up, tessellation is number of cells along every edge
+    Grid
+};
+
+/**
+ * @brief Create a primitive of given type and tessellation in given mesh.
+ * Mesh is cleared first. Tessellation is clamped to smallest valid value of type.
+ *
+ * @param[out] mesh Mesh object to store vertex data into.
+ * @param type Shape of primitive.
+ * @param tessellation Level of detail, meaning depends on type.
+ * */
+void createPrimitive(Mesh& mesh, PrimitiveType type, uint32_t tessellation);
+
+/**
+ * @brief Clamp tessellation to range valid for type, like createPrimitive() does.
+ * Tessellations clamped to same value create same mesh.
+ * */
+uint32_t clampTessellation(PrimitiveType type, uint32_t tessellation);
+
+/**
+ * @brief Get name primitive of given type and tessellation is registered with in renderer.
+ *
+ * @return std::string Name like "primitive/icosphere/3".
+ * */
+std::string getPrimitiveName(PrimitiveType type, uint32_t tessellation);
+
+/// create sphere of rings with given number of segments around, half as many rings
+void createUVSphere(Mesh& mesh, uint32_t segments);
+
+/// most subdivisions of icosphere, every one of them quadruples its triangles
+constexpr uint32_t maxIcosphereSubdivisions = 8;
+
+/// create sphere by subdividing faces of icosahedron given number of times, at most maxIcosphereSubdivisions
+void createIcosphere(Mesh& mesh, uint32_t subdivisions);
+
+/// create cube whose faces have given number of cells along every edge
+void createCube(Mesh& mesh, uint32_t cells);
+
+/// create capped cylinder with given number of segments around
+void createCylinder(Mesh& mesh, uint32_t segments);
+
+/// create capped cone with given number of segments around
+void createCone(Mesh& mesh, uint32_t segments);
+
+/// create torus with given number of segments around, half as many around tube
+void createTorus(Mesh& mesh, uint32_t segments);
+
+/// create flat grid with given number of cells along every edge
+void createGrid(Mesh& mesh, uint32_t cells);
+
+#endif//PRIMITIVES_HPP
@@ -7,7 +7,13 @@
 // we can use this to send object model matrix many times since view and project remain same per frame
 struct PushData {
     glm::mat4 objectModelMatrix;
-    glm::mat4 normalMatrix;
+    // columns padded to vec4, same layout as mat3x4 in shaders
+    glm::mat3x4 normalMatrix;
+    // multiplied with vertex colors, so shared meshes can be drawn in different colors
+    glm::vec4 color;
 };
 
+// 128 bytes is minimum push constant size every device supports
+static_assert(sizeof(PushData) <= 128, "PushData must fit in guaranteed push constant range");
+
 #endif // PUSH_DATA_H_
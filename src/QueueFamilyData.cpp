@@ -7,39 +7,63 @@ QueueFamilyData::QueueFamilyData(VkPhysicalDevice physicalDevice, VkSurfaceKHR s
     std::vector<VkQueueFamilyProperties> qfProperties;
     getPhysicalDeviceQueueFamilyProperties(physicalDevice, qfProperties);
 
-    // check whether graphics and present queue are supported or not
+    // check surface support of every family first
+    std::vector<VkBool32> presentSupport(qfProperties.size(), VK_FALSE);
     for(uint32_t qidx = 0; qidx < qfProperties.size(); qidx++){
-        // check for graphics queue
-        if(qfProperties[qidx].queueFlags & VK_QUEUE_GRAPHICS_BIT){
-            graphicsQueueIdx = qidx;
+        VkResult res = vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, qidx, surface, &presentSupport[qidx]);
+        if(res != VK_SUCCESS){
+            std::cerr << "[ERROR] Failed to check for Surface support" << std::endl;
+            exit(1);
         }
+    }
 
-        // check for compute queue
-        if(qfProperties[qidx].queueFlags & VK_QUEUE_COMPUTE_BIT){
-            computeQueueIdx = qidx;
+    // graphics queue, prefer a family that can present too
+    for(uint32_t qidx = 0; qidx < qfProperties.size(); qidx++){
+        if(!(qfProperties[qidx].queueFlags & VK_QUEUE_GRAPHICS_BIT)) continue;
+
+        if(graphicsQueueIdx < 0) graphicsQueueIdx = qidx;
+        if(presentSupport[qidx] == VK_TRUE){
+            graphicsQueueIdx = qidx;
+            break;
         }
+    }
 
-        // check for transfer queue
-        if(qfProperties[qidx].queueFlags & VK_QUEUE_TRANSFER_BIT){
-            transferQueueIdx = qidx;
+    // present queue, same as graphics if possible
+    if(graphicsQueueIdx >= 0 && presentSupport[graphicsQueueIdx] == VK_TRUE){
+        presentQueueIdx = graphicsQueueIdx;
+    }else{
+        for(uint32_t qidx = 0; qidx < qfProperties.size(); qidx++){
+            if(presentSupport[qidx] == VK_TRUE){
+                presentQueueIdx = qidx;
+                break;
+            }
         }
+    }
 
-        // check for surface support queue
-        VkBool32 support = VK_FALSE;
-        VkResult res = vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, qidx, surface, &support);
-        if(res == VK_SUCCESS){
-            if(support == VK_TRUE) presentQueueIdx = qidx;
-        }else{
-            std::cerr << "[ERROR] Failed to check for Surface support" << std::endl;
-            exit(1);
+    // compute queue, prefer a compute only family so compute can overlap rendering
+    for(uint32_t qidx = 0; qidx < qfProperties.size(); qidx++){
+        VkQueueFlags flags = qfProperties[qidx].queueFlags;
+        if((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)){
+            computeQueueIdx = qidx;
+            break;
         }
+    }
+    if(computeQueueIdx < 0 && graphicsQueueIdx >= 0 &&
+       (qfProperties[graphicsQueueIdx].queueFlags & VK_QUEUE_COMPUTE_BIT)){
+        computeQueueIdx = graphicsQueueIdx;
+    }
 
-        // if we got all queues then break
-        if(graphicsQueueIdx >= 0 &&
-            computeQueueIdx >= 0 &&
-            transferQueueIdx >= 0 &&
-           presentQueueIdx >= 0){
+    // transfer queue, prefer a transfer only family (dma engine) so uploads can overlap rendering
+    for(uint32_t qidx = 0; qidx < qfProperties.size(); qidx++){
+        VkQueueFlags flags = qfProperties[qidx].queueFlags;
+        if((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))){
+            transferQueueIdx = qidx;
             break;
         }
     }
+    // graphics and compute families always support transfer, even if they don't report it
+    // a compute only family still runs transfers asynchronously to rendering
+    if(transferQueueIdx < 0){
+        transferQueueIdx = computeQueueIdx >= 0 ? computeQueueIdx : graphicsQueueIdx;
+    }
 }
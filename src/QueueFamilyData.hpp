@@ -23,12 +23,17 @@ struct QueueFamilyData{
 
     /// index of graphics queue
     int32_t graphicsQueueIdx = -1;
-    /// index of compute queue
+    /// index of compute queue, a compute only family if device has one
     int32_t computeQueueIdx = -1;
-    /// index of transfer queue
+    /// index of transfer queue, a transfer only family if device has one
     int32_t transferQueueIdx = -1;
     /// index of queue family that supports presenting rendered images to surface
     int32_t presentQueueIdx = -1;
+
+    /// true if transfers run on a different queue family than graphics
+    inline bool hasDedicatedTransferQueue() const { return transferQueueIdx != graphicsQueueIdx; }
+    /// true if compute runs on a different queue family than graphics
+    inline bool hasDedicatedComputeQueue() const { return computeQueueIdx != graphicsQueueIdx; }
 };
 
 #endif//QUEUE_FAMILY_DATA_HPP
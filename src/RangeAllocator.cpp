@@ -0,0 +1,98 @@
+#include "RangeAllocator.hpp"
+
+#include <cassert>
+
+RangeAllocator::RangeAllocator(size_t capacity) : capacity(capacity){
+    if(capacity > 0) insertFreeRange(0, capacity);
+}
+
+size_t RangeAllocator::allocate(size_t size, size_t alignment, size_t limit){
+    assert(size > 0 && "ZERO SIZED ALLOCATION");
+    if(alignment == 0) alignment = 1;
+
+    // smallest free range that fits size along with alignment padding
+    for(auto it = freeBySize.lower_bound(size); it != freeBySize.end(); it++){
+        size_t rangeOffset = it->second;
+        size_t rangeSize = it->first;
+
+        size_t offset = (rangeOffset + alignment - 1) / alignment * alignment;
+        size_t padding = offset - rangeOffset;
+        if(padding + size > rangeSize || offset + size > limit) continue;
+
+        eraseFreeRange(freeByOffset.find(rangeOffset));
+
+        // give back unused parts before and after allocated range
+        if(padding > 0) insertFreeRange(rangeOffset, padding);
+        if(padding + size < rangeSize) insertFreeRange(offset + size, rangeSize - padding - size);
+
+        allocations[offset] = size;
+        usedSize += size;
+        return offset;
+    }
+
+    return invalidOffset;
+}
+
+void RangeAllocator::free(size_t offset){
+    auto it = allocations.find(offset);
+    assert(it != allocations.end() && "FREEING UNALLOCATED RANGE");
+
+    size_t size = it->second;
+    allocations.erase(it);
+    usedSize -= size;
+
+    insertFreeRange(offset, size);
+}
+
+void RangeAllocator::grow(size_t newCapacity){
+    assert(newCapacity > capacity && "ALLOCATOR CAN ONLY GROW");
+
+    size_t oldCapacity = capacity;
+    capacity = newCapacity;
+    insertFreeRange(oldCapacity, newCapacity - oldCapacity);
+}
+
+size_t RangeAllocator::getAllocationSize(size_t offset) const {
+    auto it = allocations.find(offset);
+    return it == allocations.end() ? 0 : it->second;
+}
+
+size_t RangeAllocator::getLargestFreeRange() const {
+    return freeBySize.empty() ? 0 : freeBySize.rbegin()->first;
+}
+
+void RangeAllocator::insertFreeRange(size_t offset, size_t size){
+    // merge with free range just after this one
+    auto next = freeByOffset.find(offset + size);
+    if(next != freeByOffset.end()){
+        size += next->second;
+        eraseFreeRange(next);
+    }
+
+    // merge with free range just before this one
+    auto prev = freeByOffset.lower_bound(offset);
+    if(prev != freeByOffset.begin()){
+        prev--;
+        if(prev->first + prev->second == offset){
+            offset = prev->first;
+            size += prev->second;
+            eraseFreeRange(prev);
+        }
+    }
+
+    freeByOffset[offset] = size;
+    freeBySize.emplace(size, offset);
+}
+
+void RangeAllocator::eraseFreeRange(std::map<size_t, size_t>::iterator it){
+    // find matching entry among ranges of same size
+    auto range = freeBySize.equal_range(it->second);
+    for(auto sit = range.first; sit != range.second; sit++){
+        if(sit->second == it->first){
+            freeBySize.erase(sit);
+            break;
+        }
+    }
+
+    freeByOffset.erase(it);
+}
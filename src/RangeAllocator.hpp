@@ -0,0 +1,83 @@
+#ifndef RANGE_ALLOCATOR_HPP
+#define RANGE_ALLOCATOR_HPP
+
+#include <map>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Suballocates ranges out of a linear space like a buffer.
+ * Only offsets are managed, no memory is touched, so units of
+ * offsets and sizes are upto the user (bytes, vertices, ...).
+ * Uses best fit and freed ranges are merged with free neighbours.
+ * */
+class RangeAllocator {
+public:
+    /// offset returned when no free range is big enough
+    static constexpr size_t invalidOffset = SIZE_MAX;
+
+    /**
+     * @brief Create allocator managing [0, capacity).
+     *
+     * @param capacity Size of managed space.
+     * */
+    explicit RangeAllocator(size_t capacity = 0);
+
+    /**
+     * @brief Allocate a range of given size.
+     *
+     * @param size Size of range, must be non zero.
+     * @param alignment Offset of range will be multiple of this.
+     * @param limit Range has to end at or before this offset.
+     * @return size_t Offset of allocated range or invalidOffset.
+     * */
+    size_t allocate(size_t size, size_t alignment = 1, size_t limit = invalidOffset);
+
+    /**
+     * @brief Free a range returned by allocate().
+     *
+     * @param offset Offset of range.
+     * */
+    void free(size_t offset);
+
+    /**
+     * @brief Extend managed space to given capacity.
+     * Existing allocations are not moved.
+     *
+     * @param newCapacity Must be larger than current capacity.
+     * */
+    void grow(size_t newCapacity);
+
+    /**
+     * @brief Get size of an allocated range.
+     *
+     * @param offset Offset of range.
+     * @return size_t Size of range, 0 if no range is allocated at offset.
+     * */
+    size_t getAllocationSize(size_t offset) const;
+
+    /// size of managed space
+    inline size_t getCapacity() const { return capacity; }
+    /// total size of allocated ranges
+    inline size_t getUsedSize() const { return usedSize; }
+    /// size of largest free range
+    size_t getLargestFreeRange() const;
+private:
+    // add free range, merging it with free neighbours
+    void insertFreeRange(size_t offset, size_t size);
+    // remove free range from both maps
+    void eraseFreeRange(std::map<size_t, size_t>::iterator it);
+
+    size_t capacity = 0;
+    size_t usedSize = 0;
+
+    // free ranges sorted by offset, for merging neighbours
+    std::map<size_t, size_t> freeByOffset;
+    // free ranges sorted by size, for best fit search
+    std::multimap<size_t, size_t> freeBySize;
+    // sizes of allocated ranges by offset
+    std::unordered_map<size_t, size_t> allocations;
+};
+
+#endif//RANGE_ALLOCATOR_HPP
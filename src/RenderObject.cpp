@@ -1,44 +1,78 @@
 #include "RenderObject.hpp"
 
 #include <glm/glm.hpp>
-#include <glm/gtx/transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
-void RenderObject::updateModelMatrix(){
-    glm::mat4 translationMat = glm::translate(glm::mat4{ 1.0 }, position);
-    glm::mat4 rotationMat = glm::rotate(glm::mat4{ 1.0 }, glm::radians(rotationAngle), rotationAxis);
-    glm::mat4 scaleMat = glm::scale(glm::mat4{ 1.0 }, scale);
-    modelMatrix *= translationMat * rotationMat * scaleMat;
-}
+#include <iostream>
 
-RenderObject::RenderObject(){
-    updateModelMatrix();
-}
+RenderObject::RenderObject(){}
 
-RenderObject::RenderObject(Mesh* mesh, Material* material)
-    : mesh(mesh), material(material){
-    updateModelMatrix();
-}
+RenderObject::RenderObject(MeshHandle mesh, MaterialHandle material)
+    : mesh(mesh), material(material){}
 
 void RenderObject::setPosition(const glm::vec3& pos){
-    position = pos;
-    translationMatrix = glm::translate(glm::mat4{ 1.0 }, pos);
-    modelMatrix = translationMatrix * rotationMatrix * scaleMatrix;
+    if(transforms != nullptr) transforms->setPosition(transform, pos);
+    else position = pos;
+}
+
+const glm::vec3& RenderObject::getPosition() const {
+    return transforms != nullptr ? transforms->getPosition(transform) : position;
 }
 
 void RenderObject::move(const glm::vec3& moveVec){
-    position += moveVec;
-    translationMatrix = glm::translate(glm::mat4{ 1.0 }, moveVec);
-    modelMatrix *= translationMatrix;
+    setPosition(getPosition() + moveVec);
 }
 
 void RenderObject::setRotation(const glm::vec3& axis, float angle){
-    rotationAxis = axis;
-    rotationAngle = angle;
-    rotationMatrix = glm::rotate(glm::mat4{ 1.0 }, glm::radians(angle), axis);
-    modelMatrix *= rotationMatrix;
+    setRotation(glm::angleAxis(glm::radians(angle), glm::normalize(axis)));
+}
+
+void RenderObject::setRotation(const glm::quat& rot){
+    if(transforms != nullptr) transforms->setRotation(transform, rot);
+    else rotation = glm::normalize(rot);
+}
+
+const glm::quat& RenderObject::getRotation() const {
+    return transforms != nullptr ? transforms->getRotation(transform) : rotation;
+}
+
+void RenderObject::setScale(const glm::vec3& s){
+    if(transforms != nullptr) transforms->setScale(transform, s);
+    else scale = s;
 }
 
-void RenderObject::setScale(const glm::vec3& scale){
-    scaleMatrix = glm::scale(glm::mat4{ 1.0 }, scale);
-    modelMatrix *= scaleMatrix;
+const glm::vec3& RenderObject::getScale() const {
+    return transforms != nullptr ? transforms->getScale(transform) : scale;
+}
+
+glm::mat4 RenderObject::getModelMatrix() const {
+    if(transforms != nullptr) return transforms->getModelMatrix(transform);
+
+    glm::mat4 model;
+    TransformStore::compose(position, rotation, scale, model);
+    return model;
+}
+
+glm::mat3x4 RenderObject::getNormalMatrix() const {
+    if(transforms != nullptr) return transforms->getNormalMatrix(transform);
+
+    glm::mat4 model;
+    glm::mat3x4 normal;
+    TransformStore::compose(position, rotation, scale, model, &normal);
+    return normal;
+}
+
+void RenderObject::bindTransform(TransformStore* store){
+    uint32_t id = store->create(getPosition(), getRotation(), getScale());
+    transforms = store;
+    transform = id;
+}
+
+bool RenderObject::setParent(const RenderObject* parent){
+    if(transforms == nullptr || (parent != nullptr && parent->transforms != transforms)){
+        std::cerr << "[WARNING] Parented objects must be added to the same renderer first" << std::endl;
+        return false;
+    }
+
+    return transforms->setParent(transform, parent != nullptr ? parent->transform : TransformStore::invalid);
 }
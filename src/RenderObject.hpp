@@ -3,6 +3,7 @@
 
 #include "Mesh.hpp"
 #include "Material.hpp"
+#include "TransformStore.hpp"
 
 struct RenderObject {
     /**
@@ -15,38 +16,38 @@ struct RenderObject {
      * @brief Create RenderObject with given mesh and material.
      * This will assume default position and scaling of object.
      *
-     * @param mesh Pointer to mesh to apply shape.
-     * @param material Pointer to material to apply to object.
+     * @param mesh Handle of mesh to apply shape, registered in renderer drawing this object.
+     * @param material Handle of material to apply to object, registered in same renderer.
      * */
-    RenderObject(Mesh* mesh, Material* material);
+    RenderObject(MeshHandle mesh, MaterialHandle material);
 
     /**
      * @brief Set this mesh for this object.
      *
-     * @param mesh Pointer to mesh to apply to this object.
+     * @param mesh Handle of mesh to apply to this object.
      * */
-    inline void setMesh(Mesh* m) { mesh = m; }
+    inline void setMesh(MeshHandle m) { mesh = m; }
 
     /**
-     * @brief Get pointer to applied mesh object.
+     * @brief Get handle of applied mesh, resolve it with Renderer::getMesh().
      *
-     * @return Mesh*
+     * @return MeshHandle
      * */
-    inline Mesh* getMesh() { return mesh; }
+    inline MeshHandle getMesh() const { return mesh; }
 
     /**
      * @brief Apply given material to this object.
      *
-     * @param material Pointer to material to apply to this object.
+     * @param material Handle of material to apply to this object.
      * */
-    inline void setMaterial(Material* mat) { material = mat; }
+    inline void setMaterial(MaterialHandle mat) { material = mat; }
 
     /**
-     * @brief Get applied material to this object.
+     * @brief Get handle of applied material, resolve it with Renderer::getMaterial().
      *
-     * @return Material*
+     * @return MaterialHandle
      * */
-    inline Material* getMaterial() { return material; }
+    inline MaterialHandle getMaterial() const { return material; }
 
     /**
      * @brief Set position of this render object.
@@ -56,11 +57,11 @@ struct RenderObject {
     void setPosition(const glm::vec3& pos);
 
     /**
-     * @brief Get current position of object.
+     * @brief Get current position of object, relative to its parent if it has one.
      *
      * @return glm::vec3
      * */
-    inline const glm::vec3& getPosition() { return position; }
+    const glm::vec3& getPosition() const;
 
     /**
      * @brief Move object by given vector.
@@ -71,8 +72,7 @@ struct RenderObject {
 
     /**
      * @brief Set rotation of this render object.
-     * This will be added over previous rotations of object.
-     * Last rotation data won't be stored.
+     * Replaces previous rotation, result doesn't depend on order of set calls.
      *
      * @param axis Rotation axis.
      * @param angle Rotation angle in degrees.
@@ -80,57 +80,99 @@ struct RenderObject {
     void setRotation(const glm::vec3& axis, float angle);
 
     /**
-     * @brief Get last rotation axis of object.
+     * @brief Set rotation of this render object from a quaternion.
      *
-     * @return glm::vec3
+     * @param rotation Rotation, normalized before use.
      * */
-    inline const glm::vec3& getRotationAxis(){ return rotationAxis; }
+    void setRotation(const glm::quat& rotation);
 
     /**
-     * @brief Get last rotation angle of object.
+     * @brief Get current rotation of object.
      *
-     * @return float Angle in degrees
+     * @return glm::quat
      * */
-    inline float getRotationAngle() { return rotationAngle; };
+    const glm::quat& getRotation() const;
 
     /**
      * @brief Set x, y and z scale of object.
+     * Replaces previous scale.
      *
      * @param scale
      * */
     void setScale(const glm::vec3& s);
 
     /**
-     * @brief Get last scaling vector object.
+     * @brief Get current scale of object.
      *
      * @return glm::vec3
      * */
-    inline const glm::vec3& getScale() { return scale; }
+    const glm::vec3& getScale() const;
 
     /**
-     * @brief Get model matrix of this object.
+     * @brief Get model matrix of this object, including transforms of its parents.
+     * Matrices of objects added to a renderer are composed once per frame,
+     * so they reflect changes made before last draw or level selection.
      *
      * @return glm::mat4
      * */
-    inline const glm::mat4& getModelMatrix() {
-        return modelMatrix;
-    };
+    glm::mat4 getModelMatrix() const;
+
+    /**
+     * @brief Get matrix transforming normals of this object to world space.
+     *
+     * @return glm::mat3x4 Inverse transpose of model matrix, columns padded to vec4.
+     * */
+    glm::mat3x4 getNormalMatrix() const;
+
+    /**
+     * @brief Move transform of this object into given store.
+     * Done by renderer when object is added to it, copies of object made after
+     * this share the same transform.
+     *
+     * @param store Store to keep transform in.
+     * */
+    void bindTransform(TransformStore* store);
+
+    /**
+     * @brief Attach this object to a parent object, or detach it with nullptr.
+     * Position, rotation and scale of this object become relative to parent,
+     * so moving parent moves this object too. Both objects must be added to
+     * the same renderer.
+     *
+     * @param parent Object to attach to, nullptr to make this object a root.
+     * @return bool false if objects aren't in the same store or parenting would form a cycle.
+     * */
+    bool setParent(const RenderObject* parent);
+
+    /**
+     * @brief Set color object is tinted with, multiplied with vertex colors of mesh.
+     *
+     * @param c Color, alpha is currently unused.
+     * */
+    inline void setColor(const glm::vec4& c) { color = c; }
+
+    /**
+     * @brief Get color object is tinted with.
+     *
+     * @return glm::vec4
+     * */
+    inline const glm::vec4& getColor() const { return color; }
 private:
-    void updateModelMatrix();
+    // objects with destroyed mesh or material aren't drawn
+    MeshHandle mesh;
+    MaterialHandle material;
 
-    Mesh* mesh = nullptr;
-    Material* material = nullptr;
+    // tint of object, white keeps colors of mesh
+    glm::vec4 color = glm::vec4(1.f);
 
+    // transform until object is bound to a store, unused after that
     glm::vec3 position = {0, 0, 0};
+    glm::quat rotation = glm::quat(1.f, 0.f, 0.f, 0.f);
     glm::vec3 scale = {1, 1, 1};
-    glm::vec3 rotationAxis = {1, 0, 0};
-    float rotationAngle = 0;
-
-    //decides the position and oreintation of object in space
-    glm::mat4 translationMatrix = glm::mat4{1.f};
-    glm::mat4 rotationMatrix = glm::mat4{1.f};
-    glm::mat4 scaleMatrix = glm::mat4{1.f};
-    glm::mat4 modelMatrix = glm::mat4{1.f};
+
+    // store owning transform of object, model and normal matrices are composed there
+    TransformStore* transforms = nullptr;
+    uint32_t transform = TransformStore::invalid;
 };
 
 
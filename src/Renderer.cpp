@@ -13,6 +13,8 @@
 #include "Shader.hpp"
 #include "PushData.hpp"
 #include "Math.hpp"
+#include "Simplifier.hpp"
+#include "MeshOptimizer.hpp"
 
 #include <SDL2/SDL_events.h>
 #include <SDL2/SDL_video.h>
@@ -28,6 +30,7 @@
 #include <stdexcept>
 #include <vector>
 #include <cstdint>
+#include <algorithm>
 
 // renderer constructor
 Renderer::Renderer(SDL_Window *window)
@@ -67,6 +70,12 @@ Renderer::Renderer(SDL_Window *window)
     // create command pool and spawn some command buffers
     initCommands();
 
+    // create staging ring for uploads
+    initUploadManager();
+
+    // create shared vertex and index buffers
+    initGeometryBuffer();
+
     // init render pass
     initRenderPass();
 
@@ -82,12 +91,21 @@ Renderer::Renderer(SDL_Window *window)
     // init graphics pipeline
     initGraphicsPipeline();
 
+    // init compute pipeline layout of gpu surfaces
+    initSurfaceGeneration();
+
+    // start background mesh loading
+    initStreaming();
+
     // load meshes
     // loadMeshes();
 }
 
 // destroy renderer
 void Renderer::cleanup(){
+    // stop loading meshes in background
+    meshStreamer.destroy();
+
     // wait for all device operations to complete before destroying
     vkDeviceWaitIdle(device);
 
@@ -124,6 +142,12 @@ void Renderer::createInstance(){
     std::vector<const char*> layerNames, extNames;
     getExtensionsAndLayers(window, layerNames, extNames);
 
+    // optional, needed to query memory budget of device
+    physicalDeviceProperties2Enabled = checkIfExtensionIsAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == SUCCESS;
+    if(physicalDeviceProperties2Enabled){
+        extNames.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    }
+
     // get debug messenger create info and pass it as pnext in instance create info
     // this will create a debug messenger before creating instance
     // this will help us log instance creation and destruction
@@ -268,6 +292,21 @@ void Renderer::createLogicalDevice(){
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    // memory budget is optional, enable it if device and instance support it
+    std::vector<const char*> enabledExtensions = deviceExtensions;
+    memoryBudgetEnabled = false;
+    if(physicalDeviceProperties2Enabled){
+        std::vector<VkExtensionProperties> extensionProperties;
+        getDeviceExtensionProperties(physicalDevice, extensionProperties);
+        for(const VkExtensionProperties& properties : extensionProperties){
+            if(strcmp(properties.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0){
+                enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+                memoryBudgetEnabled = true;
+                break;
+            }
+        }
+    }
+
     // device create info
     VkDeviceCreateInfo createInfo = {
         .sType = STYPE(DEVICE_CREATE_INFO),
@@ -277,8 +316,8 @@ void Renderer::createLogicalDevice(){
         .pQueueCreateInfos = queueCreateInfos.data(),
         .enabledLayerCount = 0,
         .ppEnabledLayerNames = nullptr,
-        .enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()),
-        .ppEnabledExtensionNames = deviceExtensions.data(),
+        .enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size()),
+        .ppEnabledExtensionNames = enabledExtensions.data(),
         .pEnabledFeatures = nullptr
     };
 
@@ -289,6 +328,13 @@ void Renderer::createLogicalDevice(){
     vkGetDeviceQueue(device, queueFamilyData.graphicsQueueIdx, 0, &graphicsQueue);
     vkGetDeviceQueue(device, queueFamilyData.presentQueueIdx, 0, &presentQueue);
     vkGetDeviceQueue(device, queueFamilyData.transferQueueIdx, 0, &transferQueue);
+
+    std::cout << "[INFO] Queue families : graphics " << queueFamilyData.graphicsQueueIdx
+              << ", present " << queueFamilyData.presentQueueIdx
+              << ", transfer " << queueFamilyData.transferQueueIdx
+              << (queueFamilyData.hasDedicatedTransferQueue() ? " (dedicated)" : "")
+              << ", compute " << queueFamilyData.computeQueueIdx
+              << (queueFamilyData.hasDedicatedComputeQueue() ? " (dedicated)" : "") << std::endl;
 }
 
 void Renderer::createAllocator(){
@@ -296,8 +342,12 @@ void Renderer::createAllocator(){
     allocatorInfo.device = device;
     allocatorInfo.instance = instance;
     allocatorInfo.physicalDevice = physicalDevice;
+    // let vma fetch usage and budget of heaps from driver
+    if(memoryBudgetEnabled) allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
     VKCHECK(vmaCreateAllocator(&allocatorInfo, &allocator));
 
+    memoryBudget.init(allocator, memoryBudgetEnabled);
+
     mainDeletionQueue.push_function([=](){
         vmaDestroyAllocator(allocator);
     });
@@ -423,6 +473,7 @@ void Renderer::createDepthImage(){
 
     // create image
     VKCHECK(vmaCreateImage(allocator, &depthImageInfo, &allocInfo, &depthImage.image, &depthImage.allocation, nullptr));
+    memoryBudget.track(MemoryCategory::Image, depthImage.allocation);
 
     // build an image-view for the depth image to use for rendering
     VkImageViewCreateInfo depthImageViewInfo = defaultImageViewCreateInfo(depthImageFormat, depthImage.image, VK_IMAGE_ASPECT_DEPTH_BIT);
@@ -433,6 +484,7 @@ void Renderer::createDepthImage(){
     // add to deletion queues
     swapchainDeletionQueue.push_function([=]() {
         vkDestroyImageView(device, depthImageView, nullptr);
+        memoryBudget.untrack(MemoryCategory::Image, depthImage.allocation);
         vmaDestroyImage(allocator, depthImage.image, depthImage.allocation);
     });
 }
@@ -501,14 +553,12 @@ void Renderer::createCommandPool(){
         });
     }
 
-    // create command pool for transfer operation
-    commandPoolInfo.queueFamilyIndex = queueFamilyData.transferQueueIdx;
-    VKCHECK(vkCreateCommandPool(device, &commandPoolInfo, nullptr, &transferCommandPool));
-
+    // create command pool for one off graphics work
+    VKCHECK(vkCreateCommandPool(device, &commandPoolInfo, nullptr, &immediateCommandPool));
 
     // add to deletion queue
     mainDeletionQueue.push_function([=](){
-        vkDestroyCommandPool(device, transferCommandPool, nullptr);
+        vkDestroyCommandPool(device, immediateCommandPool, nullptr);
     });
 }
 
@@ -521,9 +571,16 @@ void Renderer::allocateCommandBuffers(){
         VKCHECK(vkAllocateCommandBuffers(device, &cmdAllocInfo, &frames[i].commandBuffer));
     }
 
-    // allocate command buffer for transfer operations
-    VkCommandBufferAllocateInfo cmdAllocInfo = defaultCommandBufferAllocateInfo(transferCommandPool, 1);
-    VKCHECK(vkAllocateCommandBuffers(device, &cmdAllocInfo, &transferCommandBuffer));
+    // allocate command buffer for one off graphics work
+    VkCommandBufferAllocateInfo cmdAllocInfo = defaultCommandBufferAllocateInfo(immediateCommandPool, 1);
+    VKCHECK(vkAllocateCommandBuffers(device, &cmdAllocInfo, &immediateCommandBuffer));
+
+    // fence to wait for one off work
+    VkFenceCreateInfo fenceCreateInfo = defaultFenceCreateInfo(0);
+    VKCHECK(vkCreateFence(device, &fenceCreateInfo, nullptr, &immediateFence));
+    mainDeletionQueue.push_function([=](){
+        vkDestroyFence(device, immediateFence, nullptr);
+    });
 }
 
 // create command pool and allocate command buffers for each frame in flight
@@ -532,45 +589,76 @@ void Renderer::initCommands(){
     allocateCommandBuffers();
 }
 
-// copy buffer from cpu to gpu
-void Renderer::copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size) {
+// submit one off commands to graphics queue and wait for them
+void Renderer::immediateSubmit(const std::function<void(VkCommandBuffer cmd)>& function){
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = STYPE(COMMAND_BUFFER_BEGIN_INFO);
     beginInfo.pNext = nullptr;
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    // shorter name
-    VkCommandBuffer& cmd = transferCommandBuffer;
+    // record commands
+    VKCHECK(vkBeginCommandBuffer(immediateCommandBuffer, &beginInfo));
+    function(immediateCommandBuffer);
+    VKCHECK(vkEndCommandBuffer(immediateCommandBuffer));
 
-    // begin recording command buffer
-    VKCHECK(vkBeginCommandBuffer(cmd, &beginInfo));
-
-    // copy info
-    VkBufferCopy copyRegion = {};
-    copyRegion.srcOffset = 0;
-    copyRegion.dstOffset = 0;
-    copyRegion.size = size;
-
-    // copy command
-    vkCmdCopyBuffer(cmd, src, dst, 1, &copyRegion);
-
-    // end recording
-    VKCHECK(vkEndCommandBuffer(cmd));
-
-    // submit command buffer
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = STYPE(SUBMIT_INFO);
     submitInfo.pNext = nullptr;
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &transferCommandBuffer;
-    // we are not waiting or signalling any other operation
+    submitInfo.pCommandBuffers = &immediateCommandBuffer;
 
-    // submit
-    vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(transferQueue);
+    // submit and wait only for this submission
+    VKCHECK(vkQueueSubmit(graphicsQueue, 1, &submitInfo, immediateFence));
+    VKCHECK(vkWaitForFences(device, 1, &immediateFence, VK_TRUE, UINT64_MAX));
+    VKCHECK(vkResetFences(device, 1, &immediateFence));
 
     // reset command buffer so that it can be used again
-    VKCHECK(vkResetCommandBuffer(transferCommandBuffer, 0));
+    VKCHECK(vkResetCommandBuffer(immediateCommandBuffer, 0));
+}
+
+// initialize upload manager
+void Renderer::initUploadManager(){
+    // uploaded geometry is consumed by graphics queue, ownership is
+    // transferred to it if uploads run on a dedicated transfer family
+    uploadManager.init(device, allocator, &memoryBudget, queueFamilyData.transferQueueIdx, transferQueue,
+                       queueFamilyData.graphicsQueueIdx);
+
+    mainDeletionQueue.push_function([=](){
+        uploadManager.destroy();
+    });
+}
+
+// initialize geometry buffer, its buffers are created on first mesh upload
+void Renderer::initGeometryBuffer(){
+    // growing copies old buffer contents on graphics queue, which owns them
+    // once all pending uploads are complete and acquired
+    geometryBuffer.init(device, allocator, &memoryBudget, [this](VkBuffer src, VkBuffer dst, VkDeviceSize size){
+        uploadManager.waitIdle();
+        immediateSubmit([&](VkCommandBuffer cmd){
+            VkAccessFlags drawAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+            uploadManager.recordAcquireBarriers(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                                VK_ACCESS_TRANSFER_READ_BIT | drawAccess);
+
+            VkBufferCopy copyRegion = {};
+            copyRegion.srcOffset = 0;
+            copyRegion.dstOffset = 0;
+            copyRegion.size = size;
+            vkCmdCopyBuffer(cmd, src, dst, 1, &copyRegion);
+
+            // copied contents are read by following draws
+            VkMemoryBarrier barrier = {};
+            barrier.sType = STYPE(MEMORY_BARRIER);
+            barrier.pNext = nullptr;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = drawAccess;
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        });
+    });
+
+    mainDeletionQueue.push_function([=](){
+        geometryBuffer.destroy();
+    });
 }
 
 // initialize a default renderpass
@@ -681,6 +769,9 @@ void Renderer::initSyncStructures(){
         VKCHECK(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &frame.renderSemaphore));
         VKCHECK(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &frame.presentSemaphore));
 
+        // transient cpu data of frame, reset with its fence
+        frame.arena.init(frameArenaSize);
+
         // we want to create the fence with the Create Signaled flag, so we can
         // wait on it before using it on a GPU command (for the first frame)
         VkFenceCreateInfo fenceCreateInfo = defaultFenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
@@ -699,106 +790,322 @@ void Renderer::initSyncStructures(){
 
 // load mesh
 void Renderer::loadMeshes(){
-    meshes["apple"] = {};
-    Mesh& apple = meshes["apple"];
+    // apple is loaded in background, through binary cache of obj file
+    MeshHandle apple = requestMesh("../assets/apple.obj");
+    MaterialHandle defaultMaterial = findMaterial("defaultMaterial");
 
-    if(apple.loadFromObj("../assets/apple.obj") != FAILED){
-        uploadMesh(apple);
+    // create sphere mesh
+    Mesh sphereMesh;
+    uint32_t slices = 100, circles = 100;
+    createSphereMesh(sphereMesh, slices, circles, {1, 1, 1});
+    // sphere has smooth normals and a single color, nothing lost by packing it
+    sphereMesh.format = VertexFormat::Packed;
+    MeshHandle sphereHandle = createMesh(std::move(sphereMesh), "sphere");
 
-        RenderObject obj(getMesh("apple"), getMaterial("defaultMaterial"));
-        obj.setPosition({1, 0, 3});
-        obj.move({0, 0.2, -0.1});
-        obj.setScale({16, 16, 16});
-        // obj.setRotation({0, 1, 0}, 180);
-        // obj.setRotation({1, 0, 0}, 120);
-        renderObjects.push_back(obj);
-    }
+    // // create a plane
+    Mesh planeMesh;
+    float width = 10;
+    float height = 10;
+    createRectangleMesh(planeMesh, width, height, {1, 0, 0});
+    MeshHandle planeHandle = createMesh(std::move(planeMesh), "plane");
 
-    // create sphere mesh
-    meshes["sphere"] = Mesh{};
-    Mesh& sphere = meshes["sphere"];
+    // meshes are created, so their addresses stay put from here on
+    Mesh& sphere = *getMesh(sphereHandle);
+    Mesh& plane = *getMesh(planeHandle);
 
-    // create sphere mesh
-    uint32_t slices = 100, circles = 100;
-    createSphereMesh(sphere, slices, circles, {1, 1, 1});
+    // generate levels of detail of all meshes in parallel
+    generateMeshLods({&sphere, &plane});
+
+    RenderObject obj(apple, defaultMaterial);
+    obj.setPosition({1, 0, 3});
+    obj.move({0, 0.2, -0.1});
+    obj.setScale({16, 16, 16});
+    // obj.setRotation({0, 1, 0}, 180);
+    // obj.setRotation({1, 0, 0}, 120);
+    addRenderObject(obj);
 
     // upload mesh data to gpu
     uploadMesh(sphere);
 
     // create renderable object
-    RenderObject sphereObj(getMesh("sphere"), getMaterial("defaultMaterial"));
+    RenderObject sphereObj(sphereHandle, defaultMaterial);
     sphereObj.setPosition({-1, 0, 4});
 
-    renderObjects.push_back(sphereObj);
-
-    // // create a plane
-    meshes["plane"] = Mesh{};
-    Mesh& plane = meshes["plane"];
-
-    float width = 10;
-    float height = 10;
-    createRectangleMesh(plane, width, height, {1, 0, 0});
+    addRenderObject(sphereObj);
 
     // upload mesh data
     uploadMesh(plane);
 
     // create renderable object
-    RenderObject planeObj(getMesh("plane"), getMaterial("defaultMaterial"));
+    RenderObject planeObj(planeHandle, defaultMaterial);
     planeObj.setRotation({1, 0 ,0}, -90); // rotate about x axis 90 degrees
     planeObj.setPosition({0, -2, 0});
 
-    renderObjects.push_back(planeObj);
+    addRenderObject(planeObj);
 };
 
-// upload just any buffer to gpu
-AllocatedBuffer Renderer::uploadDataToGPU(void* data, size_t size, VkBufferUsageFlags flags){
-    // create staging buffer (in cpu ram)
-    AllocatedBuffer stagingBuffer = createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-    // remove last pushed function
-    // last pushed destructor is destructor for stagin buffer
-    // this buffer must be destroyed just after use!!
-    mainDeletionQueue.deletors.pop_back();
+// upload Mesh data to gpu
+UploadTicket Renderer::uploadMesh(Mesh &mesh) {
+    if(mesh.uploaded){
+        std::cerr << "[WARNING] Mesh is already uploaded" << std::endl;
+        return mesh.uploadTicket;
+    }
 
-    //copy data to staging buffer
-    void* memptr;
-    vmaMapMemory(allocator, stagingBuffer.allocation, &memptr);
-    memcpy(memptr, data, size);
-    vmaUnmapMemory(allocator, stagingBuffer.allocation);
+    if(mesh.vertices.empty()){
+        std::cerr << "[WARNING] Not uploading mesh without vertices" << std::endl;
+        return 0;
+    }
 
-    // create buffer (in gpu ram)
-    AllocatedBuffer gpuBuffer = createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | flags, VMA_MEMORY_USAGE_GPU_ONLY);
+    // bounds are needed for level of detail selection
+    if(mesh.boundsRadius == 0.f) mesh.computeBounds();
 
-    // copy data from staging buffer (in cpu ram) to vertex buffer (in gpu ram)
-    copyBuffer(stagingBuffer.buffer, gpuBuffer.buffer, size);
+    // reorder triangles and vertices for gpu caches, done only once per mesh
+    if(mesh.hasIndexBuffer && !mesh.optimized){
+        MeshOptimizationStats stats = optimizeMesh(mesh);
+        std::cout << "[INFO] Mesh optimized, ACMR " << stats.acmrBefore << " -> " << stats.acmrAfter
+                  << ", ATVR " << stats.atvrBefore << " -> " << stats.atvrAfter << std::endl;
+    }
 
-    // destroy staging buffer
-    vmaDestroyBuffer(allocator, stagingBuffer.buffer, stagingBuffer.allocation);
+    // packed vertices can only be drawn if their pipeline variant exists
+    if(mesh.format == VertexFormat::Packed && meshPipelines[static_cast<size_t>(VertexFormat::Packed)] == VK_NULL_HANDLE){
+        std::cerr << "[WARNING] Packed vertex pipeline unavailable, uploading full precision vertices" << std::endl;
+        mesh.format = VertexFormat::Float;
+    }
 
-    return gpuBuffer;
+    // encode vertices and indices in their gpu layout
+    std::vector<uint8_t> positions, attributes, indices;
+    mesh.encodeVertexStreams(positions, attributes);
+    mesh.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    mesh.indexCount = 0;
+    if(mesh.hasIndexBuffer && !mesh.indices.empty()){
+        mesh.encodeIndices(indices);
+        mesh.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    }
+
+    // encoded streams are all that's uploaded, cpu copy is only kept for editing and uploading again
+    if(releaseCpuGeometry){
+        std::vector<Vertex>().swap(mesh.vertices);
+        std::vector<uint32_t>().swap(mesh.indices);
+    }
+
+    return uploadMeshData(mesh, positions.data(), attributes.data(), indices.data());
 }
 
-// upload Mesh data to gpu
-void Renderer::uploadMesh(Mesh &mesh) {
-    // upload vertex data
-    size_t vertexBufferSize = mesh.vertices.size() * sizeof(Vertex);
-    mesh.vertexBuffer = uploadDataToGPU(mesh.vertices.data(), vertexBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+// upload mesh straight from a mapped mesh file
+UploadTicket Renderer::uploadMesh(Mesh& mesh, const MappedMeshFile& file){
+    if(mesh.uploaded){
+        std::cerr << "[WARNING] Mesh is already uploaded" << std::endl;
+        return mesh.uploadTicket;
+    }
+
+    file.describe(mesh);
+
+    // file is encoded in a single format, there's nothing to fall back to
+    if(meshPipelines[static_cast<size_t>(mesh.format)] == VK_NULL_HANDLE){
+        std::cerr << "[WARNING] Not uploading mesh file, pipeline of its vertex format is unavailable" << std::endl;
+        return 0;
+    }
+
+    const MeshFileHeader& header = file.getHeader();
+    return uploadMeshData(mesh, file.getSection(header.positions), file.getSection(header.attributes),
+                          file.getSection(header.indices));
+}
+
+// allocate geometry of mesh and record uploads of its encoded data
+UploadTicket Renderer::uploadMeshData(Mesh& mesh, const void* positions, const void* attributes, const void* indices){
+    // positions and other attributes go to separate streams of geometry buffer, at same vertex offset
+    VkDeviceSize positionSize = VkDeviceSize(mesh.vertexCount) * getPositionStride(mesh.format);
+    VkDeviceSize attributeSize = VkDeviceSize(mesh.vertexCount) * getAttributeStride(mesh.format);
+    mesh.vertexOffset = geometryBuffer.allocateVertices(mesh.format, mesh.vertexCount);
+    // copies are only recorded here and submitted in a batch with other uploads
+    // ticket of last copy covers all earlier ones
+    uploadManager.upload(positions, positionSize, geometryBuffer.getPositionBuffer(mesh.format),
+                         mesh.vertexOffset * getPositionStride(mesh.format));
+    mesh.uploadTicket = uploadManager.upload(attributes, attributeSize, geometryBuffer.getAttributeBuffer(mesh.format),
+                                             mesh.vertexOffset * getAttributeStride(mesh.format));
 
     // upload index data if available
-    if(mesh.hasIndexBuffer){
-        size_t indexBufferSize = mesh.indices.size() * sizeof(uint32_t);
-        mesh.indexBuffer = uploadDataToGPU(mesh.indices.data(), indexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    VkDeviceSize indexSize = VkDeviceSize(mesh.indexCount) * GeometryBuffer::getIndexSize(mesh.indexType);
+    if(mesh.hasIndexBuffer && mesh.indexCount > 0){
+        mesh.firstIndex = geometryBuffer.allocateIndices(mesh.indexType, mesh.indexCount);
+        mesh.uploadTicket = uploadManager.upload(indices, indexSize, geometryBuffer.getIndexBuffer(),
+                                                 mesh.firstIndex * GeometryBuffer::getIndexSize(mesh.indexType));
+    }else indexSize = 0;
+
+    mesh.uploaded = true;
+    // count upload as a use, so mesh isn't evicted before it's drawn
+    mesh.lastDrawnFrame = frameNumber;
+    residentMeshBytes += getMeshGeometrySize(mesh);
+
+    std::cout << "[INFO] Mesh uploaded, " << positionSize << " bytes of positions, "
+              << attributeSize << " bytes of attributes, " << indexSize << " bytes of indices" << std::endl;
+
+    return mesh.uploadTicket;
+}
+
+// start workers loading meshes in background
+void Renderer::initStreaming(){
+    meshStreamer.init();
+
+    // a coarse grey sphere is drawn where streamed meshes will appear
+    Mesh placeholder;
+    createSphereMesh(placeholder, 8, 6, {0.5f, 0.5f, 0.5f});
+    placeholderMesh = createMesh(std::move(placeholder));
+    uploadMesh(*getMesh(placeholderMesh));
+}
+
+// queue loading of a mesh from disk
+MeshHandle Renderer::requestMesh(const std::string& path, VertexFormat format){
+    StringId name(path);
+    MeshHandle existing = findMesh(name);
+    if(existing) return existing;
+
+    // mesh files are encoded in a single format, so request one that can be drawn
+    if(meshPipelines[static_cast<size_t>(format)] == VK_NULL_HANDLE) format = VertexFormat::Float;
+
+    // workers only get handle, results are dropped if mesh is destroyed before they arrive
+    Mesh mesh;
+    mesh.format = format;
+    mesh.fallback = placeholderMesh;
+    MeshHandle handle = createMesh(std::move(mesh), name);
+    if(!handle) return handle;
+    streamedMeshPaths[handle] = path;
+    meshStreamer.request(handle, path, format);
+    return handle;
+}
+
+// prioritize and upload streamed meshes
+void Renderer::updateStreaming(const FrameSnapshot& snapshot, FrameArena& arena){
+    // distance of nearest object using each mesh that isn't uploaded yet
+    MeshStreamer::DistanceMap distances{ArenaAllocator<MeshStreamer::DistanceMap::value_type>(arena)};
+    for(const ObjectSnapshot& object : snapshot.objects){
+        Mesh* mesh = getMesh(object.mesh);
+        if(mesh == nullptr || mesh->uploaded) continue;
+
+        // evicted meshes are requested again once an object using them is in view,
+        // their bounds are kept on eviction
+        if(mesh->evicted){
+            const glm::mat4& model = object.modelMatrix;
+            glm::vec3 center = glm::vec3(model * glm::vec4(mesh->boundsCenter, 1.f));
+            float scale = std::max({glm::length(glm::vec3(model[0])),
+                                    glm::length(glm::vec3(model[1])),
+                                    glm::length(glm::vec3(model[2]))});
+            if(!snapshot.frustum.intersectsSphere(center, mesh->boundsRadius * scale)) continue;
+
+            meshStreamer.request(object.mesh, streamedMeshPaths[object.mesh], mesh->format);
+            mesh->evicted = false;
+        }
+
+        float distance = glm::length(glm::vec3(object.modelMatrix[3]) - snapshot.uniformData.viewPosition);
+        auto [entry, inserted] = distances.emplace(object.mesh, distance);
+        if(!inserted) entry->second = std::min(entry->second, distance);
+    }
+    meshStreamer.updatePriorities(distances);
+
+    // upload a few loaded meshes per frame so frame time stays smooth
+    ArenaVector<MeshStreamer::LoadedMesh> loaded{ArenaAllocator<MeshStreamer::LoadedMesh>(arena)};
+    meshStreamer.collectLoaded(loaded, streamUploadsPerFrame);
+    for(MeshStreamer::LoadedMesh& result : loaded){
+        // keep showing fallback if mesh couldn't be loaded
+        if(result.failed) continue;
+
+        // mesh may have been destroyed while it was loading
+        Mesh* target = getMesh(result.target);
+        if(target == nullptr) continue;
+
+        // vertices are copied straight from mapped file to staging memory,
+        // only if cache couldn't be written mesh comes parsed
+        if(result.file.isOpen()){
+            uploadMesh(*target, result.file);
+        }else{
+            MeshHandle fallback = target->fallback;
+            *target = std::move(result.mesh);
+            target->fallback = fallback;
+            uploadMesh(*target);
+        }
     }
 }
 
-// draw on screen
-void Renderer::draw(){
-    // update camera data every frame
-    // camera data is modified per frame in the main loop depending on the events triggered
-    void* data;
-    vmaMapMemory(allocator, getCurrentFrame().uniformBuffer.allocation, &data);
-    memcpy(data, &uniformData, sizeof(UniformData));
-    vmaUnmapMemory(allocator, getCurrentFrame().uniformBuffer.allocation);
+// free mesh data from gpu
+void Renderer::freeMesh(Mesh& mesh){
+    if(!mesh.uploaded) return;
+
+    if(mesh.dynamic){
+        std::cerr << "[WARNING] Dynamic meshes keep their buffers until cleanup" << std::endl;
+        return;
+    }
+
+    residentMeshBytes -= getMeshGeometrySize(mesh);
+
+    // frames in flight may still be drawing this mesh, so release it later
+    PendingGeometryFree pending;
+    pending.frame = frameNumber;
+    pending.hasVertices = true;
+    pending.format = mesh.format;
+    pending.vertexOffset = mesh.vertexOffset;
+    pending.hasIndices = mesh.hasIndexBuffer && mesh.indexCount > 0;
+    pending.indexType = mesh.indexType;
+    pending.firstIndex = mesh.firstIndex;
+    pendingGeometryFrees.push_back(pending);
+
+    mesh.uploaded = false;
+}
+
+// free least recently drawn streamed meshes while over residency budget
+void Renderer::evictMeshes(FrameArena& arena){
+    if(meshResidencyBudget == 0 || residentMeshBytes <= meshResidencyBudget){
+        residencyExceeded = false;
+        return;
+    }
+
+    // meshes drawn this frame stay, as do uploads not acquired yet
+    ArenaVector<Mesh*> candidates{ArenaAllocator<Mesh*>(arena)};
+    for(const auto& entry : streamedMeshPaths){
+        Mesh* mesh = getMesh(entry.first);
+        if(mesh != nullptr && isMeshReady(*mesh) && mesh->lastDrawnFrame < frameNumber) candidates.push_back(mesh);
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Mesh* a, const Mesh* b){
+        return a->lastDrawnFrame < b->lastDrawnFrame;
+    });
+
+    // geometry goes back to geometry buffer once frames in flight are done, objects draw fallback meanwhile
+    for(Mesh* mesh : candidates){
+        if(residentMeshBytes <= meshResidencyBudget) break;
+        freeMesh(*mesh);
+        mesh->evicted = true;
+    }
+
+    if(residentMeshBytes > meshResidencyBudget && !residencyExceeded){
+        std::cerr << "[WARNING] Meshes in view need " << residentMeshBytes / double(1 << 20)
+                  << " MB of geometry, more than residency budget of " << meshResidencyBudget / double(1 << 20) << " MB" << std::endl;
+    }
+    residencyExceeded = residentMeshBytes > meshResidencyBudget;
+}
 
+// bytes of vertices and indices of mesh
+size_t Renderer::getMeshGeometrySize(const Mesh& mesh){
+    size_t size = size_t(mesh.vertexCount) * (getPositionStride(mesh.format) + getAttributeStride(mesh.format));
+    if(mesh.hasIndexBuffer) size += size_t(mesh.indexCount) * GeometryBuffer::getIndexSize(mesh.indexType);
+    return size;
+}
+
+// release geometry of meshes freed atleast bufferingSize frames ago
+void Renderer::releasePendingGeometry(){
+    size_t kept = 0;
+    for(const PendingGeometryFree& pending : pendingGeometryFrees){
+        if(frameNumber < pending.frame + bufferingSize){
+            pendingGeometryFrees[kept++] = pending;
+            continue;
+        }
+
+        if(pending.hasVertices) geometryBuffer.freeVertices(pending.format, pending.vertexOffset);
+        if(pending.hasIndices) geometryBuffer.freeIndices(pending.indexType, pending.firstIndex);
+    }
+    pendingGeometryFrees.resize(kept);
+}
+
+// draw on screen
+void Renderer::draw(const FrameSnapshot& snapshot){
     // wait for 1 seconds max
     uint64_t timeout = 1e9;
 
@@ -811,6 +1118,41 @@ void Renderer::draw(){
     // fence must be reset before use again
     VKCHECK(vkResetFences(device, 1, &currentFrame.renderFence));
 
+    // nothing of this frame's previous use is referenced anymore, transient
+    // data of this frame comes from its arena so drawing doesn't touch heap
+    currentFrame.arena.reset();
+
+    // refresh heap budgets, warns when a heap gets close to its budget
+    memoryBudget.update(frameNumber);
+
+    // load meshes nearest to camera first
+    updateStreaming(snapshot, currentFrame.arena);
+
+    // pick objects to draw and their levels of detail for camera of snapshot
+    ArenaVector<DrawItem> drawItems{ArenaAllocator<DrawItem>(currentFrame.arena)};
+    selectDrawItems(snapshot, drawItems);
+    if(terrain != nullptr){
+        terrain->select(snapshot.uniformData.viewPosition, snapshot.frustum, terrainSelection);
+    }
+
+    // free geometry of streamed meshes not drawn for longest while over residency budget
+    evictMeshes(currentFrame.arena);
+
+    // geometry of freed meshes can be reused once frames drawing them are done
+    releasePendingGeometry();
+
+    // uniform buffer of this frame is idle now, camera and lights come from snapshot
+    void* data;
+    vmaMapMemory(allocator, currentFrame.uniformBuffer.allocation, &data);
+    memcpy(data, &snapshot.uniformData, sizeof(UniformData));
+    vmaUnmapMemory(allocator, currentFrame.uniformBuffer.allocation);
+
+    // vertex buffers of this frame are idle now, bring edited vertices in
+    updateDynamicMeshes();
+
+    // submit all uploads recorded since last frame in a single batch
+    uploadManager.flush();
+
     // get image index
     uint32_t swapchainImageIndex;
     VkResult res = vkAcquireNextImageKHR(device, swapchain, timeout, currentFrame.presentSemaphore, VK_NULL_HANDLE, &swapchainImageIndex);
@@ -847,6 +1189,18 @@ void Renderer::draw(){
     // begin command buffer recording
     VKCHECK(vkBeginCommandBuffer(cmd, &beginInfo));
 
+    // take ownership of geometry uploaded on transfer queue, meshes of
+    // acquired uploads become drawable from this frame on, and can be moved by compaction
+    uploadManager.poll();
+    uploadManager.recordAcquireBarriers(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                        VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT);
+
+    // regenerate vertices of animated surfaces before they're drawn
+    recordSurfaceUpdates(cmd);
+
+    // move a few meshes out of fragmented parts of geometry buffer, draws below use their new ranges
+    recordGeometryCompaction(cmd, currentFrame.arena);
+
     // set a clear value to clear the screen with
     VkClearValue colorClear{
         .color = VkClearColorValue{
@@ -906,8 +1260,16 @@ void Renderer::draw(){
     };
     vkCmdSetScissor(cmd, 0, 1, &scissor);
 
-    // draw renderObjects
-    drawObjects(cmd, renderObjects.data(), renderObjects.size());
+    // lay down depth first so shading pass only shades visible pixels
+    if(depthPrepass){
+        drawObjects(cmd, drawItems.data(), drawItems.size(), true);
+    }
+
+    // draw objects of snapshot that passed culling
+    drawObjects(cmd, drawItems.data(), drawItems.size());
+
+    // terrain goes last since it binds its own descriptor sets
+    drawTerrain(cmd);
 
     // end renderpass
     vkCmdEndRenderPass(cmd);
@@ -966,6 +1328,102 @@ void Renderer::draw(){
     frameNumber++;
 }
 
+// copy state of scene needed to draw a frame
+void Renderer::captureSnapshot(const Camera& camera, FrameSnapshot& snapshot){
+    // matrices of objects moved since last capture, cheap when nothing is dirty
+    transforms.update();
+
+    snapshot.uniformData = uniformData;
+    snapshot.uniformData.viewMatrix = camera.getViewMatrix();
+    snapshot.uniformData.projectionMatrix = camera.getProjectionMatrix();
+    snapshot.uniformData.viewPosition = camera.getPosition();
+    snapshot.frustum = camera.getFrustum();
+    snapshot.fieldOfView = camera.getFieldOfView();
+    snapshot.nearPlane = camera.getNearPlane();
+
+    // objects keep capacity of snapshot, so a reused snapshot isn't reallocated
+    snapshot.objects.resize(renderObjects.size());
+    for(size_t i = 0; i < renderObjects.size(); i++){
+        const RenderObject& object = renderObjects[i];
+        ObjectSnapshot& copy = snapshot.objects[i];
+        copy.modelMatrix = object.getModelMatrix();
+        copy.normalMatrix = object.getNormalMatrix();
+        copy.color = object.getColor();
+        copy.mesh = object.getMesh();
+        copy.material = object.getMaterial();
+        copy.object = static_cast<uint32_t>(i);
+    }
+}
+
+// cull objects of snapshot and select level of detail of rest from their projected error
+void Renderer::selectDrawItems(const FrameSnapshot& snapshot, ArenaVector<DrawItem>& drawItems){
+    // at most every object is drawn, reserving avoids regrowing inside arena
+    drawItems.reserve(snapshot.objects.size());
+    if(objectLods.size() < snapshot.objects.size()) objectLods.resize(snapshot.objects.size(), 0);
+
+    float viewportHeight = static_cast<float>(swapchainImageExtent.height);
+
+    for(const ObjectSnapshot& object : snapshot.objects){
+        // draw fallback of meshes that aren't ready yet, if there's one
+        // handles are checked in O(1), objects of destroyed meshes are skipped
+        Mesh* requested = getMesh(object.mesh);
+        if(requested == nullptr) continue;
+        Mesh* mesh = requested;
+        if(!isMeshReady(*mesh)){
+            mesh = getMesh(mesh->fallback);
+            if(mesh == nullptr || !isMeshReady(*mesh)) continue;
+        }
+
+        // bounding sphere in world space
+        const glm::mat4& model = object.modelMatrix;
+        glm::vec3 center = glm::vec3(model * glm::vec4(mesh->boundsCenter, 1.f));
+        float scale = std::max({glm::length(glm::vec3(model[0])),
+                                glm::length(glm::vec3(model[1])),
+                                glm::length(glm::vec3(model[2]))});
+        float radius = mesh->boundsRadius * scale;
+
+        // meshes without bounds are never culled
+        if(mesh->boundsRadius > 0.f && !snapshot.frustum.intersectsSphere(center, radius)) continue;
+
+        // visible meshes and fallbacks drawn for them are the last to be evicted
+        requested->lastDrawnFrame = frameNumber;
+        mesh->lastDrawnFrame = frameNumber;
+
+        uint32_t& lod = objectLods[object.object];
+        if(mesh->lods.size() < 2){
+            lod = 0;
+            drawItems.push_back({&object, mesh, lod});
+            continue;
+        }
+
+        float distance = glm::length(center - snapshot.uniformData.viewPosition) - radius;
+
+        // size on screen of one object space unit
+        float pixelsPerUnit = snapshot.getProjectedSize(scale, distance, viewportHeight);
+
+        // coarsest level whose projected error is within given limit
+        // error grows with level so it's enough to look for last one within limit
+        auto coarsestWithin = [&](float limit){
+            uint32_t level = 0;
+            for(uint32_t l = 1; l < mesh->lods.size(); l++){
+                if(mesh->lods[l].error * pixelsPerUnit <= limit) level = l;
+            }
+            return level;
+        };
+
+        // switch to finer level as soon as current one exceeds the limit,
+        // but to coarser level only when it's comfortably within limit
+        uint32_t current = std::min<uint32_t>(lod, mesh->lods.size() - 1);
+        if(mesh->lods[current].error * pixelsPerUnit > lodPixelError){
+            lod = coarsestWithin(lodPixelError);
+        }else{
+            lod = std::max(current, coarsestWithin(lodPixelError * (1.f - lodHysteresis)));
+        }
+
+        drawItems.push_back({&object, mesh, lod});
+    }
+}
+
 // initialize descriptor sets
 // descriptor sets are used to send uniform data
 void Renderer::initDescriptors(){
@@ -976,8 +1434,10 @@ void Renderer::initDescriptors(){
     // pass these descriptor set layouts in pipeline layout
 
     // create a descriptor pool that'll hold 10 uniform buffers
+    // and 10 storage buffers for gpu generated geometry
     std::vector<VkDescriptorPoolSize> sizes = {
-        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 10}
+        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 10},
+        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10}
     };
 
     // descriptor pool create info
@@ -1032,7 +1492,8 @@ void Renderer::initDescriptors(){
     // allocate buffers, allocate one descriptor set per frame and write to each descriptor set with camera data
     for(uint32_t i = 0; i < bufferingSize; i++){
         // create buffer that the uniform descriptor will point to
-        frames[i].uniformBuffer = createBuffer(sizeof(UniformData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        frames[i].uniformBuffer = createBuffer(sizeof(UniformData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU,
+                                               MemoryCategory::Uniform);
 
         // allocate descriptor set per frame data
         VkDescriptorSetAllocateInfo setAllocInfo = {};
@@ -1087,15 +1548,10 @@ void Renderer::initDescriptors(){
 // create graphics pipeline
 void Renderer::initGraphicsPipeline(){
     // load fragmment shader
-    if(loadShaderModule("../shaders/compiled/mesh_shader.frag.spv", device, meshFS) != SUCCESS){
+    if(loadShaderModule(SHADER_DIR "mesh_shader.frag.spv", device, meshFS) != SUCCESS){
         std::cerr << "[ERROR] Failed to create fragment shader module" << std::endl;
     }
 
-    // load vertex shader
-    if(loadShaderModule("../shaders/compiled/mesh_shader.vert.spv", device, meshVS) != SUCCESS){
-        std::cerr << "[ERROR] Failed to create vertex shader module" << std::endl;
-    }
-
     // build the pipeline layout that controls the inputs/outputs of the shader
     VkPipelineLayoutCreateInfo pipelineLayoutInfo = defaultPipelineLayoutCreateInfo();
 
@@ -1116,24 +1572,12 @@ void Renderer::initGraphicsPipeline(){
     // create pipeline layout
     VKCHECK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &meshPipelineLayout));
 
-    // set shader stages
-    pipelineBuilder.shaderStages = {
-        defaultPipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, meshVS),
-        defaultPipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, meshFS)
-    };
-
     // get vertex input binding descriptions and attribute descriptions
-    // make this static as we'll need to create pipeline again and builder
-    // stores only pointer to this!
-    static VertexInputDescription vertexDescription = Vertex::getVertexDescription();
-
-    // vertex input controls how vertex is read from vertex buffers
-    pipelineBuilder.vertexInputInfo = defaultPipelineVertexInputStateCreateInfo();
-    // connect the pipeline builder vertex input info to the one we get from Vertex
-    pipelineBuilder.vertexInputInfo.pVertexAttributeDescriptions = vertexDescription.attributes.data();
-    pipelineBuilder.vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexDescription.attributes.size());
-    pipelineBuilder.vertexInputInfo.pVertexBindingDescriptions = vertexDescription.bindings.data();
-    pipelineBuilder.vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexDescription.bindings.size());
+    // keep them as members as builder stores only pointer to these!
+    vertexDescriptions[static_cast<size_t>(VertexFormat::Float)] = Vertex::getVertexDescription();
+    vertexDescriptions[static_cast<size_t>(VertexFormat::Packed)] = PackedVertex::getVertexDescription();
+    positionDescriptions[static_cast<size_t>(VertexFormat::Float)] = Vertex::getPositionDescription();
+    positionDescriptions[static_cast<size_t>(VertexFormat::Packed)] = PackedVertex::getPositionDescription();
 
     // input assembly is how to use given input and assemble to draw something
     // we are use input array as a list triangles
@@ -1164,23 +1608,83 @@ void Renderer::initGraphicsPipeline(){
     // triangle pipeline layout
     pipelineBuilder.pipelineLayout = meshPipelineLayout;
 
-    // build pipeline
-    meshPipeline = pipelineBuilder.buildPipeline(device, renderPass);
-    assert(meshPipeline && "FAILED TO CREATE PIPELINE");
+    // build one pipeline variant per vertex format
+    meshPipelines[static_cast<size_t>(VertexFormat::Float)] =
+        buildMeshPipeline(SHADER_DIR "mesh_shader.vert.spv", meshFS, vertexDescriptions[static_cast<size_t>(VertexFormat::Float)]);
+    assert(meshPipelines[static_cast<size_t>(VertexFormat::Float)] && "FAILED TO CREATE PIPELINE");
+
+    // packed variant is optional, meshes fall back to full precision vertices without it
+    meshPipelines[static_cast<size_t>(VertexFormat::Packed)] =
+        buildMeshPipeline(SHADER_DIR "mesh_shader_packed.vert.spv", meshFS, vertexDescriptions[static_cast<size_t>(VertexFormat::Packed)]);
+
+    // depth only pipelines write depth and nothing else, no fragment shader needed
+    // unorm positions are fetched as floats, so one vertex shader serves all formats
+    pipelineBuilder.colorBlendAttachment.colorWriteMask = 0;
+    for(size_t f = 0; f < VertexFormatCount; f++){
+        depthPipelines[f] = buildMeshPipeline(SHADER_DIR "depth_only.vert.spv", VK_NULL_HANDLE, positionDescriptions[f]);
+    }
+    pipelineBuilder.colorBlendAttachment = defaultPipelineColorBlendAttachmentState();
+
+    // prepass can't be done without depth pipelines
+    if(depthPipelines[static_cast<size_t>(VertexFormat::Float)] == VK_NULL_HANDLE){
+        std::cerr << "[WARNING] Depth only pipeline unavailable, depth prepass disabled" << std::endl;
+    }
+
+    // terrain is shaded like meshes, so it's built while fragment shader is around
+    initTerrainPipeline(meshFS);
 
     // destroy shader modules
-    vkDestroyShaderModule(device, meshVS, nullptr);
     vkDestroyShaderModule(device, meshFS, nullptr);
 
     // these objects will be destroyed in the end
     mainDeletionQueue.push_function([=](){
         // destroy pipeline layout
         vkDestroyPipelineLayout(device, meshPipelineLayout, nullptr);
-        // destroy pipeline
-        vkDestroyPipeline(device, meshPipeline, nullptr);
+        // destroy pipelines
+        for(VkPipeline pipeline : meshPipelines){
+            if(pipeline != VK_NULL_HANDLE) vkDestroyPipeline(device, pipeline, nullptr);
+        }
+        for(VkPipeline pipeline : depthPipelines){
+            if(pipeline != VK_NULL_HANDLE) vkDestroyPipeline(device, pipeline, nullptr);
+        }
     });
 
-    createMaterial(meshPipeline, meshPipelineLayout, "defaultMaterial");
+    createMaterial(meshPipelines, meshPipelineLayout, "defaultMaterial");
+}
+
+// build mesh pipeline with given shaders and vertex input
+VkPipeline Renderer::buildMeshPipeline(const char* vertexShaderPath, VkShaderModule fragmentShader,
+                                       const VertexInputDescription& vertexDescription){
+    // load vertex shader
+    VkShaderModule vertexShader;
+    if(loadShaderModule(vertexShaderPath, device, vertexShader) != SUCCESS){
+        std::cerr << "[ERROR] Failed to create vertex shader module from \"" << vertexShaderPath << "\"" << std::endl;
+        return VK_NULL_HANDLE;
+    }
+
+    // set shader stages
+    pipelineBuilder.shaderStages = {
+        defaultPipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertexShader)
+    };
+    if(fragmentShader != VK_NULL_HANDLE){
+        pipelineBuilder.shaderStages.push_back(defaultPipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShader));
+    }
+
+    // vertex input controls how vertex is read from vertex buffers
+    pipelineBuilder.vertexInputInfo = defaultPipelineVertexInputStateCreateInfo();
+    // connect the pipeline builder vertex input info to the given one
+    pipelineBuilder.vertexInputInfo.pVertexAttributeDescriptions = vertexDescription.attributes.data();
+    pipelineBuilder.vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexDescription.attributes.size());
+    pipelineBuilder.vertexInputInfo.pVertexBindingDescriptions = vertexDescription.bindings.data();
+    pipelineBuilder.vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexDescription.bindings.size());
+
+    // build pipeline
+    VkPipeline pipeline = pipelineBuilder.buildPipeline(device, renderPass);
+
+    // shader module isn't needed after pipeline creation
+    vkDestroyShaderModule(device, vertexShader, nullptr);
+
+    return pipeline;
 }
 
 // recreate swapchain on window resize
@@ -1220,11 +1724,12 @@ void Renderer::cleanupSwapchain(){
 
 // when window is resized
 void Renderer::windowResized(){
-    recreateSwapchain();
+    // swapchain is recreated by next draw, on thread owning it
+    framebufferResized = true;
 }
 
 // allocate buffer
-AllocatedBuffer Renderer::createBuffer(size_t allocSize, VkBufferUsageFlags usageFlags, VmaMemoryUsage memoryUsage){
+AllocatedBuffer Renderer::createBuffer(size_t allocSize, VkBufferUsageFlags usageFlags, VmaMemoryUsage memoryUsage, MemoryCategory category){
     VkBufferCreateInfo bufferInfo = {};
     bufferInfo.sType = STYPE(BUFFER_CREATE_INFO);
     bufferInfo.pNext = nullptr;
@@ -1239,84 +1744,771 @@ AllocatedBuffer Renderer::createBuffer(size_t allocSize, VkBufferUsageFlags usag
 
     // allocate buffer
     VKCHECK(vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &allocatedBuffer.buffer, &allocatedBuffer.allocation, nullptr));
+    memoryBudget.track(category, allocatedBuffer.allocation);
 
     // add to deletion queue
     mainDeletionQueue.push_function([=](){
+        memoryBudget.untrack(category, allocatedBuffer.allocation);
         vmaDestroyBuffer(allocator, allocatedBuffer.buffer, allocatedBuffer.allocation);
     });
 
     return allocatedBuffer;
 }
 
-// create material and return address
-Material* Renderer::createMaterial(VkPipeline pipeline, VkPipelineLayout layout, const std::string& name){
+// create material and return its handle
+MaterialHandle Renderer::createMaterial(VkPipeline pipeline, VkPipelineLayout layout, StringId name){
+    std::array<VkPipeline, VertexFormatCount> pipelines;
+    pipelines.fill(pipeline);
+    return createMaterial(pipelines, layout, name);
+}
+
+// create material with per format pipelines and return its handle
+MaterialHandle Renderer::createMaterial(const std::array<VkPipeline, VertexFormatCount>& pipelines,
+                                        VkPipelineLayout layout, StringId name){
     Material m;
-    m.pipeline = pipeline;
+    m.pipelines = pipelines;
     m.pipelineLayout = layout;
 
-    materials[name] = m;
-    return &materials[name];
+    return materials.create(std::move(m), name);
 }
 
-// get material by name
-Material* Renderer::getMaterial(const std::string& name){
-    auto it = materials.find(name);
-    if(it == materials.end()){
-        return nullptr;
+// add mesh to pool and return its handle
+MeshHandle Renderer::createMesh(Mesh&& mesh, StringId name){
+    MeshHandle handle = meshes.create(std::move(mesh), name);
+    if(!handle) std::cerr << "[ERROR] Too many meshes, mesh not created" << std::endl;
+    return handle;
+}
+
+// free gpu memory of mesh and remove it from pool
+void Renderer::destroyMesh(MeshHandle handle){
+    Mesh* mesh = getMesh(handle);
+    if(mesh == nullptr) return;
+
+    if(mesh->dynamic){
+        std::cerr << "[WARNING] Dynamic meshes keep their buffers until cleanup" << std::endl;
+        return;
     }
 
-    return &(*it).second;
+    freeMesh(*mesh);
+    streamedMeshPaths.erase(handle);
+    meshes.destroy(handle);
 }
 
-// get mesh by name
-Mesh* Renderer::getMesh(const std::string& name){
-     auto it = meshes.find(name);
-    if(it == meshes.end()){
-        return nullptr;
-    }
+// get shared mesh of primitive, created on first request
+MeshHandle Renderer::getPrimitive(PrimitiveType type, uint32_t tessellation){
+    // tessellations creating same mesh share it
+    tessellation = clampTessellation(type, tessellation);
+    StringId name(getPrimitiveName(type, tessellation));
+    MeshHandle existing = findMesh(name);
+    if(existing) return existing;
+
+    Mesh mesh;
+    createPrimitive(mesh, type, tessellation);
+    MeshHandle handle = createMesh(std::move(mesh), name);
+    if(handle) uploadMesh(*getMesh(handle));
 
-    return &(*it).second;
+    return handle;
 }
 
-// draw a list of renderObjects
-void Renderer::drawObjects(VkCommandBuffer cmd, RenderObject* first, size_t count){
-    // store last mesh and last material to reduce total number of bindings in for loop
-    Mesh* lastMesh = nullptr;
-    Material* lastMaterial = nullptr;
+// draw a list of objects selected from snapshot
+void Renderer::drawObjects(VkCommandBuffer cmd, const DrawItem* first, size_t count, bool depthOnly){
+    // store last pipeline and bound geometry to reduce total number of bindings in for loop
+    // all meshes share geometry buffer, so it's rebound only when vertex format or index type changes
+    VkPipeline lastPipeline = VK_NULL_HANDLE;
+    int boundFormat = -1;
+    int boundIndexType = -1;
 
     // data to be sent for every object
     PushData pushConstants;
 
     for(size_t i = 0; i < count; i++){
-        // get object data to be drawn
-        RenderObject& object = first[i];
+        // get object data to be drawn, mesh is ready since it was selected
+        const ObjectSnapshot& object = *first[i].object;
+        const Mesh* mesh = first[i].mesh;
 
         // bind new pipeline if and only if it doesn't match the previous one
-        if(object.getMaterial() != lastMaterial){
-            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, object.getMaterial()->pipeline);
-            lastMaterial = object.getMaterial();
+        // variant depends on both material and vertex format of mesh
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        if(depthOnly) pipeline = depthPipelines[static_cast<size_t>(mesh->format)];
+        else if(const Material* material = getMaterial(object.material)) pipeline = material->getPipeline(mesh->format);
+        if(pipeline == VK_NULL_HANDLE) continue;
+        if(pipeline != lastPipeline){
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            lastPipeline = pipeline;
         }
 
         // send object model matrix for every object
-        pushConstants.objectModelMatrix = object.getModelMatrix();
+        // packed positions are brought back to object space by the same matrix
+        pushConstants.objectModelMatrix = object.modelMatrix;
+        if(mesh->format != VertexFormat::Float){
+            pushConstants.objectModelMatrix *= mesh->getDequantizationMatrix();
+        }
+        pushConstants.normalMatrix = object.normalMatrix;
+        pushConstants.color = object.color;
         vkCmdPushConstants(cmd, meshPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushData), &pushConstants);
 
-        // bind mesh only if it's different from last one
-        if(object.getMesh() != lastMesh){
-            VkDeviceSize offset = 0;
-            vkCmdBindVertexBuffers(cmd, 0, 1, &object.getMesh()->vertexBuffer.buffer, &offset);
-            lastMesh = object.getMesh();
-
-            if(object.getMesh()->hasIndexBuffer){
-                vkCmdBindIndexBuffer(cmd, object.getMesh()->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-            }
+        // dynamic meshes have their own streams for every frame in flight
+        if(const DynamicMesh* dynamicMesh = getDynamicMesh(mesh->dynamic)){
+            const DynamicMesh::FrameCopy& copy = dynamicMesh->frames[frameNumber % bufferingSize];
+            VkBuffer vertexBuffers[2] = {copy.positionBuffer.buffer, copy.attributeBuffer.buffer};
+            VkDeviceSize offsets[2] = {0, 0};
+            vkCmdBindVertexBuffers(cmd, 0, depthOnly ? 1 : 2, vertexBuffers, offsets);
+            boundFormat = -1;
+        }
+        // bind vertex streams of mesh format if they aren't bound already
+        else if(static_cast<int>(mesh->format) != boundFormat){
+            // depth only pipelines read position stream only
+            VkBuffer vertexBuffers[2] = {geometryBuffer.getPositionBuffer(mesh->format),
+                                         geometryBuffer.getAttributeBuffer(mesh->format)};
+            VkDeviceSize offsets[2] = {0, 0};
+            vkCmdBindVertexBuffers(cmd, 0, depthOnly ? 1 : 2, vertexBuffers, offsets);
+            boundFormat = static_cast<int>(mesh->format);
         }
 
         // finally draw this object
         // if index draw
-        if(object.getMesh()->hasIndexBuffer)
-            vkCmdDrawIndexed(cmd, object.getMesh()->indices.size(), 1, 0, 0, 0);
+        if(mesh->hasIndexBuffer){
+            // same index buffer is bound as 16 or 32 bit depending on mesh
+            if(static_cast<int>(mesh->indexType) != boundIndexType){
+                vkCmdBindIndexBuffer(cmd, geometryBuffer.getIndexBuffer(), 0, mesh->indexType);
+                boundIndexType = static_cast<int>(mesh->indexType);
+            }
+
+            // draw selected level of detail, whole index range if mesh has no levels
+            if(!mesh->lods.empty()){
+                const MeshLod& lod = mesh->lods[std::min<size_t>(first[i].lod, mesh->lods.size() - 1)];
+                vkCmdDrawIndexed(cmd, lod.indexCount, 1, mesh->firstIndex + lod.firstIndex, mesh->vertexOffset, 0);
+            }else vkCmdDrawIndexed(cmd, mesh->indexCount, 1, mesh->firstIndex, mesh->vertexOffset, 0);
+        }
         // if normal vertex draw
-        else vkCmdDraw(cmd, object.getMesh()->vertices.size(), 1, 0, 0);
+        else vkCmdDraw(cmd, mesh->vertexCount, 1, mesh->vertexOffset, 0);
+    }
+}
+
+// create descriptor set layout, pipeline layout and descriptor sets of surface kernels
+void Renderer::initSurfaceGeneration(){
+    // binding 0 is position stream, binding 1 is attribute stream
+    VkDescriptorSetLayoutBinding bindings[2] = {};
+    for(uint32_t b = 0; b < 2; b++){
+        bindings[b].binding = b;
+        bindings[b].descriptorCount = 1;
+        bindings[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[b].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo setLayoutInfo = {};
+    setLayoutInfo.sType = STYPE(DESCRIPTOR_SET_LAYOUT_CREATE_INFO);
+    setLayoutInfo.pNext = nullptr;
+    setLayoutInfo.flags = 0;
+    setLayoutInfo.bindingCount = 2;
+    setLayoutInfo.pBindings = bindings;
+    VKCHECK(vkCreateDescriptorSetLayout(device, &setLayoutInfo, nullptr, &surfaceDescriptorSetLayout));
+
+    // parameters are the only data sent with every update
+    VkPushConstantRange pushConstant = {};
+    pushConstant.offset = 0;
+    pushConstant.size = sizeof(SurfaceParameters);
+    pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = defaultPipelineLayoutCreateInfo();
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &surfaceDescriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstant;
+    VKCHECK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &surfacePipelineLayout));
+
+    // one set per frame, so a set is only rewritten when its frame is done
+    for(uint32_t i = 0; i < bufferingSize; i++){
+        VkDescriptorSetAllocateInfo setAllocInfo = {};
+        setAllocInfo.sType = STYPE(DESCRIPTOR_SET_ALLOCATE_INFO);
+        setAllocInfo.pNext = nullptr;
+        setAllocInfo.descriptorPool = descriptorPool;
+        setAllocInfo.descriptorSetCount = 1;
+        setAllocInfo.pSetLayouts = &surfaceDescriptorSetLayout;
+        VKCHECK(vkAllocateDescriptorSets(device, &setAllocInfo, &frames[i].surfaceDescriptorSet));
+    }
+
+    mainDeletionQueue.push_function([=](){
+        for(auto& [path, pipeline] : surfacePipelines){
+            vkDestroyPipeline(device, pipeline, nullptr);
+        }
+        vkDestroyPipelineLayout(device, surfacePipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(device, surfaceDescriptorSetLayout, nullptr);
+    });
+}
+
+// load surface kernel and create its compute pipeline
+VkPipeline Renderer::getSurfacePipeline(const char* kernelPath){
+    auto it = surfacePipelines.find(kernelPath);
+    if(it != surfacePipelines.end()) return it->second;
+
+    VkShaderModule kernel;
+    if(loadShaderModule(kernelPath, device, kernel) != SUCCESS){
+        std::cerr << "[ERROR] Failed to create compute shader module from \"" << kernelPath << "\"" << std::endl;
+        return VK_NULL_HANDLE;
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = STYPE(COMPUTE_PIPELINE_CREATE_INFO);
+    pipelineInfo.pNext = nullptr;
+    pipelineInfo.stage = defaultPipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, kernel);
+    pipelineInfo.layout = surfacePipelineLayout;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult res = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+    vkDestroyShaderModule(device, kernel, nullptr);
+    if(res != VK_SUCCESS){
+        std::cerr << "[ERROR] Failed to create compute pipeline for \"" << kernelPath << "\"" << std::endl;
+        return VK_NULL_HANDLE;
+    }
+
+    surfacePipelines[kernelPath] = pipeline;
+    return pipeline;
+}
+
+// create a surface generated on gpu
+GpuSurfaceHandle Renderer::createGpuSurface(StringId name, const char* kernelPath,
+                                            uint32_t resolutionX, uint32_t resolutionY,
+                                            const glm::vec2& rangeMin, const glm::vec2& rangeMax){
+    if(resolutionX < 2 || resolutionY < 2){
+        std::cerr << "[ERROR] Gpu surface needs at least 2x2 grid points" << std::endl;
+        return {};
+    }
+    // vertex and index counts of grid have to fit in 32 bits
+    if(uint64_t(resolutionX) * resolutionY > UINT32_MAX ||
+       uint64_t(resolutionX - 1) * (resolutionY - 1) * 6 > UINT32_MAX){
+        std::cerr << "[ERROR] Gpu surface grid of " << resolutionX << "x" << resolutionY << " points is too large" << std::endl;
+        return {};
+    }
+
+    VkPipeline pipeline = getSurfacePipeline(kernelPath);
+    if(pipeline == VK_NULL_HANDLE) return {};
+
+    // surface of same name is replaced, objects drawing its mesh draw new one
+    MeshHandle meshHandle = findMesh(name);
+    if(!meshHandle) meshHandle = createMesh(Mesh{}, name);
+    Mesh* existing = getMesh(meshHandle);
+    if(existing == nullptr) return {};
+    Mesh& mesh = *existing;
+    if(mesh.uploaded) freeMesh(mesh);
+    mesh = Mesh{};
+
+    // kernels write full precision vertices, geometry buffer only reserves space for them
+    mesh.format = VertexFormat::Float;
+    mesh.vertexCount = resolutionX * resolutionY;
+    mesh.vertexOffset = geometryBuffer.allocateVertices(mesh.format, mesh.vertexCount);
+
+    // index grid never changes, so it's uploaded only once
+    createGridIndices(mesh.indices, resolutionX, resolutionY);
+    mesh.hasIndexBuffer = true;
+    mesh.optimized = true;
+    std::vector<uint8_t> indices;
+    mesh.encodeIndices(indices);
+    mesh.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    mesh.firstIndex = geometryBuffer.allocateIndices(mesh.indexType, mesh.indexCount);
+    mesh.uploadTicket = uploadManager.upload(indices.data(), indices.size(), geometryBuffer.getIndexBuffer(),
+                                             mesh.firstIndex * GeometryBuffer::getIndexSize(mesh.indexType));
+    mesh.uploaded = true;
+    residentMeshBytes += getMeshGeometrySize(mesh);
+
+    // rough bounds of parameter range, exact ones are only known on gpu
+    mesh.boundsCenter = glm::vec3(0.5f * (rangeMin.x + rangeMax.x), 0.f, 0.5f * (rangeMin.y + rangeMax.y));
+    mesh.boundsRadius = 0.5f * glm::length(rangeMax - rangeMin);
+
+    GpuSurface surface;
+    surface.mesh = meshHandle;
+    surface.pipeline = pipeline;
+    surface.parameters.rangeMin = rangeMin;
+    surface.parameters.rangeMax = rangeMax;
+    surface.parameters.resolutionX = resolutionX;
+    surface.parameters.resolutionY = resolutionY;
+    surface.parameters.vertexOffset = mesh.vertexOffset;
+
+    gpuSurfaces.destroy(findGpuSurface(name));
+    return gpuSurfaces.create(std::move(surface), name);
+}
+
+// move meshes into free ranges before them while geometry buffer is fragmented
+void Renderer::recordGeometryCompaction(VkCommandBuffer cmd, FrameArena& arena){
+    if(geometryCompactionBytes == 0) return;
+
+    std::array<bool, VertexFormatCount> fragmentedVertices;
+    bool anyFragmented = false;
+    for(size_t f = 0; f < VertexFormatCount; f++){
+        fragmentedVertices[f] = geometryBuffer.getVertexFragmentation(static_cast<VertexFormat>(f)) > geometryCompactionThreshold;
+        anyFragmented |= fragmentedVertices[f];
+    }
+    bool fragmentedIndices = geometryBuffer.getIndexFragmentation() > geometryCompactionThreshold;
+    if(!anyFragmented && !fragmentedIndices) return;
+
+    // only meshes whose upload is acquired, dynamic meshes keep vertices in their own buffers
+    // and terrain patch isn't in pool, ranges closest to end of buffers are moved first
+    ArenaVector<Mesh*> vertexCandidates{ArenaAllocator<Mesh*>(arena)};
+    ArenaVector<Mesh*> indexCandidates{ArenaAllocator<Mesh*>(arena)};
+    for(Mesh& mesh : meshes){
+        if(!isMeshReady(mesh) || mesh.dynamic) continue;
+        if(fragmentedVertices[static_cast<size_t>(mesh.format)]) vertexCandidates.push_back(&mesh);
+        if(fragmentedIndices && mesh.hasIndexBuffer && mesh.indexCount > 0) indexCandidates.push_back(&mesh);
+    }
+    std::sort(vertexCandidates.begin(), vertexCandidates.end(), [](const Mesh* a, const Mesh* b){
+        return a->vertexOffset > b->vertexOffset;
+    });
+    std::sort(indexCandidates.begin(), indexCandidates.end(), [](const Mesh* a, const Mesh* b){
+        return a->firstIndex * GeometryBuffer::getIndexSize(a->indexType) > b->firstIndex * GeometryBuffer::getIndexSize(b->indexType);
+    });
+
+    // old ranges are given back once frames in flight drawing from them are done
+    auto releaseLater = [this](const PendingGeometryFree& pending){
+        pendingGeometryFrees.push_back(pending);
+        pendingGeometryFrees.back().frame = frameNumber;
+    };
+
+    size_t movedBytes = 0;
+    uint32_t attempts = 0;
+    for(Mesh* mesh : vertexCandidates){
+        if(movedBytes >= geometryCompactionBytes || attempts++ >= geometryCompactionAttempts) break;
+
+        uint32_t offset = geometryBuffer.moveVertices(cmd, mesh->format, mesh->vertexOffset);
+        if(offset == GeometryBuffer::invalidOffset) continue;
+
+        PendingGeometryFree pending = {};
+        pending.hasVertices = true;
+        pending.format = mesh->format;
+        pending.vertexOffset = mesh->vertexOffset;
+        releaseLater(pending);
+
+        mesh->vertexOffset = offset;
+        movedBytes += mesh->vertexCount * (getPositionStride(mesh->format) + getAttributeStride(mesh->format));
+    }
+    for(Mesh* mesh : indexCandidates){
+        if(movedBytes >= geometryCompactionBytes || attempts++ >= geometryCompactionAttempts) break;
+
+        uint32_t firstIndex = geometryBuffer.moveIndices(cmd, mesh->indexType, mesh->firstIndex);
+        if(firstIndex == GeometryBuffer::invalidOffset) continue;
+
+        PendingGeometryFree pending = {};
+        pending.hasIndices = true;
+        pending.indexType = mesh->indexType;
+        pending.firstIndex = mesh->firstIndex;
+        releaseLater(pending);
+
+        mesh->firstIndex = firstIndex;
+        movedBytes += mesh->indexCount * GeometryBuffer::getIndexSize(mesh->indexType);
+    }
+    if(movedBytes == 0) return;
+
+    // moved geometry is drawn this frame, and regenerated by surface kernels or moved again later
+    VkMemoryBarrier barrier = {};
+    barrier.sType = STYPE(MEMORY_BARRIER);
+    barrier.pNext = nullptr;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                            VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+// generate vertices of dirty surfaces
+void Renderer::recordSurfaceUpdates(VkCommandBuffer cmd){
+    // surfaces are packed in pool, so this walks contiguous memory
+    bool anyDirty = false;
+    for(GpuSurface& surface : gpuSurfaces){
+        const Mesh* mesh = getMesh(surface.mesh);
+        anyDirty |= surface.dirty && mesh != nullptr && mesh->uploaded;
+    }
+    if(!anyDirty) return;
+
+    // point descriptors of this frame at current vertex streams, they change when geometry buffer grows
+    FrameData& frame = getCurrentFrame();
+    VkBuffer positionBuffer = geometryBuffer.getPositionBuffer(VertexFormat::Float);
+    VkBuffer attributeBuffer = geometryBuffer.getAttributeBuffer(VertexFormat::Float);
+    if(frame.surfacePositionBuffer != positionBuffer || frame.surfaceAttributeBuffer != attributeBuffer){
+        VkDescriptorBufferInfo bufferInfos[2] = {};
+        bufferInfos[0].buffer = positionBuffer;
+        bufferInfos[0].offset = 0;
+        bufferInfos[0].range = VK_WHOLE_SIZE;
+        bufferInfos[1].buffer = attributeBuffer;
+        bufferInfos[1].offset = 0;
+        bufferInfos[1].range = VK_WHOLE_SIZE;
+
+        VkWriteDescriptorSet setWrites[2] = {};
+        for(uint32_t b = 0; b < 2; b++){
+            setWrites[b].sType = STYPE(WRITE_DESCRIPTOR_SET);
+            setWrites[b].pNext = nullptr;
+            setWrites[b].dstBinding = b;
+            setWrites[b].dstSet = frame.surfaceDescriptorSet;
+            setWrites[b].descriptorCount = 1;
+            setWrites[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            setWrites[b].pBufferInfo = &bufferInfos[b];
+        }
+        vkUpdateDescriptorSets(device, 2, setWrites, 0, nullptr);
+
+        frame.surfacePositionBuffer = positionBuffer;
+        frame.surfaceAttributeBuffer = attributeBuffer;
+    }
+
+    // frames still in flight may be reading old vertices, wait for their vertex fetch
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, surfacePipelineLayout, 0, 1,
+                            &frame.surfaceDescriptorSet, 0, nullptr);
+
+    VkPipeline lastPipeline = VK_NULL_HANDLE;
+    for(GpuSurface& surface : gpuSurfaces){
+        const Mesh* mesh = getMesh(surface.mesh);
+        if(!surface.dirty || mesh == nullptr || !mesh->uploaded) continue;
+
+        if(surface.pipeline != lastPipeline){
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, surface.pipeline);
+            lastPipeline = surface.pipeline;
+        }
+
+        // only parameters travel to gpu, 8x8 grid points per workgroup
+        surface.parameters.vertexOffset = mesh->vertexOffset;
+        vkCmdPushConstants(cmd, surfacePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                           sizeof(SurfaceParameters), &surface.parameters);
+        vkCmdDispatch(cmd, (surface.parameters.resolutionX + 7) / 8, (surface.parameters.resolutionY + 7) / 8, 1);
+
+        surface.dirty = false;
+    }
+
+    // generated vertices are fetched by draws and copied if geometry buffer grows
+    VkMemoryBarrier barrier = {};
+    barrier.sType = STYPE(MEMORY_BARRIER);
+    barrier.pNext = nullptr;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+// create descriptor set layout, pipeline layout and pipeline of terrain
+void Renderer::initTerrainPipeline(VkShaderModule fragmentShader){
+    // heightmap is read by vertex shader only
+    VkDescriptorSetLayoutBinding heightBinding = {};
+    heightBinding.binding = 0;
+    heightBinding.descriptorCount = 1;
+    heightBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    heightBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo setLayoutInfo = {};
+    setLayoutInfo.sType = STYPE(DESCRIPTOR_SET_LAYOUT_CREATE_INFO);
+    setLayoutInfo.pNext = nullptr;
+    setLayoutInfo.flags = 0;
+    setLayoutInfo.bindingCount = 1;
+    setLayoutInfo.pBindings = &heightBinding;
+    VKCHECK(vkCreateDescriptorSetLayout(device, &setLayoutInfo, nullptr, &terrainDescriptorSetLayout));
+
+    // heightmap doesn't change while it's drawn, so one set serves all frames
+    VkDescriptorSetAllocateInfo setAllocInfo = {};
+    setAllocInfo.sType = STYPE(DESCRIPTOR_SET_ALLOCATE_INFO);
+    setAllocInfo.pNext = nullptr;
+    setAllocInfo.descriptorPool = descriptorPool;
+    setAllocInfo.descriptorSetCount = 1;
+    setAllocInfo.pSetLayouts = &terrainDescriptorSetLayout;
+    VKCHECK(vkAllocateDescriptorSets(device, &setAllocInfo, &terrainDescriptorSet));
+
+    // camera data in set 0 like meshes, heightmap in set 1
+    VkDescriptorSetLayout setLayouts[2] = {globalDescriptorSetLayout, terrainDescriptorSetLayout};
+
+    VkPushConstantRange pushConstant = {};
+    pushConstant.offset = 0;
+    pushConstant.size = sizeof(TerrainParameters);
+    pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = defaultPipelineLayoutCreateInfo();
+    pipelineLayoutInfo.setLayoutCount = 2;
+    pipelineLayoutInfo.pSetLayouts = setLayouts;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstant;
+    VKCHECK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &terrainPipelineLayout));
+
+    // builder keeps pointers to vertex description, so it's a member
+    terrainVertexDescription = TerrainNode::getVertexDescription();
+    pipelineBuilder.pipelineLayout = terrainPipelineLayout;
+    terrainPipeline = buildMeshPipeline(SHADER_DIR "terrain.vert.spv", fragmentShader, terrainVertexDescription);
+    pipelineBuilder.pipelineLayout = meshPipelineLayout;
+
+    if(terrainPipeline == VK_NULL_HANDLE){
+        std::cerr << "[WARNING] Terrain pipeline unavailable, terrains won't be drawn" << std::endl;
+    }
+
+    mainDeletionQueue.push_function([=](){
+        if(terrainHeightBuffer.buffer != VK_NULL_HANDLE){
+            memoryBudget.untrack(MemoryCategory::Mesh, terrainHeightBuffer.allocation);
+            vmaDestroyBuffer(allocator, terrainHeightBuffer.buffer, terrainHeightBuffer.allocation);
+        }
+        if(terrainPipeline != VK_NULL_HANDLE) vkDestroyPipeline(device, terrainPipeline, nullptr);
+        vkDestroyPipelineLayout(device, terrainPipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(device, terrainDescriptorSetLayout, nullptr);
+    });
+}
+
+// upload heightmap and patch of terrain
+ReturnCode Renderer::uploadTerrain(Terrain& newTerrain){
+    if(terrainPipeline == VK_NULL_HANDLE){
+        std::cerr << "[WARNING] Terrain pipeline unavailable, not uploading terrain" << std::endl;
+        return FAILED;
+    }
+
+    const std::vector<float>& heights = newTerrain.getHeights();
+    if(heights.empty()){
+        std::cerr << "[ERROR] Not uploading terrain without heightmap" << std::endl;
+        return FAILED;
+    }
+
+    // frames in flight may still read heightmap of terrain being replaced
+    if(terrainHeightBuffer.buffer != VK_NULL_HANDLE){
+        vkDeviceWaitIdle(device);
+        memoryBudget.untrack(MemoryCategory::Mesh, terrainHeightBuffer.allocation);
+        vmaDestroyBuffer(allocator, terrainHeightBuffer.buffer, terrainHeightBuffer.allocation);
+        terrainHeightBuffer = {};
+        freeMesh(terrainPatch);
+    }
+
+    // heightmap is uploaded only once, through a staging buffer that's dropped right after
+    VkDeviceSize heightSize = heights.size() * sizeof(float);
+
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = STYPE(BUFFER_CREATE_INFO);
+    bufferInfo.pNext = nullptr;
+    bufferInfo.size = heightSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    VKCHECK(vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &terrainHeightBuffer.buffer,
+                            &terrainHeightBuffer.allocation, nullptr));
+    memoryBudget.track(MemoryCategory::Mesh, terrainHeightBuffer.allocation);
+
+    AllocatedBuffer staging;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    allocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+    VKCHECK(vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &staging.buffer, &staging.allocation, nullptr));
+    memoryBudget.track(MemoryCategory::Staging, staging.allocation);
+
+    void* data;
+    vmaMapMemory(allocator, staging.allocation, &data);
+    memcpy(data, heights.data(), heightSize);
+    vmaUnmapMemory(allocator, staging.allocation);
+
+    immediateSubmit([&](VkCommandBuffer cmd){
+        VkBufferCopy copyRegion = {};
+        copyRegion.srcOffset = 0;
+        copyRegion.dstOffset = 0;
+        copyRegion.size = heightSize;
+        vkCmdCopyBuffer(cmd, staging.buffer, terrainHeightBuffer.buffer, 1, &copyRegion);
+
+        // heights are read by vertex shader of following frames
+        VkMemoryBarrier barrier = {};
+        barrier.sType = STYPE(MEMORY_BARRIER);
+        barrier.pNext = nullptr;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+    });
+
+    memoryBudget.untrack(MemoryCategory::Staging, staging.allocation);
+    vmaDestroyBuffer(allocator, staging.buffer, staging.allocation);
+
+    // point heightmap descriptor at new buffer, no frame uses it right now
+    VkDescriptorBufferInfo heightInfo = {};
+    heightInfo.buffer = terrainHeightBuffer.buffer;
+    heightInfo.offset = 0;
+    heightInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet setWrite = {};
+    setWrite.sType = STYPE(WRITE_DESCRIPTOR_SET);
+    setWrite.pNext = nullptr;
+    setWrite.dstBinding = 0;
+    setWrite.dstSet = terrainDescriptorSet;
+    setWrite.descriptorCount = 1;
+    setWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    setWrite.pBufferInfo = &heightInfo;
+    vkUpdateDescriptorSets(device, 1, &setWrite, 0, nullptr);
+
+    // one small patch serves every node of every level
+    terrainPatch = Mesh{};
+    newTerrain.createPatchMesh(terrainPatch);
+    uploadMesh(terrainPatch);
+
+    // node buffers are written by cpu every frame, one per frame in flight
+    for(FrameData& frame : frames){
+        if(frame.terrainNodeBuffer.buffer != VK_NULL_HANDLE) continue;
+        frame.terrainNodeBuffer = createBuffer(maxTerrainNodes * sizeof(TerrainNode), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                               VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryCategory::Uniform);
+    }
+
+    terrain = &newTerrain;
+    terrainSelection.clear();
+
+    return SUCCESS;
+}
+
+// draw selected terrain nodes as instances of patch
+void Renderer::drawTerrain(VkCommandBuffer cmd){
+    if(terrain == nullptr || terrainSelection.size() == 0 || !isMeshReady(terrainPatch)) return;
+
+    FrameData& frame = getCurrentFrame();
+
+    // whole nodes first and then nodes of every quarter, each part is one instanced draw
+    uint32_t firstInstances[5], instanceCounts[5];
+    uint32_t nodeCount = 0;
+    void* data;
+    vmaMapMemory(allocator, frame.terrainNodeBuffer.allocation, &data);
+    TerrainNode* nodes = static_cast<TerrainNode*>(data);
+    auto copyPart = [&](const std::vector<TerrainNode>& part, uint32_t index){
+        // nodes beyond capacity of buffer are dropped
+        uint32_t count = std::min<uint32_t>(static_cast<uint32_t>(part.size()), maxTerrainNodes - nodeCount);
+        if(count > 0) memcpy(nodes + nodeCount, part.data(), count * sizeof(TerrainNode));
+        firstInstances[index] = nodeCount;
+        instanceCounts[index] = count;
+        nodeCount += count;
+    };
+    copyPart(terrainSelection.whole, 0);
+    for(uint32_t q = 0; q < 4; q++){
+        copyPart(terrainSelection.quarters[q], q + 1);
+    }
+    vmaUnmapMemory(allocator, frame.terrainNodeBuffer.allocation);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, terrainPipeline);
+
+    VkDescriptorSet sets[2] = {frame.globalDescriptorSet, terrainDescriptorSet};
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, terrainPipelineLayout, 0, 2, sets, 0, nullptr);
+
+    TerrainParameters parameters = terrain->getParameters();
+    vkCmdPushConstants(cmd, terrainPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(TerrainParameters), &parameters);
+
+    // grid positions from geometry buffer, nodes from buffer of this frame
+    VkBuffer vertexBuffers[2] = {geometryBuffer.getPositionBuffer(terrainPatch.format), frame.terrainNodeBuffer.buffer};
+    VkDeviceSize offsets[2] = {0, 0};
+    vkCmdBindVertexBuffers(cmd, 0, 2, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(cmd, geometryBuffer.getIndexBuffer(), 0, terrainPatch.indexType);
+
+    if(instanceCounts[0] > 0){
+        vkCmdDrawIndexed(cmd, terrainPatch.indexCount, instanceCounts[0], terrainPatch.firstIndex,
+                         terrainPatch.vertexOffset, firstInstances[0]);
+    }
+
+    // quarters are contiguous index ranges of patch
+    uint32_t quarterIndexCount = terrain->getQuarterIndexCount();
+    for(uint32_t q = 0; q < 4; q++){
+        if(instanceCounts[q + 1] == 0) continue;
+        vkCmdDrawIndexed(cmd, quarterIndexCount, instanceCounts[q + 1], terrainPatch.firstIndex + q * quarterIndexCount,
+                         terrainPatch.vertexOffset, firstInstances[q + 1]);
+    }
+}
+
+// create a mesh with per frame host visible vertex buffers
+DynamicMeshHandle Renderer::createDynamicMesh(StringId name, const Mesh& source){
+    if(source.vertices.empty()){
+        std::cerr << "[WARNING] Not creating dynamic mesh without vertices" << std::endl;
+        return {};
+    }
+
+    if(findDynamicMesh(name)){
+        std::cerr << "[WARNING] Dynamic mesh of same name already exists" << std::endl;
+        return {};
+    }
+
+    MeshHandle meshHandle = findMesh(name);
+    if(!meshHandle) meshHandle = createMesh(Mesh{}, name);
+    Mesh* existing = getMesh(meshHandle);
+    if(existing == nullptr) return {};
+    Mesh& mesh = *existing;
+    if(mesh.uploaded) freeMesh(mesh);
+    mesh = Mesh{};
+    mesh.vertices = source.vertices;
+    mesh.indices = source.indices;
+    mesh.hasIndexBuffer = source.hasIndexBuffer && !source.indices.empty();
+    // vertices are edited by index, so their order must stay as given
+    mesh.optimized = true;
+    mesh.format = VertexFormat::Float;
+    mesh.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    mesh.vertexOffset = 0;
+    mesh.computeBounds();
+
+    // indices don't change, they go to geometry buffer like those of any other mesh
+    if(mesh.hasIndexBuffer){
+        std::vector<uint8_t> indices;
+        mesh.encodeIndices(indices);
+        mesh.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        mesh.firstIndex = geometryBuffer.allocateIndices(mesh.indexType, mesh.indexCount);
+        mesh.uploadTicket = uploadManager.upload(indices.data(), indices.size(), geometryBuffer.getIndexBuffer(),
+                                                 mesh.firstIndex * GeometryBuffer::getIndexSize(mesh.indexType));
+    }
+    mesh.uploaded = true;
+
+    DynamicMeshHandle handle = dynamicMeshes.create(DynamicMesh{}, name);
+    if(!handle){
+        std::cerr << "[ERROR] Dynamic mesh pool is full" << std::endl;
+
+        // mesh isn't dynamic yet and has no vertex range, only its indices go back
+        if(mesh.hasIndexBuffer){
+            PendingGeometryFree pending = {};
+            pending.frame = frameNumber;
+            pending.hasIndices = true;
+            pending.indexType = mesh.indexType;
+            pending.firstIndex = mesh.firstIndex;
+            pendingGeometryFrees.push_back(pending);
+        }
+        mesh.uploaded = false;
+        return {};
+    }
+    DynamicMesh& dynamicMesh = *getDynamicMesh(handle);
+    dynamicMesh.mesh = meshHandle;
+    mesh.dynamic = handle;
+    // cpu vertices live with their copies, mesh keeps only indices and bounds
+    dynamicMesh.vertices = std::move(mesh.vertices);
+    mesh.vertices.clear();
+
+    // one persistently mapped copy of both streams per frame in flight,
+    // device reads them straight from host visible memory
+    auto createMappedBuffer = [&](VkDeviceSize size, AllocatedBuffer& buffer){
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = STYPE(BUFFER_CREATE_INFO);
+        bufferInfo.pNext = nullptr;
+        bufferInfo.size = size;
+        bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+        allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+        VmaAllocationInfo allocationInfo;
+        VKCHECK(vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &buffer.buffer, &buffer.allocation, &allocationInfo));
+        memoryBudget.track(MemoryCategory::Mesh, buffer.allocation);
+
+        mainDeletionQueue.push_function([=](){
+            memoryBudget.untrack(MemoryCategory::Mesh, buffer.allocation);
+            vmaDestroyBuffer(allocator, buffer.buffer, buffer.allocation);
+        });
+
+        return allocationInfo.pMappedData;
+    };
+
+    dynamicMesh.frames.resize(bufferingSize);
+    for(DynamicMesh::FrameCopy& copy : dynamicMesh.frames){
+        copy.positions = static_cast<glm::vec3*>(
+            createMappedBuffer(VkDeviceSize(mesh.vertexCount) * sizeof(glm::vec3), copy.positionBuffer));
+        copy.attributes = static_cast<VertexAttributes*>(
+            createMappedBuffer(VkDeviceSize(mesh.vertexCount) * sizeof(VertexAttributes), copy.attributeBuffer));
+    }
+
+    // every copy starts with all vertices
+    dynamicMesh.markAllDirty();
+
+    return handle;
+}
+
+// copy edited vertices to buffers of current frame
+void Renderer::updateDynamicMeshes(){
+    size_t frame = frameNumber % bufferingSize;
+    for(DynamicMesh& dynamicMesh : dynamicMeshes){
+        dynamicMesh.update(allocator, frame);
     }
 }
@@ -2,7 +2,9 @@
 #define RENDERER_HPP
 
 #include <array>
+#include <atomic>
 #include <vector>
+#include <functional>
 #include <unordered_map>
 
 #include "AllocatedImage.hpp"
@@ -19,6 +21,20 @@
 #include "Mesh.hpp"
 #include "Material.hpp"
 #include "RenderObject.hpp"
+#include "TransformStore.hpp"
+#include "Camera.hpp"
+#include "GeometryBuffer.hpp"
+#include "UploadManager.hpp"
+#include "MeshStreamer.hpp"
+#include "MeshFile.hpp"
+#include "GpuSurface.hpp"
+#include "Terrain.hpp"
+#include "DynamicMesh.hpp"
+#include "Primitives.hpp"
+#include "Pool.hpp"
+#include "StringId.hpp"
+#include "FrameSnapshot.hpp"
+#include "MemoryBudget.hpp"
 
 #include <vulkan/vulkan_core.h>
 
@@ -45,16 +61,154 @@ public:
      * To draw meshes to screen, one must create RenderObject and add
      * it to list of objects to be drawn.
      *
+     * Upload is asynchronous, copies of many meshes are batched and
+     * submitted together at latest on next draw(). Objects with meshes
+     * that aren't ready yet are skipped while drawing.
+     *
      * @param mesh to be uploaded to GPU.
+     * @return UploadTicket to check if mesh is ready with isUploadComplete().
+     * */
+    UploadTicket uploadMesh(Mesh& mesh);
+
+    /**
+     * @brief Upload mesh from a mapped binary mesh file.
+     * Data is copied from file directly to staging memory, mesh only
+     * gets metadata and keeps no vertices on cpu. File can be closed
+     * as soon as this returns.
+     *
+     * @param mesh to be described by file and uploaded.
+     * @param file Mapped mesh file.
+     * @return UploadTicket to check if mesh is ready with isUploadComplete().
+     * */
+    UploadTicket uploadMesh(Mesh& mesh, const MappedMeshFile& file);
+
+    /**
+     * @brief Check if upload with given ticket is complete, without blocking.
+     *
+     * @param ticket returned by uploadMesh().
+     * @return true if data is on gpu.
+     * */
+    inline bool isUploadComplete(UploadTicket ticket) { return uploadManager.isComplete(ticket); }
+
+    /**
+     * @brief Block until upload with given ticket is complete.
+     *
+     * @param ticket returned by uploadMesh().
+     * */
+    inline void waitForUpload(UploadTicket ticket) { uploadManager.wait(ticket); }
+
+    /**
+     * @brief Check if mesh is uploaded and its data is on gpu.
+     *
+     * @param mesh to check.
+     * @return true if mesh can be drawn.
+     * */
+    inline bool isMeshReady(const Mesh& mesh) { return mesh.uploaded && uploadManager.isAcquired(mesh.uploadTicket); }
+
+    /**
+     * @brief Load mesh from an obj or binary mesh file in background.
+     * Obj files are converted to a binary cache next to them on first load.
+     * Returns immediately, mesh is loaded on worker threads and uploaded
+     * by draw(). Until then objects using it draw its fallback,
+     * a placeholder by default. Requesting same path again returns same mesh.
+     *
+     * @param path Path of obj file, also name of mesh.
+     * @param format Vertex format to upload mesh with.
+     * @return MeshHandle Mesh that's going to be filled.
+     * */
+    MeshHandle requestMesh(const std::string& path, VertexFormat format = VertexFormat::Float);
+
+    /// maximum number of streamed meshes uploaded per frame
+    uint32_t streamUploadsPerFrame = 4;
+
+    /// free vertices and indices of meshes uploaded with uploadMesh(Mesh&) from cpu memory after upload,
+    /// meshes keep counts, bounds and levels of detail but can't be uploaded again or made dynamic
+    bool releaseCpuGeometry = false;
+
+    /**
+     * @brief Bytes of geometry uploaded meshes may take on gpu, 0 for no limit.
+     * Over budget, streamed meshes that weren't drawn for longest are evicted
+     * and loaded again from their file, or its binary cache, when an object
+     * using them comes into view. Meshes not loaded with requestMesh() stay
+     * resident, they can't be loaded again.
+     * */
+    size_t meshResidencyBudget = 0;
+
+    /// bytes of geometry of uploaded meshes, counted against meshResidencyBudget
+    inline size_t getResidentMeshBytes() const { return residentMeshBytes; }
+
+    /**
+     * @brief Release gpu memory of an uploaded mesh.
+     * Memory is reused only after all frames in flight that
+     * may still draw the mesh are finished. Mesh must not be drawn
+     * after this call, but it can be uploaded again.
+     *
+     * @param mesh to be freed from GPU.
+     * */
+    void freeMesh(Mesh& mesh);
+
+    /**
+     * @brief Copy camera, lights and transforms of all render objects into a snapshot.
+     * Matrices of objects moved since last capture are composed first.
+     * This is the only per frame call that reads renderObjects, so scene can be
+     * simulated on one thread while snapshots are drawn on another. Snapshot
+     * keeps its allocations, capturing into a reused one doesn't allocate.
+     *
+     * @param camera Camera the scene is viewed from.
+     * @param[out] snapshot Snapshot to overwrite, frame and time are left to caller.
+     * */
+    void captureSnapshot(const Camera& camera, FrameSnapshot& snapshot);
+
+    /**
+     * @brief Draw a frame of given snapshot.
+     * Streamed meshes nearest to camera of snapshot are uploaded first, then
+     * objects outside its frustum are culled, levels of detail and terrain nodes
+     * are selected and frame is recorded, submitted and presented.
+     * Everything except renderObjects and transforms belongs to thread calling
+     * this: meshes, materials, gpu surfaces and dynamic meshes must only be
+     * created or edited on it, or before it starts drawing.
+     *
+     * Level of detail of an object is coarsest level of its mesh whose
+     * simplification error, projected to screen, stays within lodPixelError pixels.
+     *
+     * @param snapshot Snapshot captured with captureSnapshot(), not changed while drawing.
+     * */
+    void draw(const FrameSnapshot& snapshot);
+
+    /// maximum allowed screen space error of selected levels of detail, in pixels
+    float lodPixelError = 1.f;
+
+    /// fraction of lodPixelError an object has to drop below before a coarser level is selected,
+    /// this keeps objects from popping between levels near the switching distance
+    float lodHysteresis = 0.25f;
+
+    /**
+     * @brief Upload heightmap of terrain and draw terrain from now on.
+     * Terrain must stay alive while it's drawn. Uploading another
+     * terrain replaces this one, after waiting for device to be idle.
+     *
+     * @param terrain Initialized terrain.
+     * @return SUCCESS on success, FAILED if terrain pipeline is unavailable.
      * */
-    void uploadMesh(Mesh& mesh);
+    ReturnCode uploadTerrain(Terrain& terrain);
+
+    /// get number of terrain nodes selected for last frame
+    inline size_t getTerrainNodeCount() const { return terrainSelection.size(); }
 
     /**
-     * @brief Draws all RenderObject objects present in renderObjects vector.
-     * To draw multiple objects in one frame, push RenderObjects to list of objects
-     * to be drawn (renderObjects) and then call this draw command at once.
+     * @brief Gpu memory use of every heap against its budget, broken down by category.
+     * Updated every frame by draw(), set its warning callback and dump path before drawing starts.
      * */
-    void draw();
+    MemoryBudget memoryBudget;
+
+    /// bytes of mesh geometry draw() moves per frame to compact fragmented geometry buffer, 0 disables it
+    size_t geometryCompactionBytes = 4 << 20;
+    /// part of free geometry space outside of largest free range, above which compaction starts
+    float geometryCompactionThreshold = 0.5f;
+
+    /// draw depth of all objects before shading them, so every pixel is shaded only once
+    /// depth pass fetches only position stream of meshes
+    bool depthPrepass = false;
 
     /**
      * @brief Tell renderer if a resize operation is being done on the given window
@@ -64,8 +218,8 @@ public:
     void windowResized();
 
     /**
-     * @brief Uniform data sent to shaders.
-     * This must be updated regularly whenever needed.
+     * @brief Uniform data sent to shaders, lights and ambient color are set here.
+     * Camera fields are filled by captureSnapshot(), which copies this to snapshot.
      * */
     UniformData uniformData;
 
@@ -79,41 +233,155 @@ public:
     std::vector<RenderObject> renderObjects;
 
     /**
-     * @brief Add given render object to renderObjects vector
+     * @brief Transforms of objects in renderObjects. Matrices of transforms
+     * changed since last frame are composed in one batch before drawing.
+     * */
+    TransformStore transforms;
+
+    /**
+     * @brief Add given render object to renderObjects vector.
+     * Its transform is moved into transforms, so later changes to the added
+     * object are picked up by next batch update.
+     *
+     * @return size_t Index of added object in renderObjects.
      * */
-    inline void addRenderObject(const RenderObject& obj) { renderObjects.push_back(obj); }
+    inline size_t addRenderObject(const RenderObject& obj) {
+        renderObjects.push_back(obj);
+        renderObjects.back().bindTransform(&transforms);
+        return renderObjects.size() - 1;
+    }
 
     /**
-     * @brief Clear renderObjects vector.
+     * @brief Clear renderObjects vector and their transforms.
      * */
-    inline void clearRenderObjects() { renderObjects.clear(); }
+    inline void clearRenderObjects() { renderObjects.clear(); transforms.clear(); }
 
     /**
-     * @brief Register materials by name in renderer. Since this keeps a copy
-     * of material and creating a RenderObject requires pointer to material,
-     * you can get pointer to copied material using getMaterial() function
-     * and easily create a RenderObject.
+     * @brief Materials of renderer. Render objects refer to them by handle,
+     * handles of destroyed materials are detected instead of dangling.
+     * Iterating the pool walks all materials in contiguous memory.
      * */
-    std::unordered_map<std::string, Material> materials;
+    Pool<Material> materials;
 
-     /**
-     * @brief Register meshes by name in renderer. Since this keeps a copy
-     * of material and creating a RenderObject requires pointer to mesh,
-     * you can get pointer to copied mesh using getMesh() function
-     * and easily create a RenderObject.
+    /**
+     * @brief Meshes of renderer, including streamed meshes, primitives and
+     * meshes of gpu surfaces and dynamic meshes. Render objects refer to them
+     * by handle. Pointers returned by getMesh() are valid only until next mesh
+     * is created or destroyed, keep handles instead.
      * */
-    std::unordered_map<std::string, Mesh> meshes;
+    Pool<Mesh> meshes;
 
-    /// create material and add it to the map
-    Material* createMaterial(VkPipeline pipeline, VkPipelineLayout layout, const std::string& name);
+    /// create material and add it to the pool
+    /// given pipeline is used for meshes of every vertex format
+    MaterialHandle createMaterial(VkPipeline pipeline, VkPipelineLayout layout, StringId name = {});
+
+    /// create material with one pipeline variant per vertex format and add it to the pool
+    MaterialHandle createMaterial(const std::array<VkPipeline, VertexFormatCount>& pipelines,
+                                  VkPipelineLayout layout, StringId name = {});
 
     /// Find material by name.
-    /// Returns nullptr if material cannot be found.
-    Material* getMaterial(const std::string& name);
+    /// Returns null handle if material cannot be found.
+    inline MaterialHandle findMaterial(StringId name) const { return materials.find(name); }
+
+    /// Get material of handle.
+    /// Returns nullptr if material was destroyed.
+    inline Material* getMaterial(MaterialHandle material) { return materials.get(material); }
+
+    /**
+     * @brief Add mesh to the pool, it still has to be uploaded to be drawn.
+     *
+     * @param mesh Mesh to move into renderer.
+     * @param name Name to find mesh by, empty for none.
+     * @return MeshHandle Handle of mesh.
+     * */
+    MeshHandle createMesh(Mesh&& mesh, StringId name = {});
 
     // Find mesh by name.
-    // Returns nullptr if it can't be found.
-    Mesh* getMesh(const std::string& name);
+    // Returns null handle if it can't be found.
+    inline MeshHandle findMesh(StringId name) const { return meshes.find(name); }
+
+    // Get mesh of handle.
+    // Returns nullptr if mesh was destroyed.
+    inline Mesh* getMesh(MeshHandle mesh) { return meshes.get(mesh); }
+
+    /**
+     * @brief Free gpu memory of mesh and remove it from the pool.
+     * Objects still using it are skipped while drawing.
+     *
+     * @param mesh Handle of mesh, ignored if it's already destroyed.
+     * */
+    void destroyMesh(MeshHandle mesh);
+
+    /**
+     * @brief Get mesh of a primitive shape, shared by every object drawing it.
+     * Each type and tessellation is generated and uploaded only once, on first
+     * request, and registered in meshes under getPrimitiveName(type, tessellation).
+     * Primitives have white vertices, color objects with RenderObject::setColor().
+     *
+     * @param type Shape of primitive.
+     * @param tessellation Level of detail, meaning depends on type.
+     * @return MeshHandle Shared mesh of primitive.
+     * */
+    MeshHandle getPrimitive(PrimitiveType type, uint32_t tessellation);
+
+    /**
+     * @brief Surfaces generated on gpu. Their meshes are registered
+     * in meshes under same name and can be drawn like any other mesh.
+     * */
+    Pool<GpuSurface> gpuSurfaces;
+
+    /**
+     * @brief Create a grid surface whose vertices are generated on gpu.
+     * Kernel is a compute shader built on shaders/surface_common.glsl.
+     * Vertices are generated in geometry buffer before drawing, on
+     * first draw and every time surface is marked dirty.
+     *
+     * @param name Name of surface and its mesh.
+     * @param kernelPath Path of compiled compute shader.
+     * @param resolutionX Number of grid points along u.
+     * @param resolutionY Number of grid points along v.
+     * @param rangeMin Parameters of first grid point.
+     * @param rangeMax Parameters of last grid point.
+     * @return GpuSurfaceHandle Created surface, null if kernel can't be loaded.
+     * */
+    GpuSurfaceHandle createGpuSurface(StringId name, const char* kernelPath,
+                                      uint32_t resolutionX, uint32_t resolutionY,
+                                      const glm::vec2& rangeMin, const glm::vec2& rangeMax);
+
+    // Find gpu surface by name.
+    // Returns null handle if it can't be found.
+    inline GpuSurfaceHandle findGpuSurface(StringId name) const { return gpuSurfaces.find(name); }
+
+    // Get gpu surface of handle.
+    // Returns nullptr if it doesn't exist.
+    inline GpuSurface* getGpuSurface(GpuSurfaceHandle surface) { return gpuSurfaces.get(surface); }
+
+    /**
+     * @brief Meshes whose vertices change while they're drawn.
+     * Their meshes are registered in meshes under same name.
+     * */
+    Pool<DynamicMesh> dynamicMeshes;
+
+    /**
+     * @brief Create a mesh whose vertices can be edited every frame.
+     * Indices are uploaded once, vertices get one host visible buffer per frame
+     * in flight. Edit vertices of dynamic mesh and mark edited ranges dirty, only
+     * those are copied before next frames are drawn. Vertex order is kept as given,
+     * mesh isn't optimized, and number of vertices can't change.
+     *
+     * @param name Name of dynamic mesh and its mesh.
+     * @param source Mesh to copy vertices and indices from.
+     * @return DynamicMeshHandle Created dynamic mesh, null if source has no vertices.
+     * */
+    DynamicMeshHandle createDynamicMesh(StringId name, const Mesh& source);
+
+    // Find dynamic mesh by name.
+    // Returns null handle if it can't be found.
+    inline DynamicMeshHandle findDynamicMesh(StringId name) const { return dynamicMeshes.find(name); }
+
+    // Get dynamic mesh of handle.
+    // Returns nullptr if it doesn't exist.
+    inline DynamicMesh* getDynamicMesh(DynamicMeshHandle dynamicMesh) { return dynamicMeshes.get(dynamicMesh); }
 private:
     // sdl window to render images to
     SDL_Window *window;
@@ -143,6 +411,8 @@ private:
     QueueFamilyData queueFamilyData;
     // device properties
     VkPhysicalDeviceProperties physicalDeviceProperties;
+    // VK_KHR_get_physical_device_properties2 is enabled on instance
+    bool physicalDeviceProperties2Enabled = false;
     // select physical device
     void selectPhysicalDevice();
 
@@ -158,6 +428,8 @@ private:
     VkQueue presentQueue = VK_NULL_HANDLE;
     // transfer operations queue
     VkQueue transferQueue = VK_NULL_HANDLE;
+    // VK_EXT_memory_budget is enabled on device
+    bool memoryBudgetEnabled = false;
     // create logical device from selected physical device
     void createLogicalDevice();
 
@@ -204,17 +476,68 @@ private:
     // get current frame
     FrameData& getCurrentFrame() { return frames[frameNumber % bufferingSize]; }
 
-    // command buffer and pool for transfer operations
-    VkCommandPool transferCommandPool;
-    VkCommandBuffer transferCommandBuffer;
+    // allocate geometry of mesh and upload its encoded streams, counts and format of mesh must be set
+    UploadTicket uploadMeshData(Mesh& mesh, const void* positions, const void* attributes, const void* indices);
+
+    // loads meshes requested with requestMesh() in background
+    MeshStreamer meshStreamer;
+    // drawn in place of streamed meshes that aren't loaded yet
+    MeshHandle placeholderMesh;
+    // start streaming workers and upload placeholder
+    void initStreaming();
+
+    // paths of meshes loaded with requestMesh(), only these can be evicted
+    std::unordered_map<MeshHandle, std::string> streamedMeshPaths;
+    // bytes of geometry of uploaded meshes
+    size_t residentMeshBytes = 0;
+    // set while meshes in view alone exceed budget, so it's reported only once
+    bool residencyExceeded = false;
+    // evict least recently drawn streamed meshes until resident geometry fits budget
+    void evictMeshes(FrameArena& arena);
+    // bytes mesh takes in geometry buffer
+    static size_t getMeshGeometrySize(const Mesh& mesh);
 
     // initialize command buffers and stuffs
     void createCommandPool();
     void allocateCommandBuffers();
     void initCommands();
 
-    // copy buffer from cpu memory to gpu memory
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+    // command pool, buffer and fence for one off work on graphics queue
+    VkCommandPool immediateCommandPool;
+    VkCommandBuffer immediateCommandBuffer;
+    VkFence immediateFence;
+    // record commands with given function, submit them to graphics queue and wait
+    void immediateSubmit(const std::function<void(VkCommandBuffer cmd)>& function);
+
+    // batches uploads to gpu through a staging ring
+    UploadManager uploadManager;
+    // initialize upload manager on transfer queue
+    void initUploadManager();
+
+    // vertex and index buffers all meshes are suballocated from
+    GeometryBuffer geometryBuffer;
+    // initialize geometry buffer
+    void initGeometryBuffer();
+
+    // geometry of a freed or moved mesh waiting for frames in flight to finish
+    struct PendingGeometryFree {
+        // frame number at time of free
+        size_t frame;
+        bool hasVertices;
+        VertexFormat format;
+        uint32_t vertexOffset;
+        bool hasIndices;
+        VkIndexType indexType;
+        uint32_t firstIndex;
+    };
+    std::vector<PendingGeometryFree> pendingGeometryFrees;
+    // give back geometry of freed meshes no frame in flight can use anymore
+    void releasePendingGeometry();
+    // copy meshes at end of fragmented geometry buffer into free ranges before them, so free
+    // space merges again, their old ranges are released like geometry of freed meshes
+    void recordGeometryCompaction(VkCommandBuffer cmd, FrameArena& arena);
+    // meshes tried per frame by compaction, bounds its cpu time when nothing fits
+    static constexpr uint32_t geometryCompactionAttempts = 64;
 
     // renderpass
     VkRenderPass renderPass;
@@ -234,8 +557,6 @@ private:
 
     // load meshes
     void loadMeshes();
-    // upload data to gpu using staging buffer
-    AllocatedBuffer uploadDataToGPU(void* data, size_t size, VkBufferUsageFlags flags);
     // descriptor set layout
     VkDescriptorSetLayout globalDescriptorSetLayout;
     // descriptor pool to allocate sets from
@@ -243,19 +564,71 @@ private:
     // initialize descriptor sets
     void initDescriptors();
 
-    // shader modules
-    VkShaderModule meshVS, meshFS;
+    // fragment shader module, shared by all vertex formats
+    VkShaderModule meshFS;
     // pipeline layout
     VkPipelineLayout meshPipelineLayout;
-    // pipeline
-    VkPipeline meshPipeline;
+    // pipeline variant for every vertex format
+    // null if shader of a format failed to load
+    std::array<VkPipeline, VertexFormatCount> meshPipelines = {};
+    // depth only pipeline variant for every vertex format
+    std::array<VkPipeline, VertexFormatCount> depthPipelines = {};
+    // vertex input descriptions of every vertex format
+    std::array<VertexInputDescription, VertexFormatCount> vertexDescriptions;
+    // position only vertex input descriptions of every vertex format
+    std::array<VertexInputDescription, VertexFormatCount> positionDescriptions;
     // pipeline builder
     PipelineBuilder pipelineBuilder;
     // initialize graphics pipeline
     void initGraphicsPipeline();
+    // build pipeline with current builder state and given shaders and vertex input
+    // fragment shader can be null for depth only pipelines
+    VkPipeline buildMeshPipeline(const char* vertexShaderPath, VkShaderModule fragmentShader,
+                                 const VertexInputDescription& vertexDescription);
+
+    // layout of vertex streams written by surface kernels
+    VkDescriptorSetLayout surfaceDescriptorSetLayout;
+    // layout shared by all surface kernels
+    VkPipelineLayout surfacePipelineLayout;
+    // compute pipeline of every loaded surface kernel, by path
+    std::unordered_map<std::string, VkPipeline> surfacePipelines;
+    // create layouts and descriptor sets of surface kernels
+    void initSurfaceGeneration();
+    // get pipeline of a surface kernel, loading it if needed
+    // returns null if kernel can't be loaded
+    VkPipeline getSurfacePipeline(const char* kernelPath);
+    // dispatch kernels of dirty gpu surfaces, outside of render pass
+    void recordSurfaceUpdates(VkCommandBuffer cmd);
+
+    // terrain drawn every frame, null until one is uploaded
+    const Terrain* terrain = nullptr;
+    // grid patch every terrain node is drawn with
+    Mesh terrainPatch;
+    // heightmap read by terrain vertex shader
+    AllocatedBuffer terrainHeightBuffer = {};
+    // nodes selected for next frame, copied to node buffer of frame when it's drawn
+    TerrainSelection terrainSelection;
+    // maximum number of terrain nodes drawn in a frame, size of node buffer of every frame
+    static constexpr uint32_t maxTerrainNodes = 4096;
+    // heightmap layout, set 1 of terrain pipeline
+    VkDescriptorSetLayout terrainDescriptorSetLayout;
+    VkDescriptorSet terrainDescriptorSet;
+    VkPipelineLayout terrainPipelineLayout;
+    // null if terrain shader failed to load
+    VkPipeline terrainPipeline = VK_NULL_HANDLE;
+    // patch positions and per instance nodes
+    VertexInputDescription terrainVertexDescription;
+    // copy dirty vertices of dynamic meshes to buffers of current frame, frame must be idle
+    void updateDynamicMeshes();
+
+    // create layouts and pipeline of terrain, fragment shader is shared with meshes
+    void initTerrainPipeline(VkShaderModule fragmentShader);
+    // record instanced draws of selected terrain nodes, inside render pass
+    void drawTerrain(VkCommandBuffer cmd);
 
     // flag to keep track of window resizes, to be flagged by user
-    bool framebufferResized = false;
+    // set by thread handling window events, read by thread drawing
+    std::atomic<bool> framebufferResized{false};
     // recreate swapchain when swapchain becomes incompatibl
     // with window used by renderer
     void recreateSwapchain();
@@ -264,10 +637,28 @@ private:
     void cleanupSwapchain();
 
     // create buffer of given size and usage
-    AllocatedBuffer createBuffer(size_t allocSize, VkBufferUsageFlags usageFlags, VmaMemoryUsage memoryUsage);
+    AllocatedBuffer createBuffer(size_t allocSize, VkBufferUsageFlags usageFlags, VmaMemoryUsage memoryUsage, MemoryCategory category);
+
+    // an object of a snapshot that passed culling, with mesh it's drawn with
+    struct DrawItem {
+        const ObjectSnapshot* object;
+        // mesh of object or its fallback, ready to draw
+        const Mesh* mesh;
+        uint32_t lod;
+    };
+    // level of detail selected for every render object in last frame, by index
+    std::vector<uint32_t> objectLods;
+    // initial size of arena of every frame in flight, arenas grow to largest frame
+    static constexpr size_t frameArenaSize = 1 << 20;
+
+    // reprioritize streamed meshes by distance to camera of snapshot and upload ones that are loaded
+    void updateStreaming(const FrameSnapshot& snapshot, FrameArena& arena);
+    // cull objects of snapshot and select their levels of detail into drawItems
+    void selectDrawItems(const FrameSnapshot& snapshot, ArenaVector<DrawItem>& drawItems);
 
     // record draw commands for drawing multiple objects
-    void drawObjects(VkCommandBuffer cmd, RenderObject* first, size_t count);
+    // depth only draws use depth pipelines and bind only position streams
+    void drawObjects(VkCommandBuffer cmd, const DrawItem* first, size_t count, bool depthOnly = false);
 };
 
 #endif//RENDERER_HPP
@@ -0,0 +1,375 @@
+#include "Simplifier.hpp"
+#include "Mesh.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// a level of detail must have at least this many triangles
+constexpr size_t minLodTriangles = 16;
+
+// weight of planes keeping border edges in place, relative to surface planes
+constexpr double borderWeight = 10.0;
+
+// Symmetric 4x4 matrix giving squared distance of a point from all the
+// planes accumulated in it. Each plane is weighted by area of triangle it
+// came from, so error is a weighted mean of squared distances.
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+    double a11 = 0, a12 = 0, a13 = 0;
+    double a22 = 0, a23 = 0;
+    double a33 = 0;
+    double weight = 0;
+
+    // add plane dot(n, p) + d = 0 with given weight
+    void addPlane(const glm::vec3& n, double d, double w){
+        double a = n.x, b = n.y, c = n.z;
+        a00 += w*a*a; a01 += w*a*b; a02 += w*a*c; a03 += w*a*d;
+        a11 += w*b*b; a12 += w*b*c; a13 += w*b*d;
+        a22 += w*c*c; a23 += w*c*d;
+        a33 += w*d*d;
+        weight += w;
+    }
+
+    void add(const Quadric& q){
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+        a11 += q.a11; a12 += q.a12; a13 += q.a13;
+        a22 += q.a22; a23 += q.a23;
+        a33 += q.a33;
+        weight += q.weight;
+    }
+
+    // weighted mean squared distance of point from all planes
+    double evaluate(const glm::vec3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        double e = a00*x*x + 2*a01*x*y + 2*a02*x*z + 2*a03*x
+                 + a11*y*y + 2*a12*y*z + 2*a13*y
+                 + a22*z*z + 2*a23*z
+                 + a33;
+        return weight > 0 ? std::fabs(e) / weight : 0;
+    }
+};
+
+// decides how a vertex may be collapsed
+enum VertexKind : uint8_t {
+    Manifold, // interior vertex, can collapse onto any neighbour
+    Border,   // on open boundary, can collapse only along boundary
+    Locked    // on attribute seam or non manifold, never collapsed
+};
+
+// collapse vertex "from" onto vertex "to"
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double cost;
+};
+
+inline uint64_t edgeKey(uint32_t a, uint32_t b){
+    return (uint64_t(a) << 32) | b;
+}
+
+// hash exact bit patterns of vertex positions
+struct PositionHash {
+    size_t operator()(const glm::vec3& p) const {
+        uint32_t h[3];
+        memcpy(h, &p, sizeof(h));
+        return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+    }
+};
+
+struct PositionEqual {
+    bool operator()(const glm::vec3& a, const glm::vec3& b) const {
+        return memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+    }
+};
+
+// check whether collapsing "from" onto "to" turns any remaining triangle around
+inline bool collapseFlipsTriangle(uint32_t from, uint32_t to, const std::vector<uint32_t>& indices,
+                                  const uint32_t* adjacentTriangles, uint32_t adjacentCount,
+                                  const std::vector<Vertex>& vertices){
+    for(uint32_t a = 0; a < adjacentCount; a++){
+        const uint32_t* tri = &indices[3 * adjacentTriangles[a]];
+
+        // triangles on collapsed edge disappear
+        if(tri[0] == to || tri[1] == to || tri[2] == to) continue;
+
+        glm::vec3 p[3], q[3];
+        for(int k = 0; k < 3; k++){
+            p[k] = vertices[tri[k]].position;
+            q[k] = vertices[tri[k] == from ? to : tri[k]].position;
+        }
+
+        glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+        glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+
+        // reject collapses that flip or squash a triangle
+        float d = glm::dot(before, after);
+        if(d <= 0.25f * glm::length(before) * glm::length(after)) return true;
+    }
+
+    return false;
+}
+
+} // namespace
+
+float simplifyMesh(std::vector<uint32_t>& dst, const uint32_t* indices, size_t indexCount,
+                   const std::vector<Vertex>& vertices, size_t targetIndexCount, float targetError){
+    const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+
+    // start with a copy of input triangles without degenerate ones
+    dst.clear();
+    dst.reserve(indexCount);
+    for(size_t i = 0; i + 2 < indexCount; i += 3){
+        uint32_t a = indices[i], b = indices[i+1], c = indices[i+2];
+        if(a == b || b == c || a == c) continue;
+        dst.push_back(a);
+        dst.push_back(b);
+        dst.push_back(c);
+    }
+
+    std::vector<uint8_t> used(vertexCount, 0);
+    for(uint32_t idx : dst) used[idx] = 1;
+
+    // map every vertex to first vertex with same position
+    // vertices sharing position but differing in other attributes form seams
+    std::vector<uint32_t> canonical(vertexCount);
+    std::vector<uint8_t> kind(vertexCount, Manifold);
+    std::unordered_map<glm::vec3, uint32_t, PositionHash, PositionEqual> positionMap;
+    positionMap.reserve(vertexCount);
+    for(uint32_t v = 0; v < vertexCount; v++){
+        canonical[v] = v;
+        if(!used[v]) continue;
+
+        auto res = positionMap.emplace(vertices[v].position, v);
+        canonical[v] = res.first->second;
+        if(!res.second){
+            kind[v] = Locked;
+            kind[canonical[v]] = Locked;
+        }
+    }
+
+    // an edge without its opposite edge lies on open border of mesh
+    std::unordered_set<uint64_t> directedEdges;
+    directedEdges.reserve(dst.size());
+    for(size_t i = 0; i < dst.size(); i += 3){
+        for(int k = 0; k < 3; k++){
+            directedEdges.insert(edgeKey(canonical[dst[i+k]], canonical[dst[i+(k+1)%3]]));
+        }
+    }
+
+    std::unordered_set<uint64_t> borderEdges;
+    std::vector<uint8_t> outgoingBorderEdges(vertexCount, 0);
+    for(size_t i = 0; i < dst.size(); i += 3){
+        for(int k = 0; k < 3; k++){
+            uint32_t a = canonical[dst[i+k]], b = canonical[dst[i+(k+1)%3]];
+            if(directedEdges.count(edgeKey(b, a)) == 0){
+                borderEdges.insert(edgeKey(std::min(a, b), std::max(a, b)));
+                if(outgoingBorderEdges[a] < 255) outgoingBorderEdges[a]++;
+            }
+        }
+    }
+
+    // a vertex with more than one border passing through it is non manifold
+    for(uint32_t v = 0; v < vertexCount; v++){
+        if(!used[v] || kind[v] == Locked) continue;
+        if(outgoingBorderEdges[v] == 1) kind[v] = Border;
+        else if(outgoingBorderEdges[v] > 1) kind[v] = Locked;
+    }
+
+    auto canCollapse = [&](uint32_t from, uint32_t to){
+        switch(kind[from]){
+            case Manifold: return true;
+            case Border: {
+                uint32_t a = canonical[from], b = canonical[to];
+                return borderEdges.count(edgeKey(std::min(a, b), std::max(a, b))) != 0;
+            }
+            default: return false;
+        }
+    };
+
+    // accumulate planes of all triangles around each vertex
+    std::vector<Quadric> quadrics(vertexCount);
+    for(size_t i = 0; i < dst.size(); i += 3){
+        const glm::vec3& p0 = vertices[dst[i+0]].position;
+        const glm::vec3& p1 = vertices[dst[i+1]].position;
+        const glm::vec3& p2 = vertices[dst[i+2]].position;
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float doubleArea = glm::length(normal);
+        if(doubleArea == 0.f) continue;
+        normal /= doubleArea;
+
+        for(int k = 0; k < 3; k++){
+            quadrics[dst[i+k]].addPlane(normal, -glm::dot(normal, p0), 0.5 * doubleArea);
+        }
+
+        // border edges get a plane perpendicular to triangle so they don't move inwards
+        for(int k = 0; k < 3; k++){
+            uint32_t a = dst[i+k], b = dst[i+(k+1)%3];
+            uint32_t ca = canonical[a], cb = canonical[b];
+            if(borderEdges.count(edgeKey(std::min(ca, cb), std::max(ca, cb))) == 0) continue;
+
+            glm::vec3 edge = vertices[b].position - vertices[a].position;
+            float edgeLength = glm::length(edge);
+            if(edgeLength == 0.f) continue;
+
+            glm::vec3 borderNormal = glm::normalize(glm::cross(edge, normal));
+            double d = -glm::dot(borderNormal, vertices[a].position);
+            quadrics[a].addPlane(borderNormal, d, borderWeight * edgeLength * edgeLength);
+            quadrics[b].addPlane(borderNormal, d, borderWeight * edgeLength * edgeLength);
+        }
+    }
+
+    const double costLimit = double(targetError) * double(targetError);
+    double maxCost = 0;
+
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacencyFill;
+    std::vector<uint32_t> adjacency;
+    std::vector<uint64_t> edges;
+    std::vector<Collapse> collapses;
+    std::vector<uint8_t> lockedInPass(vertexCount);
+
+    // every pass collapses a set of independent edges, cheapest first
+    while(dst.size() > targetIndexCount){
+        // triangles around every vertex
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for(uint32_t idx : dst) adjacencyOffsets[idx + 1]++;
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+        adjacencyFill.assign(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        adjacency.resize(dst.size());
+        for(size_t i = 0; i < dst.size(); i++){
+            adjacency[adjacencyFill[dst[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        // unique edges
+        edges.clear();
+        for(size_t i = 0; i < dst.size(); i += 3){
+            for(int k = 0; k < 3; k++){
+                uint32_t a = dst[i+k], b = dst[i+(k+1)%3];
+                edges.push_back(edgeKey(std::min(a, b), std::max(a, b)));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        // pick cheapest direction of every edge
+        collapses.clear();
+        for(uint64_t edge : edges){
+            uint32_t u = static_cast<uint32_t>(edge >> 32), v = static_cast<uint32_t>(edge);
+
+            Collapse best = {0, 0, DBL_MAX};
+            if(canCollapse(u, v)){
+                Quadric q = quadrics[u];
+                q.add(quadrics[v]);
+                double cost = q.evaluate(vertices[v].position);
+                if(cost < best.cost) best = {u, v, cost};
+            }
+            if(canCollapse(v, u)){
+                Quadric q = quadrics[v];
+                q.add(quadrics[u]);
+                double cost = q.evaluate(vertices[u].position);
+                if(cost < best.cost) best = {v, u, cost};
+            }
+
+            if(best.cost < DBL_MAX) collapses.push_back(best);
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b){
+            return a.cost < b.cost;
+        });
+
+        // an interior collapse removes two triangles
+        size_t collapseGoal = std::max<size_t>(1, (dst.size() - targetIndexCount) / 6);
+        size_t collapseCount = 0;
+
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(lockedInPass.begin(), lockedInPass.end(), 0);
+
+        for(const Collapse& c : collapses){
+            if(c.cost > costLimit || collapseCount >= collapseGoal) break;
+            if(lockedInPass[c.from] || lockedInPass[c.to]) continue;
+
+            const uint32_t* adjacent = &adjacency[adjacencyOffsets[c.from]];
+            uint32_t adjacentCount = adjacencyOffsets[c.from + 1] - adjacencyOffsets[c.from];
+            if(collapseFlipsTriangle(c.from, c.to, dst, adjacent, adjacentCount, vertices)) continue;
+
+            remap[c.from] = c.to;
+            quadrics[c.to].add(quadrics[c.from]);
+
+            // adjacency around removed vertex is stale until next pass
+            for(uint32_t a = 0; a < adjacentCount; a++){
+                const uint32_t* tri = &dst[3 * adjacent[a]];
+                lockedInPass[tri[0]] = lockedInPass[tri[1]] = lockedInPass[tri[2]] = 1;
+            }
+
+            maxCost = std::max(maxCost, c.cost);
+            collapseCount++;
+        }
+
+        // nothing more can be collapsed within error limit
+        if(collapseCount == 0) break;
+
+        // apply collapses and drop triangles that became degenerate
+        size_t write = 0;
+        for(size_t i = 0; i < dst.size(); i += 3){
+            uint32_t a = remap[dst[i]], b = remap[dst[i+1]], c = remap[dst[i+2]];
+            if(a == b || b == c || a == c) continue;
+            dst[write++] = a;
+            dst[write++] = b;
+            dst[write++] = c;
+        }
+        dst.resize(write);
+    }
+
+    return static_cast<float>(std::sqrt(maxCost));
+}
+
+void generateMeshLods(Mesh& mesh, uint32_t maxLods){
+    mesh.computeBounds();
+
+    // levels are already generated
+    if(mesh.lods.size() > 1) return;
+
+    mesh.lods.clear();
+    if(!mesh.hasIndexBuffer || mesh.indices.empty()) return;
+
+    const uint32_t baseCount = static_cast<uint32_t>(mesh.indices.size());
+    mesh.lods.push_back(MeshLod{0, baseCount, 0.f});
+
+    std::vector<uint32_t> lodIndices;
+    for(uint32_t level = 1; level < maxLods; level++){
+        // half the triangles of previous level
+        size_t targetCount = (static_cast<size_t>(baseCount) >> level) / 3 * 3;
+        if(targetCount < 3 * minLodTriangles) break;
+
+        // always simplify from full detail so error is relative to it
+        float error = simplifyMesh(lodIndices, mesh.indices.data(), baseCount, mesh.vertices, targetCount, FLT_MAX);
+
+        // stop when simplification can't make enough progress
+        const MeshLod previous = mesh.lods.back();
+        if(lodIndices.empty() || lodIndices.size() > previous.indexCount * 0.9f) break;
+
+        MeshLod lod;
+        lod.firstIndex = static_cast<uint32_t>(mesh.indices.size());
+        lod.indexCount = static_cast<uint32_t>(lodIndices.size());
+        // coarser level must never claim to be more accurate
+        lod.error = std::max(error, previous.error);
+
+        mesh.indices.insert(mesh.indices.end(), lodIndices.begin(), lodIndices.end());
+        mesh.lods.push_back(lod);
+    }
+}
+
+void generateMeshLods(const std::vector<Mesh*>& meshes, uint32_t maxLods){
+    parallelFor(meshes.size(), [&](size_t i){
+        generateMeshLods(*meshes[i], maxLods);
+    });
+}
@@ -0,0 +1,48 @@
+#ifndef SIMPLIFIER_HPP
+#define SIMPLIFIER_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "Vertex.hpp"
+
+struct Mesh;
+
+/**
+ * @brief Simplify a triangle list using quadric error metric edge collapses.
+ * A collapsed vertex is always moved onto one of its neighbours, so the
+ * simplified indices still refer to the given vertex array and no new
+ * vertices are created. Border vertices only slide along the border and
+ * vertices on attribute seams are never removed.
+ *
+ * @param[out] dst Simplified triangle list.
+ * @param[in] indices Triangle list to simplify.
+ * @param[in] indexCount Number of indices in triangle list.
+ * @param[in] vertices Vertex array referenced by indices.
+ * @param[in] targetIndexCount Simplification stops at or below this many indices.
+ * @param[in] targetError Maximum allowed error in object space units.
+ * @return float Error of simplified triangle list in object space units.
+ * */
+float simplifyMesh(std::vector<uint32_t>& dst, const uint32_t* indices, size_t indexCount,
+                   const std::vector<Vertex>& vertices, size_t targetIndexCount, float targetError);
+
+/**
+ * @brief Generate level of detail chain for given mesh.
+ * Every level has about half the triangles of previous one. Levels are
+ * appended to mesh indices and described in mesh lods. Meshes without
+ * index buffer get a single level.
+ *
+ * @param mesh Mesh to generate levels for.
+ * @param maxLods Maximum number of levels including full detail one.
+ * */
+void generateMeshLods(Mesh& mesh, uint32_t maxLods = 6);
+
+/**
+ * @brief Generate level of detail chains for multiple meshes in parallel.
+ *
+ * @param meshes Meshes to generate levels for.
+ * @param maxLods Maximum number of levels per mesh including full detail one.
+ * */
+void generateMeshLods(const std::vector<Mesh*>& meshes, uint32_t maxLods = 6);
+
+#endif//SIMPLIFIER_HPP
@@ -0,0 +1,56 @@
+#ifndef STRING_ID_HPP
+#define STRING_ID_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <functional>
+
+/**
+ * @brief Name interned to a 64 bit FNV-1a hash.
+ * Hash of string literals is computed at compile time, so looking up
+ * resources by a constant name costs an integer comparison instead of
+ * hashing the string every time. Default constructed id and id of
+ * an empty string are empty.
+ * */
+struct StringId {
+    uint64_t value = 0;
+
+    constexpr StringId() = default;
+    constexpr explicit StringId(uint64_t hash) : value(hash) {}
+    constexpr StringId(const char* name) : value(hash(name, length(name))) {}
+    StringId(const std::string& name) : value(hash(name.data(), name.size())) {}
+
+    static constexpr uint64_t hash(const char* name, size_t size) {
+        // empty name is same as no name
+        if(size == 0) return 0;
+        uint64_t result = 0xcbf29ce484222325ull;
+        for(size_t i = 0; i < size; i++){
+            result ^= static_cast<uint8_t>(name[i]);
+            result *= 0x100000001b3ull;
+        }
+        return result;
+    }
+
+    constexpr bool isEmpty() const { return value == 0; }
+
+    constexpr bool operator==(const StringId& other) const { return value == other.value; }
+    constexpr bool operator!=(const StringId& other) const { return value != other.value; }
+
+private:
+    static constexpr size_t length(const char* name) {
+        size_t size = 0;
+        while(name[size] != '\0') size++;
+        return size;
+    }
+};
+
+namespace std {
+    template<>
+    struct hash<StringId> {
+        // already a hash, no need to mix it again
+        size_t operator()(const StringId& id) const { return static_cast<size_t>(id.value); }
+    };
+}
+
+#endif//STRING_ID_HPP
@@ -0,0 +1,263 @@
+#include "Terrain.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+// check if sphere around given center touches an axis aligned box
+bool sphereIntersectsBox(const glm::vec3& center, float radius, const glm::vec3& min, const glm::vec3& max){
+    glm::vec3 nearest = glm::clamp(center, min, max);
+    glm::vec3 d = nearest - center;
+    return glm::dot(d, d) <= radius * radius;
+}
+
+} // namespace
+
+VertexInputDescription TerrainNode::getVertexDescription(){
+    VertexInputDescription description;
+
+    // patch grid positions, per-vertex rate
+    VkVertexInputBindingDescription patchBinding = {};
+    patchBinding.binding = 0;
+    patchBinding.stride = sizeof(glm::vec3);
+    patchBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    // selected nodes, per-instance rate
+    VkVertexInputBindingDescription nodeBinding = {};
+    nodeBinding.binding = 1;
+    nodeBinding.stride = sizeof(TerrainNode);
+    nodeBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    description.bindings.push_back(patchBinding);
+    description.bindings.push_back(nodeBinding);
+
+    // grid position will be stored at Location 0
+    VkVertexInputAttributeDescription positionAttribute = {};
+    positionAttribute.binding = 0;
+    positionAttribute.location = 0;
+    positionAttribute.format = VK_FORMAT_R32G32B32_SFLOAT;
+    positionAttribute.offset = 0;
+
+    // node origin, size and level will be stored at Location 1
+    VkVertexInputAttributeDescription nodeAttribute = {};
+    nodeAttribute.binding = 1;
+    nodeAttribute.location = 1;
+    nodeAttribute.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    nodeAttribute.offset = 0;
+
+    description.attributes.push_back(positionAttribute);
+    description.attributes.push_back(nodeAttribute);
+
+    return description;
+}
+
+void TerrainSelection::clear(){
+    whole.clear();
+    for(std::vector<TerrainNode>& quarter : quarters){
+        quarter.clear();
+    }
+}
+
+size_t TerrainSelection::size() const{
+    size_t count = whole.size();
+    for(const std::vector<TerrainNode>& quarter : quarters){
+        count += quarter.size();
+    }
+    return count;
+}
+
+ReturnCode Terrain::init(const TerrainSettings& s, std::vector<float> h, uint32_t res){
+    if(res < 2 || h.size() != size_t(res) * res){
+        std::cerr << "[ERROR] Terrain heightmap must have resolution x resolution samples, resolution at least 2" << std::endl;
+        return FAILED;
+    }
+    if(s.size <= 0.f || s.lodCount == 0 || s.lodCount > 16){
+        std::cerr << "[ERROR] Terrain needs a positive size and 1 to 16 levels of detail" << std::endl;
+        return FAILED;
+    }
+    if(s.patchResolution < 2 || s.patchResolution % 2 != 0){
+        std::cerr << "[ERROR] Terrain patch resolution must be even" << std::endl;
+        return FAILED;
+    }
+
+    settings = s;
+    heights = std::move(h);
+    resolution = res;
+
+    // every level reaches twice as far as the one below, like its nodes are twice as large
+    uint32_t leafCount = 1u << (settings.lodCount - 1);
+    float leafSize = settings.size / leafCount;
+    lodRanges.resize(settings.lodCount);
+    lodRanges[0] = leafSize * settings.lodDistanceRatio;
+    for(uint32_t l = 1; l < settings.lodCount; l++){
+        lodRanges[l] = 2.f * lodRanges[l - 1];
+    }
+
+    // height ranges of leaves from samples they cover, interpolated heights never leave that range
+    heightRanges.assign(settings.lodCount, {});
+    heightRanges[0].resize(size_t(leafCount) * leafCount);
+    float samplesPerLeaf = float(resolution - 1) / leafCount;
+    parallelFor(leafCount, [&](size_t z){
+        uint32_t z0 = static_cast<uint32_t>(std::floor(z * samplesPerLeaf));
+        uint32_t z1 = std::min(static_cast<uint32_t>(std::ceil((z + 1) * samplesPerLeaf)), resolution - 1);
+        for(uint32_t x = 0; x < leafCount; x++){
+            uint32_t x0 = static_cast<uint32_t>(std::floor(x * samplesPerLeaf));
+            uint32_t x1 = std::min(static_cast<uint32_t>(std::ceil((x + 1) * samplesPerLeaf)), resolution - 1);
+
+            HeightRange range = {heights[z0 * resolution + x0], heights[z0 * resolution + x0]};
+            for(uint32_t j = z0; j <= z1; j++){
+                const float* row = heights.data() + size_t(j) * resolution;
+                for(uint32_t i = x0; i <= x1; i++){
+                    range.min = std::min(range.min, row[i]);
+                    range.max = std::max(range.max, row[i]);
+                }
+            }
+            heightRanges[0][z * leafCount + x] = range;
+        }
+    });
+
+    // parents cover their four children
+    for(uint32_t l = 1; l < settings.lodCount; l++){
+        uint32_t count = leafCount >> l;
+        const std::vector<HeightRange>& children = heightRanges[l - 1];
+        heightRanges[l].resize(size_t(count) * count);
+        for(uint32_t z = 0; z < count; z++){
+            for(uint32_t x = 0; x < count; x++){
+                const HeightRange* c0 = &children[(2 * z) * (2 * count) + 2 * x];
+                const HeightRange* c1 = c0 + 2 * count;
+                heightRanges[l][z * count + x] = {
+                    std::min({c0[0].min, c0[1].min, c1[0].min, c1[1].min}),
+                    std::max({c0[0].max, c0[1].max, c1[0].max, c1[1].max})
+                };
+            }
+        }
+    }
+
+    std::cout << "[INFO] Terrain of " << settings.size << " units, " << settings.lodCount
+              << " levels of detail, " << resolution << "x" << resolution << " heightmap" << std::endl;
+
+    return SUCCESS;
+}
+
+void Terrain::select(const glm::vec3& viewPosition, const Frustum& frustum, TerrainSelection& selection) const{
+    selection.clear();
+    if(heightRanges.empty()) return;
+
+    // root is drawn even when camera is beyond its range
+    uint32_t root = settings.lodCount - 1;
+    if(!selectNode(root, 0, 0, viewPosition, frustum, selection)){
+        selection.whole.push_back({settings.origin, settings.size, float(root)});
+    }
+}
+
+bool Terrain::selectNode(uint32_t level, uint32_t x, uint32_t z, const glm::vec3& viewPosition,
+                         const Frustum& frustum, TerrainSelection& selection) const{
+    glm::vec3 min, max;
+    getNodeBox(level, x, z, min, max);
+
+    // nothing to draw, nor for parent to draw instead
+    if(!frustum.intersectsBox(min, max)) return true;
+
+    // too far for this level, parent covers area of node
+    if(!sphereIntersectsBox(viewPosition, lodRanges[level], min, max)) return false;
+
+    float size = max.x - min.x;
+    TerrainNode node = {glm::vec2(min.x, min.z), size, float(level)};
+
+    // whole node is drawn if it's a leaf or no part of it is close enough for finer level
+    if(level == 0 || !sphereIntersectsBox(viewPosition, lodRanges[level - 1], min, max)){
+        selection.whole.push_back(node);
+        return true;
+    }
+
+    // children close enough are drawn at finer level, quarters of others at this level
+    for(uint32_t q = 0; q < 4; q++){
+        uint32_t childX = 2 * x + (q & 1), childZ = 2 * z + (q >> 1);
+        if(!selectNode(level - 1, childX, childZ, viewPosition, frustum, selection)){
+            selection.quarters[q].push_back(node);
+        }
+    }
+    return true;
+}
+
+void Terrain::getNodeBox(uint32_t level, uint32_t x, uint32_t z, glm::vec3& min, glm::vec3& max) const{
+    uint32_t count = 1u << (settings.lodCount - 1 - level);
+    float size = settings.size / count;
+    const HeightRange& range = heightRanges[level][z * count + x];
+
+    min = glm::vec3(settings.origin.x + x * size, range.min, settings.origin.y + z * size);
+    max = glm::vec3(min.x + size, range.max, min.z + size);
+}
+
+float Terrain::getHeight(float x, float z) const{
+    if(heights.empty()) return 0.f;
+
+    // position in samples, clamped to heightmap
+    float scale = (resolution - 1) / settings.size;
+    float u = std::clamp((x - settings.origin.x) * scale, 0.f, float(resolution - 1));
+    float v = std::clamp((z - settings.origin.y) * scale, 0.f, float(resolution - 1));
+
+    uint32_t i = std::min(static_cast<uint32_t>(u), resolution - 2);
+    uint32_t j = std::min(static_cast<uint32_t>(v), resolution - 2);
+    float fu = u - i, fv = v - j;
+
+    const float* row0 = heights.data() + size_t(j) * resolution + i;
+    const float* row1 = row0 + resolution;
+    float h0 = row0[0] + (row0[1] - row0[0]) * fu;
+    float h1 = row1[0] + (row1[1] - row1[0]) * fu;
+    return h0 + (h1 - h0) * fv;
+}
+
+void Terrain::createPatchMesh(Mesh& mesh) const{
+    uint32_t n = settings.patchResolution;
+    uint32_t width = n + 1;
+
+    // flat grid, heights and normals come from heightmap on gpu
+    mesh.vertices.resize(size_t(width) * width);
+    for(uint32_t j = 0; j < width; j++){
+        for(uint32_t i = 0; i < width; i++){
+            Vertex& vertex = mesh.vertices[j * width + i];
+            vertex.position = glm::vec3(float(i), 0.f, float(j));
+            vertex.color = settings.color;
+            vertex.normal = glm::vec3(0.f, 1.f, 0.f);
+        }
+    }
+
+    // cells of one quarter after another, so a quarter can be drawn alone
+    uint32_t half = n / 2;
+    mesh.indices.clear();
+    mesh.indices.reserve(size_t(n) * n * 6);
+    for(uint32_t q = 0; q < 4; q++){
+        uint32_t startX = (q & 1) * half, startZ = (q >> 1) * half;
+        for(uint32_t j = startZ; j < startZ + half; j++){
+            for(uint32_t i = startX; i < startX + half; i++){
+                // same winding as createGridIndices
+                uint32_t v1 = j * width + i, v2 = v1 + 1;
+                uint32_t v4 = (j + 1) * width + i, v3 = v4 + 1;
+                mesh.indices.insert(mesh.indices.end(), {v4, v2, v1, v4, v3, v2});
+            }
+        }
+    }
+    mesh.hasIndexBuffer = true;
+
+    // reordering triangles for vertex cache would mix quarters
+    mesh.optimized = true;
+    mesh.format = VertexFormat::Float;
+
+    // grid is placed by vertex shader, bounds of patch itself mean nothing
+    mesh.boundsCenter = glm::vec3(0.5f * n, 0.f, 0.5f * n);
+    mesh.boundsRadius = 0.75f * n;
+}
+
+TerrainParameters Terrain::getParameters() const{
+    TerrainParameters parameters = {};
+    parameters.origin = settings.origin;
+    parameters.size = settings.size;
+    parameters.lodRange = lodRanges.empty() ? 0.f : lodRanges[0];
+    parameters.morphRatio = settings.morphRatio;
+    parameters.heightResolution = resolution;
+    parameters.patchResolution = settings.patchResolution;
+    parameters.color = glm::vec4(settings.color, 1.f);
+    return parameters;
+}
@@ -0,0 +1,202 @@
+#ifndef TERRAIN_HPP
+#define TERRAIN_HPP
+
+#include <array>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Common.hpp"
+#include "ReturnCode.hpp"
+#include "Frustum.hpp"
+#include "Mesh.hpp"
+#include "Parallel.hpp"
+#include "VertexInputDescription.hpp"
+
+// layout and level of detail settings of a terrain, fixed at creation
+struct TerrainSettings {
+    // minimum x and z corner of terrain in world space
+    glm::vec2 origin = glm::vec2(0.f);
+    // side length of square terrain in world units
+    float size = 1024.f;
+    // number of levels of quadtree, root is level lodCount - 1 and leaves are level 0
+    uint32_t lodCount = 6;
+    // number of grid cells along side of a patch, must be even
+    // every selected node is drawn with a patch of this many cells, so this decides triangle density
+    uint32_t patchResolution = 32;
+    // distance up to which leaves are drawn, in leaf sizes, doubles with every level
+    // values below about 3.5 let nodes reach past their morph range and crack
+    float lodDistanceRatio = 4.f;
+    // fraction at end of every level's range over which vertices morph into next level
+    float morphRatio = 0.3f;
+    // color of terrain
+    glm::vec3 color = glm::vec3(0.35f, 0.4f, 0.25f);
+};
+
+// a quadtree node selected for drawing, sent to gpu as instance data of a patch
+struct TerrainNode {
+    // minimum x and z corner of node in world space
+    glm::vec2 origin;
+    // side length of node
+    float size;
+    // level of node, decides its morph range
+    float level;
+
+    /**
+     * @brief Get vertex input description of terrain patches.
+     * Patch grid positions are fetched from binding 0 and nodes
+     * from binding 1, once per instance.
+     * */
+    static VertexInputDescription getVertexDescription();
+};
+
+// nodes selected for a frame, grouped by part of patch they're drawn with
+struct TerrainSelection {
+    // nodes drawn whole
+    std::vector<TerrainNode> whole;
+    // nodes of which only one quarter is drawn, their other quarters are covered by finer children
+    // quarter 0 is at node origin, 1 is along x, 2 along z and 3 is opposite to origin
+    std::array<std::vector<TerrainNode>, 4> quarters;
+
+    /// remove all nodes
+    void clear();
+
+    /// total number of selected nodes
+    size_t size() const;
+};
+
+// push constants of terrain pipeline
+// layout matches TerrainParameters block of shaders/terrain.vert
+struct TerrainParameters {
+    glm::vec2 origin;
+    float size;
+    // range of level 0, doubles with every level
+    float lodRange;
+    float morphRatio;
+    // number of height samples along a side of heightmap
+    uint32_t heightResolution;
+    uint32_t patchResolution;
+    float padding;
+    // color of terrain, w is unused
+    glm::vec4 color;
+};
+
+/**
+ * @brief Heightfield terrain drawn with continuous distance dependent levels of detail (CDLOD).
+ * Terrain is a quadtree whose nodes are all drawn with the same grid patch,
+ * instanced and displaced by heightmap on gpu. Every frame nodes are selected
+ * by distance from camera, with each level covering twice the range of the
+ * one below, so number of triangles drawn stays about the same however large
+ * terrain gets. Near end of its range every vertex morphs into grid of next
+ * level, so there's no popping nor cracks between levels.
+ * */
+class Terrain {
+public:
+    /**
+     * @brief Create terrain from a square heightmap.
+     * Heightmap is stretched over whole terrain, sample (0, 0) is at origin.
+     *
+     * @param settings Layout and level of detail settings.
+     * @param heights Heights of resolution x resolution samples, row by row along x, rows along z.
+     * @param resolution Number of samples along a side of heightmap, at least 2.
+     * @return SUCCESS on success, FAILED if settings or heightmap are invalid.
+     * */
+    ReturnCode init(const TerrainSettings& settings, std::vector<float> heights, uint32_t resolution);
+
+    /**
+     * @brief Create terrain by sampling a height function.
+     * Function is evaluated once per heightmap sample, rows are evaluated in parallel.
+     *
+     * @param settings Layout and level of detail settings.
+     * @param resolution Number of samples along a side of heightmap, at least 2.
+     * @param height Callable returning height for given world x and z.
+     * @return SUCCESS on success, FAILED if settings are invalid.
+     * */
+    template<typename HeightFunction>
+    ReturnCode init(const TerrainSettings& settings, uint32_t resolution, HeightFunction&& height){
+        std::vector<float> heights(size_t(resolution) * resolution);
+        float spacing = resolution > 1 ? settings.size / (resolution - 1) : 0.f;
+        parallelFor(resolution, [&](size_t j){
+            float* row = heights.data() + j * resolution;
+            const float z = settings.origin.y + j * spacing;
+            for(size_t i = 0; i < resolution; i++){
+                row[i] = height(settings.origin.x + i * spacing, z);
+            }
+        });
+
+        return init(settings, std::move(heights), resolution);
+    }
+
+    /**
+     * @brief Select nodes to draw for given view.
+     * Nodes outside of frustum are culled, rest get coarser with distance.
+     *
+     * @param viewPosition Position of camera.
+     * @param frustum View frustum of camera.
+     * @param[out] selection Selected nodes, cleared first.
+     * */
+    void select(const glm::vec3& viewPosition, const Frustum& frustum, TerrainSelection& selection) const;
+
+    /**
+     * @brief Get height of terrain at given point, interpolated between samples.
+     * Points outside of terrain get height of nearest edge.
+     *
+     * @param x World x coordinate.
+     * @param z World z coordinate.
+     * @return float Height.
+     * */
+    float getHeight(float x, float z) const;
+
+    /**
+     * @brief Create patch mesh all nodes are drawn with.
+     * Vertex positions are integer grid coordinates in x and z, converted to world
+     * space by vertex shader. Triangles are ordered by quarter of patch, so each
+     * quarter is a contiguous index range of getQuarterIndexCount() indices.
+     *
+     * @param[out] mesh Mesh object to store patch into.
+     * */
+    void createPatchMesh(Mesh& mesh) const;
+
+    /// number of indices in every quarter of patch mesh
+    inline uint32_t getQuarterIndexCount() const {
+        return settings.patchResolution * settings.patchResolution / 4 * 6;
+    }
+
+    /// get distance up to which nodes of given level are drawn
+    inline float getLodRange(uint32_t level) const { return lodRanges[level]; }
+
+    /// get push constants describing terrain to vertex shader
+    TerrainParameters getParameters() const;
+
+    /// get settings terrain was created with
+    inline const TerrainSettings& getSettings() const { return settings; }
+
+    /// get heightmap samples
+    inline const std::vector<float>& getHeights() const { return heights; }
+
+    /// get number of samples along a side of heightmap
+    inline uint32_t getResolution() const { return resolution; }
+private:
+    // minimum and maximum height of every node, for bounding boxes
+    struct HeightRange {
+        float min, max;
+    };
+
+    // select node (x, z) of given level, returns false if node is out of
+    // range of its level and has to be drawn by its parent instead
+    bool selectNode(uint32_t level, uint32_t x, uint32_t z, const glm::vec3& viewPosition,
+                    const Frustum& frustum, TerrainSelection& selection) const;
+
+    // bounding box of node (x, z) of given level
+    void getNodeBox(uint32_t level, uint32_t x, uint32_t z, glm::vec3& min, glm::vec3& max) const;
+
+    TerrainSettings settings;
+    std::vector<float> heights;
+    uint32_t resolution = 0;
+
+    // height ranges of nodes of every level, level l has (2^(lodCount - 1 - l))^2 nodes stored row by row
+    std::vector<std::vector<HeightRange>> heightRanges;
+    // distance up to which every level is drawn
+    std::vector<float> lodRanges;
+};
+
+#endif//TERRAIN_HPP
@@ -0,0 +1,391 @@
+#include "TransformStore.hpp"
+#include "Parallel.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define TRANSFORM_STORE_SSE 1
+#endif
+
+namespace {
+
+// index of lowest set bit, bits must not be 0
+inline uint32_t lowestBit(uint64_t bits){
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<uint32_t>(__builtin_ctzll(bits));
+#else
+    uint32_t bit = 0;
+    while(((bits >> bit) & 1) == 0) bit++;
+    return bit;
+#endif
+}
+
+// product of two normal matrices, only 3x3 part is used
+inline glm::mat3x4 multiplyNormal(const glm::mat3x4& a, const glm::mat3x4& b){
+    glm::mat3x4 result;
+    for(int c = 0; c < 3; c++){
+        result[c] = a[0] * b[c].x + a[1] * b[c].y + a[2] * b[c].z;
+    }
+    return result;
+}
+
+} // namespace
+
+uint32_t TransformStore::create(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale){
+    uint32_t id;
+    if(!freeIds.empty()){
+        id = freeIds.back();
+        freeIds.pop_back();
+    }else{
+        id = static_cast<uint32_t>(positions.size());
+        positions.emplace_back();
+        rotations.emplace_back();
+        scales.emplace_back();
+        parents.push_back(invalid);
+        localMatrices.emplace_back(1.f);
+        localNormalMatrices.emplace_back(1.f);
+        if(id / 64 >= dirty.size()){
+            dirty.push_back(0);
+            alive.push_back(0);
+        }
+
+        // roots can go in any level, new one joins last so order stays valid without rebuild
+        slots.push_back(static_cast<uint32_t>(order.size()));
+        order.push_back(id);
+        slotParents.push_back(invalid);
+        worldMatrices.emplace_back(1.f);
+        worldNormalMatrices.emplace_back(1.f);
+        changed.push_back(0);
+        if(levelOffsets.empty()) levelOffsets.push_back(0);
+        if(levelOffsets.size() < 2){
+            levelOffsets.push_back(0);
+            levelRanges.emplace_back();
+        }
+        levelOffsets.back()++;
+        // new slot has no children, its empty child range starts where last one ends
+        if(childSlots.empty()) childSlots.push_back(0);
+        childSlots.push_back(childSlots.back());
+    }
+
+    alive[id / 64] |= uint64_t(1) << (id % 64);
+    positions[id] = position;
+    scales[id] = scale;
+    setRotation(id, rotation);
+
+    return id;
+}
+
+void TransformStore::destroy(uint32_t id){
+    dirty[id / 64] &= ~(uint64_t(1) << (id % 64));
+    alive[id / 64] &= ~(uint64_t(1) << (id % 64));
+    freeIds.push_back(id);
+
+    // destroyed transform and its children stay in their levels as roots
+    parents[id] = invalid;
+    slotParents[slots[id]] = invalid;
+    for(uint32_t child = 0; child < parents.size(); child++){
+        if(parents[child] != id) continue;
+        parents[child] = invalid;
+        slotParents[slots[child]] = invalid;
+        markDirty(child);
+    }
+}
+
+void TransformStore::clear(){
+    positions.clear();
+    rotations.clear();
+    scales.clear();
+    parents.clear();
+    localMatrices.clear();
+    localNormalMatrices.clear();
+    dirty.clear();
+    alive.clear();
+    freeIds.clear();
+    order.clear();
+    slots.clear();
+    slotParents.clear();
+    childSlots.clear();
+    levelOffsets.clear();
+    levelRanges.clear();
+    worldMatrices.clear();
+    worldNormalMatrices.clear();
+    changed.clear();
+    orderDirty = false;
+}
+
+bool TransformStore::setParent(uint32_t id, uint32_t parent){
+    // destroyed slots must not be linked into hierarchy
+    if(!isAlive(id) || (parent != invalid && !isAlive(parent))){
+        std::cerr << "[WARNING] Destroyed transforms can't have or be parents" << std::endl;
+        return false;
+    }
+    if(parents[id] == parent) return true;
+
+    // walking up from new parent must not reach transform itself
+    for(uint32_t ancestor = parent; ancestor != invalid; ancestor = parents[ancestor]){
+        if(ancestor == id){
+            std::cerr << "[WARNING] Transform can't be parented to itself or its descendant" << std::endl;
+            return false;
+        }
+    }
+
+    parents[id] = parent;
+    orderDirty = true;
+    return true;
+}
+
+void TransformStore::rebuildOrder(){
+    uint32_t count = static_cast<uint32_t>(positions.size());
+
+    // children of every transform, packed one list after another
+    std::vector<uint32_t> childOffsets(count + 1, 0);
+    for(uint32_t id = 0; id < count; id++){
+        if(parents[id] != invalid) childOffsets[parents[id] + 1]++;
+    }
+    for(uint32_t id = 0; id < count; id++){
+        childOffsets[id + 1] += childOffsets[id];
+    }
+    std::vector<uint32_t> children(childOffsets[count]);
+    std::vector<uint32_t> filled(childOffsets.begin(), childOffsets.end() - 1);
+    for(uint32_t id = 0; id < count; id++){
+        if(parents[id] != invalid) children[filled[parents[id]]++] = id;
+    }
+
+    // roots first, then children of every level form next level
+    // children of consecutive slots are consecutive, so every subtree is one range per level
+    order.clear();
+    for(uint32_t id = 0; id < count; id++){
+        if(parents[id] == invalid) order.push_back(id);
+    }
+    levelOffsets.assign(1, 0);
+    childSlots.assign(1, static_cast<uint32_t>(order.size()));
+    for(size_t begin = 0; begin < order.size();){
+        size_t end = order.size();
+        levelOffsets.push_back(end);
+        for(size_t slot = begin; slot < end; slot++){
+            uint32_t id = order[slot];
+            order.insert(order.end(), children.begin() + childOffsets[id], children.begin() + childOffsets[id + 1]);
+            childSlots.push_back(static_cast<uint32_t>(order.size()));
+        }
+        begin = end;
+    }
+
+    for(uint32_t slot = 0; slot < count; slot++){
+        slots[order[slot]] = slot;
+    }
+    for(uint32_t slot = 0; slot < count; slot++){
+        uint32_t parent = parents[order[slot]];
+        slotParents[slot] = parent == invalid ? invalid : slots[parent];
+    }
+
+    // slots moved, so every world matrix is recomputed
+    std::fill(changed.begin(), changed.end(), 1);
+    levelRanges.resize(getLevelCount());
+    for(size_t level = 0; level < levelRanges.size(); level++){
+        levelRanges[level] = {levelOffsets[level], levelOffsets[level + 1]};
+    }
+    orderDirty = false;
+}
+
+TransformStore::SlotRange TransformStore::propagate(size_t begin, size_t end){
+    SlotRange updated = {end, begin};
+    for(size_t slot = begin; slot < end; slot++){
+        uint32_t parent = slotParents[slot];
+        if(parent != invalid && changed[parent]) changed[slot] = 1;
+        if(!changed[slot]) continue;
+
+        uint32_t id = order[slot];
+        if(parent == invalid){
+            worldMatrices[slot] = localMatrices[id];
+            worldNormalMatrices[slot] = localNormalMatrices[id];
+        }else{
+            // inverse transpose of a product is product of inverse transposes
+            worldMatrices[slot] = worldMatrices[parent] * localMatrices[id];
+            worldNormalMatrices[slot] = multiplyNormal(worldNormalMatrices[parent], localNormalMatrices[id]);
+        }
+        updated.begin = std::min(updated.begin, slot);
+        updated.end = slot + 1;
+    }
+    return updated;
+}
+
+size_t TransformStore::update(){
+    bool rebuilt = orderDirty;
+    if(orderDirty) rebuildOrder();
+    else std::fill(levelRanges.begin(), levelRanges.end(), SlotRange{SIZE_MAX, 0});
+
+    // dirty transforms are collected in batches of four, skipping clean words of bitset at once
+    uint32_t batch[4];
+    size_t batchSize = 0, composed = 0;
+    for(size_t w = 0; w < dirty.size(); w++){
+        uint64_t bits = dirty[w];
+        dirty[w] = 0;
+        while(bits != 0){
+            uint32_t id = static_cast<uint32_t>(w * 64 + lowestBit(bits));
+            bits &= bits - 1;
+
+            // level of slot widens range of slots looked at in that level
+            uint32_t slot = slots[id];
+            size_t level = std::upper_bound(levelOffsets.begin(), levelOffsets.end(), slot) - levelOffsets.begin() - 1;
+            levelRanges[level].begin = std::min(levelRanges[level].begin, size_t(slot));
+            levelRanges[level].end = std::max(levelRanges[level].end, size_t(slot) + 1);
+            changed[slot] = 1;
+
+            batch[batchSize++] = id;
+            if(batchSize == 4){
+                composeBatch(batch);
+                composed += 4;
+                batchSize = 0;
+            }
+        }
+    }
+
+    // pad last batch by repeating its last transform
+    if(batchSize > 0){
+        composed += batchSize;
+        for(size_t i = batchSize; i < 4; i++) batch[i] = batch[batchSize - 1];
+        composeBatch(batch);
+    }
+
+    if(composed == 0 && !rebuilt) return 0;
+
+    // level by level, every level only reads world matrices of levels before it
+    // only children of slots changed in level above and dirty slots of level are looked at
+    size_t updated = 0;
+    SlotRange above = {0, 0};
+    for(size_t level = 0; level < levelRanges.size(); level++){
+        SlotRange& range = levelRanges[level];
+        if(above.begin < above.end){
+            range.begin = std::min(range.begin, size_t(childSlots[above.begin]));
+            range.end = std::max(range.end, size_t(childSlots[above.end]));
+        }
+        if(range.begin >= range.end){
+            above = {0, 0};
+            continue;
+        }
+
+        if(range.end - range.begin < parallelLevelSize){
+            above = propagate(range.begin, range.end);
+        }else{
+            const size_t chunkSize = parallelLevelSize / 4;
+            std::vector<SlotRange> chunkRanges((range.end - range.begin + chunkSize - 1) / chunkSize);
+            parallelFor(chunkRanges.size(), [&](size_t chunk){
+                size_t first = range.begin + chunk * chunkSize;
+                chunkRanges[chunk] = propagate(first, std::min(first + chunkSize, range.end));
+            });
+            above = {range.end, range.begin};
+            for(const SlotRange& chunkRange : chunkRanges){
+                above.begin = std::min(above.begin, chunkRange.begin);
+                above.end = std::max(above.end, chunkRange.end);
+            }
+        }
+        if(above.begin < above.end) updated += std::count(changed.begin() + above.begin, changed.begin() + above.end, 1);
+    }
+
+    // only slots looked at can be marked
+    for(const SlotRange& range : levelRanges){
+        if(range.begin < range.end) std::memset(changed.data() + range.begin, 0, range.end - range.begin);
+    }
+
+    return updated;
+}
+
+void TransformStore::compose(const glm::vec3& position, const glm::quat& q, const glm::vec3& scale,
+                             glm::mat4& model, glm::mat3x4* normal){
+    // rotation matrix of unit quaternion
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    glm::vec3 r0(1.f - 2.f * (yy + zz), 2.f * (xy + wz), 2.f * (xz - wy));
+    glm::vec3 r1(2.f * (xy - wz), 1.f - 2.f * (xx + zz), 2.f * (yz + wx));
+    glm::vec3 r2(2.f * (xz + wy), 2.f * (yz - wx), 1.f - 2.f * (xx + yy));
+
+    model[0] = glm::vec4(r0 * scale.x, 0.f);
+    model[1] = glm::vec4(r1 * scale.y, 0.f);
+    model[2] = glm::vec4(r2 * scale.z, 0.f);
+    model[3] = glm::vec4(position, 1.f);
+
+    // rotation is orthonormal, so inverse transpose of rotation * scale is rotation / scale
+    if(normal != nullptr){
+        auto inverse = [](float s){ return s != 0.f ? 1.f / s : 0.f; };
+        (*normal)[0] = glm::vec4(r0 * inverse(scale.x), 0.f);
+        (*normal)[1] = glm::vec4(r1 * inverse(scale.y), 0.f);
+        (*normal)[2] = glm::vec4(r2 * inverse(scale.z), 0.f);
+    }
+}
+
+#ifdef TRANSFORM_STORE_SSE
+
+void TransformStore::composeBatch(const uint32_t* ids){
+    // gather fields of four transforms into lanes, one register per component
+    alignas(16) float lanes[10][4];
+    for(int l = 0; l < 4; l++){
+        const glm::vec3& p = positions[ids[l]];
+        const glm::quat& q = rotations[ids[l]];
+        const glm::vec3& s = scales[ids[l]];
+        lanes[0][l] = p.x; lanes[1][l] = p.y; lanes[2][l] = p.z;
+        lanes[3][l] = q.x; lanes[4][l] = q.y; lanes[5][l] = q.z; lanes[6][l] = q.w;
+        lanes[7][l] = s.x; lanes[8][l] = s.y; lanes[9][l] = s.z;
+    }
+    __m128 qx = _mm_load_ps(lanes[3]), qy = _mm_load_ps(lanes[4]);
+    __m128 qz = _mm_load_ps(lanes[5]), qw = _mm_load_ps(lanes[6]);
+    __m128 scale[3] = {_mm_load_ps(lanes[7]), _mm_load_ps(lanes[8]), _mm_load_ps(lanes[9])};
+
+    // same rotation matrix as compose(), for four quaternions at once
+    const __m128 one = _mm_set1_ps(1.f), zero = _mm_setzero_ps();
+    __m128 x2 = _mm_add_ps(qx, qx), y2 = _mm_add_ps(qy, qy), z2 = _mm_add_ps(qz, qz);
+    __m128 xx = _mm_mul_ps(qx, x2), yy = _mm_mul_ps(qy, y2), zz = _mm_mul_ps(qz, z2);
+    __m128 xy = _mm_mul_ps(qx, y2), xz = _mm_mul_ps(qx, z2), yz = _mm_mul_ps(qy, z2);
+    __m128 wx = _mm_mul_ps(qw, x2), wy = _mm_mul_ps(qw, y2), wz = _mm_mul_ps(qw, z2);
+
+    // rows of every rotation column
+    __m128 r[3][3] = {
+        {_mm_sub_ps(one, _mm_add_ps(yy, zz)), _mm_add_ps(xy, wz), _mm_sub_ps(xz, wy)},
+        {_mm_sub_ps(xy, wz), _mm_sub_ps(one, _mm_add_ps(xx, zz)), _mm_add_ps(yz, wx)},
+        {_mm_add_ps(xz, wy), _mm_sub_ps(yz, wx), _mm_sub_ps(one, _mm_add_ps(xx, yy))}
+    };
+
+    for(int c = 0; c < 3; c++){
+        // zero scale gives zero normal column instead of infinities
+        __m128 inverse = _mm_and_ps(_mm_div_ps(one, scale[c]), _mm_cmpneq_ps(scale[c], zero));
+
+        // lanes hold one row of four matrices, transpose turns them into columns of each
+        __m128 m0 = _mm_mul_ps(r[c][0], scale[c]), m1 = _mm_mul_ps(r[c][1], scale[c]);
+        __m128 m2 = _mm_mul_ps(r[c][2], scale[c]), m3 = zero;
+        _MM_TRANSPOSE4_PS(m0, m1, m2, m3);
+        _mm_storeu_ps(&localMatrices[ids[0]][c].x, m0);
+        _mm_storeu_ps(&localMatrices[ids[1]][c].x, m1);
+        _mm_storeu_ps(&localMatrices[ids[2]][c].x, m2);
+        _mm_storeu_ps(&localMatrices[ids[3]][c].x, m3);
+
+        __m128 n0 = _mm_mul_ps(r[c][0], inverse), n1 = _mm_mul_ps(r[c][1], inverse);
+        __m128 n2 = _mm_mul_ps(r[c][2], inverse), n3 = zero;
+        _MM_TRANSPOSE4_PS(n0, n1, n2, n3);
+        _mm_storeu_ps(&localNormalMatrices[ids[0]][c].x, n0);
+        _mm_storeu_ps(&localNormalMatrices[ids[1]][c].x, n1);
+        _mm_storeu_ps(&localNormalMatrices[ids[2]][c].x, n2);
+        _mm_storeu_ps(&localNormalMatrices[ids[3]][c].x, n3);
+    }
+
+    __m128 t0 = _mm_load_ps(lanes[0]), t1 = _mm_load_ps(lanes[1]), t2 = _mm_load_ps(lanes[2]), t3 = one;
+    _MM_TRANSPOSE4_PS(t0, t1, t2, t3);
+    _mm_storeu_ps(&localMatrices[ids[0]][3].x, t0);
+    _mm_storeu_ps(&localMatrices[ids[1]][3].x, t1);
+    _mm_storeu_ps(&localMatrices[ids[2]][3].x, t2);
+    _mm_storeu_ps(&localMatrices[ids[3]][3].x, t3);
+}
+
+#else
+
+void TransformStore::composeBatch(const uint32_t* ids){
+    for(int l = 0; l < 4; l++){
+        uint32_t id = ids[l];
+        compose(positions[id], rotations[id], scales[id], localMatrices[id], &localNormalMatrices[id]);
+    }
+}
+
+#endif
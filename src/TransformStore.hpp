@@ -0,0 +1,161 @@
+#ifndef TRANSFORM_STORE_HPP
+#define TRANSFORM_STORE_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+/**
+ * @brief Position, rotation and scale of many objects, stored field by field.
+ * Setters only write their field and mark transform dirty. Local matrices of
+ * dirty transforms are composed together in update(), once per frame, four
+ * transforms at a time with SIMD where available.
+ *
+ * Transforms can have a parent, their position, rotation and scale are then
+ * relative to it. World matrices are kept in breadth first order of hierarchy,
+ * so parents always come before children and every level of hierarchy is one
+ * contiguous range. update() walks this order once and recomputes only
+ * transforms that are dirty or below a dirty one, moving a parent moves its
+ * whole subtree without touching rest of the store. Large levels are split
+ * across threads.
+ *
+ * Transforms are identified by index, indices of destroyed transforms are reused.
+ * */
+class TransformStore {
+public:
+    /// index of no transform
+    static constexpr uint32_t invalid = UINT32_MAX;
+
+    /**
+     * @brief Create a root transform, it's dirty until next update().
+     *
+     * @return uint32_t Index of transform.
+     * */
+    uint32_t create(const glm::vec3& position = glm::vec3(0.f),
+                    const glm::quat& rotation = glm::quat(1.f, 0.f, 0.f, 0.f),
+                    const glm::vec3& scale = glm::vec3(1.f));
+
+    /// free transform, its children become roots, its index can be returned by later create() calls
+    void destroy(uint32_t id);
+
+    /// destroy all transforms
+    void clear();
+
+    /**
+     * @brief Attach transform to a parent, its local transform is kept and becomes relative to parent.
+     * Hierarchy order is rebuilt on next update(), so reparenting is meant to be rare.
+     *
+     * @param id Transform to attach.
+     * @param parent New parent, invalid to make transform a root.
+     * @return bool false if either transform is destroyed, or parent is transform itself or one of its descendants.
+     * */
+    bool setParent(uint32_t id, uint32_t parent);
+
+    inline uint32_t getParent(uint32_t id) const { return parents[id]; }
+
+    inline void setPosition(uint32_t id, const glm::vec3& position) { positions[id] = position; markDirty(id); }
+    inline void setScale(uint32_t id, const glm::vec3& scale) { scales[id] = scale; markDirty(id); }
+
+    /// rotation is normalized, matrices are composed assuming unit quaternions
+    inline void setRotation(uint32_t id, const glm::quat& rotation) { rotations[id] = glm::normalize(rotation); markDirty(id); }
+
+    inline const glm::vec3& getPosition(uint32_t id) const { return positions[id]; }
+    inline const glm::quat& getRotation(uint32_t id) const { return rotations[id]; }
+    inline const glm::vec3& getScale(uint32_t id) const { return scales[id]; }
+
+    /// world model matrix as of last update()
+    inline const glm::mat4& getModelMatrix(uint32_t id) const { return worldMatrices[slots[id]]; }
+
+    /// inverse transpose of world rotation and scale as of last update(), columns padded for push constants
+    inline const glm::mat3x4& getNormalMatrix(uint32_t id) const { return worldNormalMatrices[slots[id]]; }
+
+    inline bool isDirty(uint32_t id) const { return (dirty[id / 64] >> (id % 64)) & 1; }
+
+    /// true if index belongs to a transform that's created and not destroyed
+    inline bool isAlive(uint32_t id) const { return id < positions.size() && ((alive[id / 64] >> (id % 64)) & 1); }
+
+    /// number of slots, including destroyed ones
+    inline size_t size() const { return positions.size(); }
+
+    /// number of levels of hierarchy, as of last update()
+    inline size_t getLevelCount() const { return levelOffsets.empty() ? 0 : levelOffsets.size() - 1; }
+
+    /**
+     * @brief Compose local matrices of dirty transforms and world matrices
+     * of them and their descendants.
+     *
+     * @return size_t Number of world matrices updated.
+     * */
+    size_t update();
+
+    /**
+     * @brief Compose matrices of a single transform, same results as update().
+     *
+     * @param[out] model Translation * rotation * scale.
+     * @param[out] normal Inverse transpose of rotation * scale, nullptr if not needed.
+     * */
+    static void compose(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale,
+                        glm::mat4& model, glm::mat3x4* normal = nullptr);
+
+    /// levels with at least this many transforms are propagated on multiple threads
+    static constexpr size_t parallelLevelSize = 16384;
+
+private:
+    inline void markDirty(uint32_t id) { dirty[id / 64] |= uint64_t(1) << (id % 64); }
+
+    // compose local matrices of four transforms, indices may repeat
+    void composeBatch(const uint32_t* ids);
+
+    // sort transforms in breadth first order, every world matrix is recomputed after this
+    void rebuildOrder();
+
+    // range of slots, empty if begin >= end
+    struct SlotRange {
+        size_t begin = SIZE_MAX;
+        size_t end = 0;
+    };
+
+    // compute world matrices of changed slots in [begin, end), parents must be done
+    // returns range from first to last updated slot
+    SlotRange propagate(size_t begin, size_t end);
+
+    // local transforms, by index
+    std::vector<glm::vec3> positions;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<uint32_t> parents;
+
+    std::vector<glm::mat4> localMatrices;
+    std::vector<glm::mat3x4> localNormalMatrices;
+
+    // one bit per transform
+    std::vector<uint64_t> dirty;
+    std::vector<uint64_t> alive;
+    // destroyed transforms
+    std::vector<uint32_t> freeIds;
+
+    // breadth first order, slot of a transform is its position in it
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> slots;
+    // slot of parent of every slot, invalid for roots
+    std::vector<uint32_t> slotParents;
+    // first slot of children of every slot, followed by number of slots
+    // children of slot s are in [childSlots[s], childSlots[s + 1])
+    std::vector<uint32_t> childSlots;
+    // first slot of every level, followed by number of slots
+    std::vector<size_t> levelOffsets;
+    // slots looked at in every level in current update
+    std::vector<SlotRange> levelRanges;
+    // order has to be rebuilt before next propagation
+    bool orderDirty = false;
+
+    // world transforms, by slot
+    std::vector<glm::mat4> worldMatrices;
+    std::vector<glm::mat3x4> worldNormalMatrices;
+    // slots whose world matrices are recomputed in current update
+    std::vector<uint8_t> changed;
+};
+
+#endif//TRANSFORM_STORE_HPP
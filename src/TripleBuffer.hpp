@@ -0,0 +1,86 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+
+/**
+ * @brief Lock free hand over of values from one writer thread to one reader thread.
+ * Writer fills its own buffer and publishes it, reader takes latest published
+ * buffer. A third buffer sits between them, so neither side ever waits for the
+ * other: writer can publish again while reader is still busy, and values
+ * published in between are overwritten by newer ones instead of queueing up.
+ * Buffers are reused, so values keep their allocations across hand overs.
+ * Reader can block in acquireWait() instead of polling when it runs out of values.
+ * */
+template<typename T>
+class TripleBuffer {
+public:
+    /// buffer writer is filling, owned by writer until publish()
+    inline T& getWriteBuffer() { return buffers[writeIndex]; }
+
+    /// make write buffer latest value and continue with an unused buffer
+    /// new write buffer holds an older value, it has to be fully overwritten
+    void publish() {
+        uint8_t previous = middle.exchange(writeIndex | freshBit, std::memory_order_acq_rel);
+        writeIndex = previous & indexMask;
+
+        // reader checks for value under lock before sleeping, so taking it here means
+        // reader is either asleep and gets notified, or sees new value before sleeping
+        { std::lock_guard<std::mutex> lock(mutex); }
+        published.notify_one();
+    }
+
+    /**
+     * @brief Take latest published value if there's one reader hasn't seen yet.
+     *
+     * @return bool true if read buffer changed.
+     * */
+    bool acquire() {
+        if((middle.load(std::memory_order_relaxed) & freshBit) == 0) return false;
+        uint8_t previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & indexMask;
+        return true;
+    }
+
+    /**
+     * @brief Take latest published value, waiting for one if reader has seen all of them.
+     *
+     * @param timeout Longest time to wait, so reader can check if it should stop.
+     * @return bool true if read buffer changed, false if nothing was published in time.
+     * */
+    template<typename Rep, typename Period>
+    bool acquireWait(const std::chrono::duration<Rep, Period>& timeout) {
+        if(acquire()) return true;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        published.wait_for(lock, timeout, [this](){
+            return (middle.load(std::memory_order_relaxed) & freshBit) != 0;
+        });
+        return acquire();
+    }
+
+    /// value last acquired by reader, owned by reader until next acquire()
+    inline const T& getReadBuffer() const { return buffers[readIndex]; }
+
+private:
+    static constexpr uint8_t indexMask = 3;
+    // set while middle buffer holds a value reader hasn't taken yet
+    static constexpr uint8_t freshBit = 4;
+
+    std::array<T, 3> buffers;
+    // each side owns one buffer, third one is exchanged atomically
+    uint8_t writeIndex = 0;
+    uint8_t readIndex = 1;
+    std::atomic<uint8_t> middle{2};
+
+    // only used to wake a waiting reader, hand over itself never locks
+    std::mutex mutex;
+    std::condition_variable published;
+};
+
+#endif//TRIPLE_BUFFER_HPP
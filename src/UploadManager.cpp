@@ -0,0 +1,267 @@
+#include "UploadManager.hpp"
+#include "Initializers.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// staging allocations are aligned to this many bytes
+constexpr VkDeviceSize stagingAlignment = 16;
+
+} // namespace
+
+void UploadManager::init(VkDevice device, VmaAllocator allocator, MemoryBudget* budget, uint32_t queueFamilyIndex, VkQueue queue,
+                         uint32_t dstQueueFamilyIndex, VkDeviceSize stagingSize){
+    this->device = device;
+    this->allocator = allocator;
+    this->budget = budget;
+    this->queue = queue;
+    this->srcQueueFamilyIndex = queueFamilyIndex;
+    this->dstQueueFamilyIndex = dstQueueFamilyIndex;
+    this->stagingSize = stagingSize / stagingAlignment * stagingAlignment;
+
+    // command buffers are reset individually when their batch is reused
+    VkCommandPoolCreateInfo commandPoolInfo =
+        defaultCommandPoolCreateInfo(queueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    VKCHECK(vkCreateCommandPool(device, &commandPoolInfo, nullptr, &commandPool));
+
+    for(Batch& batch : batches){
+        VkCommandBufferAllocateInfo cmdAllocInfo = defaultCommandBufferAllocateInfo(commandPool, 1);
+        VKCHECK(vkAllocateCommandBuffers(device, &cmdAllocInfo, &batch.commandBuffer));
+
+        VkFenceCreateInfo fenceCreateInfo = defaultFenceCreateInfo(0);
+        VKCHECK(vkCreateFence(device, &fenceCreateInfo, nullptr, &batch.fence));
+    }
+
+    // staging ring stays mapped for whole lifetime
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = STYPE(BUFFER_CREATE_INFO);
+    bufferInfo.pNext = nullptr;
+    bufferInfo.flags = 0;
+    bufferInfo.size = this->stagingSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+    allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    VmaAllocationInfo allocationInfo;
+    VKCHECK(vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &stagingBuffer.buffer,
+                            &stagingBuffer.allocation, &allocationInfo));
+    if(budget) budget->track(MemoryCategory::Staging, stagingBuffer.allocation);
+    stagingData = static_cast<uint8_t*>(allocationInfo.pMappedData);
+}
+
+void UploadManager::destroy(){
+    waitIdle();
+
+    for(Batch& batch : batches){
+        vkDestroyFence(device, batch.fence, nullptr);
+    }
+    vkDestroyCommandPool(device, commandPool, nullptr);
+    if(budget) budget->untrack(MemoryCategory::Staging, stagingBuffer.allocation);
+    vmaDestroyBuffer(allocator, stagingBuffer.buffer, stagingBuffer.allocation);
+
+    stagingBuffer = {};
+    stagingData = nullptr;
+}
+
+UploadTicket UploadManager::upload(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset){
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+
+    // big uploads are split so a single chunk always fits in ring
+    VkDeviceSize maxChunk = stagingSize / 2;
+
+    while(size > 0){
+        VkDeviceSize chunk = std::min(size, maxChunk);
+
+        // make space by submitting current batch and waiting for oldest ones
+        VkDeviceSize offset, consumed;
+        while(!allocateStaging(chunk, offset, consumed)){
+            if(recordingTicket != 0) flush();
+            else retireOldestBatch(true);
+        }
+
+        memcpy(stagingData + offset, src, chunk);
+        vmaFlushAllocation(allocator, stagingBuffer.allocation, offset, chunk);
+
+        Batch& batch = getRecordingBatch();
+        batch.stagingBytes += consumed;
+
+        VkBufferCopy copyRegion = {};
+        copyRegion.srcOffset = offset;
+        copyRegion.dstOffset = dstOffset;
+        copyRegion.size = chunk;
+        vkCmdCopyBuffer(batch.commandBuffer, stagingBuffer.buffer, dstBuffer, 1, &copyRegion);
+
+        // same barrier releases range at end of batch and acquires it on destination queue
+        VkBufferMemoryBarrier barrier = {};
+        barrier.sType = STYPE(BUFFER_MEMORY_BARRIER);
+        barrier.pNext = nullptr;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        barrier.srcQueueFamilyIndex = srcQueueFamilyIndex;
+        barrier.dstQueueFamilyIndex = dstQueueFamilyIndex;
+        barrier.buffer = dstBuffer;
+        barrier.offset = dstOffset;
+        barrier.size = chunk;
+        batch.ownershipBarriers.push_back(barrier);
+
+        src += chunk;
+        dstOffset += chunk;
+        size -= chunk;
+    }
+
+    return recordingTicket;
+}
+
+UploadTicket UploadManager::flush(){
+    if(recordingTicket == 0) return submittedTicket;
+
+    Batch& batch = getBatch(recordingTicket);
+
+    // release ownership of written ranges, no need if families are the same
+    if(srcQueueFamilyIndex != dstQueueFamilyIndex && !batch.ownershipBarriers.empty()){
+        vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0, 0, nullptr, static_cast<uint32_t>(batch.ownershipBarriers.size()),
+                             batch.ownershipBarriers.data(), 0, nullptr);
+    }
+
+    VKCHECK(vkEndCommandBuffer(batch.commandBuffer));
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = STYPE(SUBMIT_INFO);
+    submitInfo.pNext = nullptr;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+    // fence tells when batch is done, no need to idle the queue
+    VKCHECK(vkQueueSubmit(queue, 1, &submitInfo, batch.fence));
+
+    submittedTicket = recordingTicket;
+    recordingTicket = 0;
+    return submittedTicket;
+}
+
+bool UploadManager::isComplete(UploadTicket ticket){
+    // batches complete in order, so only oldest ones need to be checked
+    while(completedTicket < ticket && completedTicket < submittedTicket){
+        if(!retireOldestBatch(false)) break;
+    }
+
+    return ticket <= completedTicket;
+}
+
+void UploadManager::wait(UploadTicket ticket){
+    if(ticket == recordingTicket) flush();
+
+    while(completedTicket < ticket && completedTicket < submittedTicket){
+        retireOldestBatch(true);
+    }
+}
+
+void UploadManager::waitIdle(){
+    wait(flush());
+}
+
+void UploadManager::poll(){
+    while(retireOldestBatch(false));
+}
+
+void UploadManager::recordAcquireBarriers(VkCommandBuffer cmd, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess){
+    if(!pendingAcquires.empty()){
+        // batch fences are complete, so release already happened on source queue
+        for(VkBufferMemoryBarrier& barrier : pendingAcquires){
+            barrier.dstAccessMask = dstAccess;
+        }
+
+        if(srcQueueFamilyIndex != dstQueueFamilyIndex){
+            // acquire half of ownership transfer, source access is ignored
+            for(VkBufferMemoryBarrier& barrier : pendingAcquires){
+                barrier.srcAccessMask = 0;
+            }
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0, 0, nullptr,
+                                 static_cast<uint32_t>(pendingAcquires.size()), pendingAcquires.data(), 0, nullptr);
+        }else{
+            // same family, only make transfer writes visible
+            VkMemoryBarrier barrier = {};
+            barrier.sType = STYPE(MEMORY_BARRIER);
+            barrier.pNext = nullptr;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = dstAccess;
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+
+        pendingAcquires.clear();
+    }
+
+    acquiredTicket = completedTicket;
+}
+
+UploadManager::Batch& UploadManager::getRecordingBatch(){
+    if(recordingTicket != 0) return getBatch(recordingTicket);
+
+    // batch slot of new ticket was last used maxBatches tickets ago, it must be complete
+    UploadTicket ticket = submittedTicket + 1;
+    while(completedTicket + maxBatches < ticket){
+        retireOldestBatch(true);
+    }
+
+    Batch& batch = getBatch(ticket);
+    VKCHECK(vkResetFences(device, 1, &batch.fence));
+    batch.stagingBytes = 0;
+    batch.ownershipBarriers.clear();
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = STYPE(COMMAND_BUFFER_BEGIN_INFO);
+    beginInfo.pNext = nullptr;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VKCHECK(vkBeginCommandBuffer(batch.commandBuffer, &beginInfo));
+
+    recordingTicket = ticket;
+    return batch;
+}
+
+bool UploadManager::retireOldestBatch(bool block){
+    if(completedTicket >= submittedTicket) return false;
+
+    UploadTicket ticket = completedTicket + 1;
+    Batch& batch = getBatch(ticket);
+
+    if(block){
+        VKCHECK(vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX));
+    }else if(vkGetFenceStatus(device, batch.fence) != VK_SUCCESS){
+        return false;
+    }
+
+    // staging space of batch can be reused now
+    stagingUsed -= batch.stagingBytes;
+
+    // written ranges become available to destination queue once acquired
+    pendingAcquires.insert(pendingAcquires.end(), batch.ownershipBarriers.begin(), batch.ownershipBarriers.end());
+    batch.ownershipBarriers.clear();
+    completedTicket = ticket;
+    return true;
+}
+
+bool UploadManager::allocateStaging(VkDeviceSize size, VkDeviceSize& offset, VkDeviceSize& consumed){
+    // start from beginning whenever ring is empty
+    if(stagingUsed == 0) stagingHead = 0;
+
+    VkDeviceSize start = (stagingHead + stagingAlignment - 1) / stagingAlignment * stagingAlignment;
+    if(start + size > stagingSize){
+        // wrap around, bytes till end of ring are wasted
+        start = 0;
+        consumed = stagingSize - stagingHead + size;
+    }else{
+        consumed = start + size - stagingHead;
+    }
+
+    if(stagingUsed + consumed > stagingSize) return false;
+
+    offset = start;
+    stagingHead = start + size;
+    stagingUsed += consumed;
+    return true;
+}
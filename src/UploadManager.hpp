@@ -0,0 +1,171 @@
+#ifndef UPLOAD_MANAGER_HPP
+#define UPLOAD_MANAGER_HPP
+
+#include <array>
+#include <vector>
+
+#include "AllocatedBuffer.hpp"
+#include "MemoryBudget.hpp"
+
+/**
+ * @brief Identifies a batch of uploads.
+ * Tickets increase with every batch, so all uploads with
+ * a ticket lower than or equal to a completed one are complete too.
+ * Ticket 0 is always complete.
+ * */
+using UploadTicket = uint64_t;
+
+/**
+ * @brief Uploads data to gpu buffers through a persistently mapped staging ring.
+ * Copies are recorded into a batch and all copies of a batch are
+ * submitted together by flush(). Completion of batches is tracked
+ * with fences, so uploading never waits for the queue to go idle.
+ * Space of staging ring is reused as soon as batches using it complete.
+ * If copies run on a different queue family than the one consuming the
+ * data, ownership of uploaded ranges is released at the end of every batch
+ * and has to be acquired on the consuming queue with recordAcquireBarriers().
+ * */
+class UploadManager {
+public:
+    /**
+     * @brief Create staging ring, command buffers and fences.
+     *
+     * @param device Device to upload to.
+     * @param allocator Allocator to create staging ring from.
+     * @param budget Budget staging ring is counted towards, can be null.
+     * @param queueFamilyIndex Family of queue copies are submitted to.
+     * @param queue Queue copies are submitted to.
+     * @param dstQueueFamilyIndex Family of queue that uses uploaded data.
+     * @param stagingSize Size of staging ring in bytes.
+     * */
+    void init(VkDevice device, VmaAllocator allocator, MemoryBudget* budget, uint32_t queueFamilyIndex, VkQueue queue,
+              uint32_t dstQueueFamilyIndex, VkDeviceSize stagingSize = defaultStagingSize);
+
+    /**
+     * @brief Wait for all uploads and destroy everything.
+     * */
+    void destroy();
+
+    /**
+     * @brief Copy data to staging ring and record copy to given buffer range.
+     * Data can be freed right after this call. If staging ring is full,
+     * current batch is submitted and this blocks until older batches complete.
+     *
+     * @param data Data to upload.
+     * @param size Size of data in bytes.
+     * @param dstBuffer Buffer to upload to.
+     * @param dstOffset Offset in dstBuffer to upload to.
+     * @return UploadTicket of batch the copy belongs to.
+     * */
+    UploadTicket upload(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset);
+
+    /**
+     * @brief Submit current batch if it has any copies.
+     *
+     * @return UploadTicket of last submitted batch.
+     * */
+    UploadTicket flush();
+
+    /**
+     * @brief Check if batch of given ticket is complete, without blocking.
+     *
+     * @param ticket Ticket returned by upload().
+     * @return true if all copies of batch are done on gpu.
+     * */
+    bool isComplete(UploadTicket ticket);
+
+    /**
+     * @brief Block until batch of given ticket is complete.
+     * Submits batch first if it's still being recorded.
+     *
+     * @param ticket Ticket returned by upload().
+     * */
+    void wait(UploadTicket ticket);
+
+    /**
+     * @brief Submit current batch and block until all batches are complete.
+     * */
+    void waitIdle();
+
+    /**
+     * @brief Retire all complete batches, without blocking.
+     * */
+    void poll();
+
+    /**
+     * @brief Record acquire of ownership of all ranges uploaded by complete batches.
+     * Must be recorded into a command buffer of destination queue family that
+     * is submitted before any of those ranges are used. Ranges are acquired even
+     * if queue families are the same, so isAcquired() works in both cases.
+     *
+     * @param cmd Command buffer of destination queue family.
+     * @param dstStage Pipeline stages that use uploaded data.
+     * @param dstAccess Access types of uploaded data.
+     * */
+    void recordAcquireBarriers(VkCommandBuffer cmd, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+    /**
+     * @brief Check if data of batch of given ticket can be used on destination queue.
+     *
+     * @param ticket Ticket returned by upload().
+     * @return true if batch is complete and its acquire barriers have been recorded.
+     * */
+    inline bool isAcquired(UploadTicket ticket) const { return ticket <= acquiredTicket; }
+
+    /// default size of staging ring
+    static constexpr VkDeviceSize defaultStagingSize = 64ull << 20;
+private:
+    // a batch of copies submitted together
+    struct Batch {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        // signaled when all copies of batch are done
+        VkFence fence = VK_NULL_HANDLE;
+        // bytes of staging ring consumed by batch, including alignment and wrap padding
+        VkDeviceSize stagingBytes = 0;
+        // ranges written by batch, released to destination family at end of batch
+        std::vector<VkBufferMemoryBarrier> ownershipBarriers;
+    };
+
+    // get batch being recorded, begins a new one if there's none
+    Batch& getRecordingBatch();
+    // retire oldest submitted batch, returns false if it's not complete and block is false
+    bool retireOldestBatch(bool block);
+    // reserve size bytes at head of staging ring, returns false if ring is full
+    bool allocateStaging(VkDeviceSize size, VkDeviceSize& offset, VkDeviceSize& consumed);
+    // batch that belongs to given ticket
+    inline Batch& getBatch(UploadTicket ticket) { return batches[ticket % maxBatches]; }
+
+    VkDevice device = VK_NULL_HANDLE;
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    MemoryBudget* budget = nullptr;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t srcQueueFamilyIndex = 0;
+    uint32_t dstQueueFamilyIndex = 0;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+
+    // persistently mapped staging ring
+    AllocatedBuffer stagingBuffer = {};
+    uint8_t* stagingData = nullptr;
+    VkDeviceSize stagingSize = 0;
+    // next free byte in ring and number of bytes in use by batches in flight
+    VkDeviceSize stagingHead = 0;
+    VkDeviceSize stagingUsed = 0;
+
+    // batches are reused in order of tickets
+    static constexpr uint32_t maxBatches = 4;
+    std::array<Batch, maxBatches> batches;
+
+    // ticket of batch being recorded, 0 if none
+    UploadTicket recordingTicket = 0;
+    // ticket of last submitted batch
+    UploadTicket submittedTicket = 0;
+    // ticket of last batch known to be complete
+    UploadTicket completedTicket = 0;
+    // ticket of last batch whose ranges have been acquired by destination family
+    UploadTicket acquiredTicket = 0;
+
+    // released ranges of complete batches waiting to be acquired
+    std::vector<VkBufferMemoryBarrier> pendingAcquires;
+};
+
+#endif//UPLOAD_MANAGER_HPP
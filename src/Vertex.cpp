@@ -1,17 +1,28 @@
 #include "Vertex.hpp"
 
-VertexInputDescription Vertex::getVertexDescription(){
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+// make description of split streams with given attribute formats and offsets
+// positions are always in binding 0 and everything else in binding 1
+VertexInputDescription makeDescription(uint32_t positionStride, VkFormat positionFormat,
+                                       uint32_t attributeStride,
+                                       VkFormat colorFormat, uint32_t colorOffset,
+                                       VkFormat normalFormat, uint32_t normalOffset,
+                                       bool positionOnly){
     VertexInputDescription description;
 
     // binding defines how and where do we send data in shaders
 
-    // we will have just 1 vertex buffer binding, with a per-vertex rate
-    VkVertexInputBindingDescription mainBinding = {};
-    mainBinding.binding = 0;
-    mainBinding.stride = sizeof(Vertex);
-    mainBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    // position stream, per-vertex rate
+    VkVertexInputBindingDescription positionBinding = {};
+    positionBinding.binding = 0;
+    positionBinding.stride = positionStride;
+    positionBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-    description.bindings.push_back(mainBinding);
+    description.bindings.push_back(positionBinding);
 
     // attributes are just attributes/properties of data sent
 
@@ -19,26 +30,123 @@ VertexInputDescription Vertex::getVertexDescription(){
     VkVertexInputAttributeDescription positionAttribute = {};
     positionAttribute.binding = 0;
     positionAttribute.location = 0;
-    positionAttribute.format = VK_FORMAT_R32G32B32_SFLOAT;
-    positionAttribute.offset = offsetof(Vertex, position);
+    positionAttribute.format = positionFormat;
+    positionAttribute.offset = 0;
+
+    description.attributes.push_back(positionAttribute);
+
+    // depth only passes don't need anything else
+    if(positionOnly) return description;
+
+    // attribute stream, per-vertex rate
+    VkVertexInputBindingDescription attributeBinding = {};
+    attributeBinding.binding = 1;
+    attributeBinding.stride = attributeStride;
+    attributeBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    description.bindings.push_back(attributeBinding);
 
     // Color will be stored at Location 1
     VkVertexInputAttributeDescription colorAttribute = {};
-    colorAttribute.binding = 0;
+    colorAttribute.binding = 1;
     colorAttribute.location = 1;
-    colorAttribute.format = VK_FORMAT_R32G32B32_SFLOAT;
-    colorAttribute.offset = offsetof(Vertex, color);
+    colorAttribute.format = colorFormat;
+    colorAttribute.offset = colorOffset;
 
     // Normal will be stored at Location 2
     VkVertexInputAttributeDescription normalAttribute = {};
-    normalAttribute.binding = 0;
+    normalAttribute.binding = 1;
     normalAttribute.location = 2;
-    normalAttribute.format = VK_FORMAT_R32G32B32_SFLOAT;
-    normalAttribute.offset = offsetof(Vertex, normal);
+    normalAttribute.format = normalFormat;
+    normalAttribute.offset = normalOffset;
 
-    description.attributes.push_back(positionAttribute);
     description.attributes.push_back(colorAttribute);
     description.attributes.push_back(normalAttribute);
 
     return description;
 }
+
+} // namespace
+
+VertexInputDescription Vertex::getVertexDescription(){
+    return makeDescription(sizeof(glm::vec3), VK_FORMAT_R32G32B32_SFLOAT,
+                           sizeof(VertexAttributes),
+                           VK_FORMAT_R32G32B32_SFLOAT, offsetof(VertexAttributes, color),
+                           VK_FORMAT_R32G32B32_SFLOAT, offsetof(VertexAttributes, normal),
+                           false);
+}
+
+VertexInputDescription Vertex::getPositionDescription(){
+    return makeDescription(sizeof(glm::vec3), VK_FORMAT_R32G32B32_SFLOAT,
+                           0, VK_FORMAT_UNDEFINED, 0, VK_FORMAT_UNDEFINED, 0, true);
+}
+
+// attribute locations match Vertex so both variants share fragment shader
+// normalized formats are converted to floats by vertex fetch for free
+VertexInputDescription PackedVertex::getVertexDescription(){
+    return makeDescription(sizeof(PackedPosition), VK_FORMAT_R16G16B16A16_UNORM,
+                           sizeof(PackedAttributes),
+                           VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedAttributes, color),
+                           VK_FORMAT_R16G16_SNORM, offsetof(PackedAttributes, normal),
+                           false);
+}
+
+VertexInputDescription PackedVertex::getPositionDescription(){
+    return makeDescription(sizeof(PackedPosition), VK_FORMAT_R16G16B16A16_UNORM,
+                           0, VK_FORMAT_UNDEFINED, 0, VK_FORMAT_UNDEFINED, 0, true);
+}
+
+// project on octahedron and unfold lower half over upper half
+glm::vec2 octEncode(const glm::vec3& n){
+    float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if(l1 == 0.f) return glm::vec2(0.f);
+
+    glm::vec3 p = n / l1;
+    if(p.z >= 0.f) return glm::vec2(p.x, p.y);
+
+    return glm::vec2((1.f - std::abs(p.y)) * (p.x >= 0.f ? 1.f : -1.f),
+                     (1.f - std::abs(p.x)) * (p.y >= 0.f ? 1.f : -1.f));
+}
+
+// inverse of octEncode, same as the one in packed vertex shader
+glm::vec3 octDecode(const glm::vec2& e){
+    glm::vec3 n(e.x, e.y, 1.f - std::abs(e.x) - std::abs(e.y));
+    float t = std::max(-n.z, 0.f);
+    n.x += n.x >= 0.f ? -t : t;
+    n.y += n.y >= 0.f ? -t : t;
+    return glm::normalize(n);
+}
+
+// quantize to nearest representable value
+static uint16_t quantizeUnorm16(float v){
+    return static_cast<uint16_t>(std::clamp(v, 0.f, 1.f) * 65535.f + 0.5f);
+}
+
+static int16_t quantizeSnorm16(float v){
+    return static_cast<int16_t>(std::round(std::clamp(v, -1.f, 1.f) * 32767.f));
+}
+
+static uint8_t quantizeUnorm8(float v){
+    return static_cast<uint8_t>(std::clamp(v, 0.f, 1.f) * 255.f + 0.5f);
+}
+
+PackedVertex packVertex(const Vertex& vertex, const glm::vec3& offset, float scale){
+    PackedVertex packed;
+
+    glm::vec3 p = (vertex.position - offset) / scale;
+    packed.position.position[0] = quantizeUnorm16(p.x);
+    packed.position.position[1] = quantizeUnorm16(p.y);
+    packed.position.position[2] = quantizeUnorm16(p.z);
+    packed.position.position[3] = 0;
+
+    glm::vec2 n = octEncode(vertex.normal);
+    packed.attributes.normal[0] = quantizeSnorm16(n.x);
+    packed.attributes.normal[1] = quantizeSnorm16(n.y);
+
+    packed.attributes.color[0] = quantizeUnorm8(vertex.color.r);
+    packed.attributes.color[1] = quantizeUnorm8(vertex.color.g);
+    packed.attributes.color[2] = quantizeUnorm8(vertex.color.b);
+    packed.attributes.color[3] = 255;
+
+    return packed;
+}
@@ -12,13 +12,113 @@
 
 #include "Common.hpp"
 #include "VertexInputDescription.hpp"
+#include "VertexFormat.hpp"
 
+// Full precision vertex used on cpu side by all mesh processing.
+// On gpu it's split in two streams, positions in binding 0 and
+// remaining attributes in binding 1, so depth only passes fetch positions only.
 struct Vertex{
     glm::vec3 position;
     glm::vec3 color;
     glm::vec3 normal;
 
+    /**
+     * @brief Get description of both vertex streams.
+     * @return VertexInputDescription with position and attribute bindings.
+     * */
    static VertexInputDescription getVertexDescription();
+
+    /**
+     * @brief Get description of position stream only, for depth only pipelines.
+     * @return VertexInputDescription with position binding.
+     * */
+   static VertexInputDescription getPositionDescription();
+};
+
+// attribute stream of VertexFormat::Float, 24 bytes
+struct VertexAttributes{
+    glm::vec3 color;
+    glm::vec3 normal;
+};
+
+// position stream of VertexFormat::Packed, 8 bytes
+// unorm16 x, y, z in [0, 1] of mesh quantization range, w is padding
+struct PackedPosition{
+    uint16_t position[4];
+};
+
+// attribute stream of VertexFormat::Packed, 8 bytes
+struct PackedAttributes{
+    // snorm16 octahedral encoded normal
+    int16_t normal[2];
+    // unorm8 r, g, b, a
+    uint8_t color[4];
+};
+
+// Compact vertex used by meshes with VertexFormat::Packed.
+// Positions are quantized to 16 bit fixed point relative to mesh bounds,
+// normals are octahedral encoded and colors are 8 bit per channel.
+struct PackedVertex{
+    PackedPosition position;
+    PackedAttributes attributes;
+
+    /**
+     * @brief Get description of both packed vertex streams.
+     * @return VertexInputDescription with position and attribute bindings.
+     * */
+   static VertexInputDescription getVertexDescription();
+
+    /**
+     * @brief Get description of packed position stream only, for depth only pipelines.
+     * @return VertexInputDescription with position binding.
+     * */
+   static VertexInputDescription getPositionDescription();
 };
 
+/**
+ * @brief Size of a single vertex in position stream of given format.
+ *
+ * @param format Vertex format.
+ * @return size_t Stride of binding 0 in bytes.
+ * */
+inline size_t getPositionStride(VertexFormat format){
+    return format == VertexFormat::Packed ? sizeof(PackedPosition) : sizeof(glm::vec3);
+}
+
+/**
+ * @brief Size of a single vertex in attribute stream of given format.
+ *
+ * @param format Vertex format.
+ * @return size_t Stride of binding 1 in bytes.
+ * */
+inline size_t getAttributeStride(VertexFormat format){
+    return format == VertexFormat::Packed ? sizeof(PackedAttributes) : sizeof(VertexAttributes);
+}
+
+/**
+ * @brief Encode unit vector in octahedral mapping.
+ *
+ * @param n Normalized vector.
+ * @return glm::vec2 Encoded vector with components in [-1, 1].
+ * */
+glm::vec2 octEncode(const glm::vec3& n);
+
+/**
+ * @brief Decode octahedral mapped unit vector.
+ *
+ * @param e Encoded vector with components in [-1, 1].
+ * @return glm::vec3 Normalized vector.
+ * */
+glm::vec3 octDecode(const glm::vec2& e);
+
+/**
+ * @brief Pack a full precision vertex.
+ *
+ * @param vertex Vertex to pack.
+ * @param offset Position mapped to zero by quantization.
+ * @param scale Size of quantization range along every axis.
+ * @return PackedVertex
+ * */
+PackedVertex packVertex(const Vertex& vertex, const glm::vec3& offset, float scale);
+
 #endif//VERTEX_HPP
@@ -0,0 +1,19 @@
+#ifndef VERTEX_FORMAT_HPP
+#define VERTEX_FORMAT_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+// Layout vertices of a mesh are stored in on gpu.
+// Every format has it's own vertex shader and pipeline variant.
+enum class VertexFormat : uint8_t {
+    // full precision Vertex, 36 bytes per vertex, 12 of them positions
+    Float = 0,
+    // quantized PackedVertex, 16 bytes per vertex, 8 of them positions
+    Packed = 1
+};
+
+// number of available vertex formats
+constexpr size_t VertexFormatCount = 2;
+
+#endif//VERTEX_FORMAT_HPP
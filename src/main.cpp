@@ -5,6 +5,8 @@
 #include <SDL2/SDL_video.h>
 
 #include <chrono>
+#include <thread>
+#include <atomic>
 
 #include <glm/gtx/transform.hpp>
 #include <glm/gtx/rotate_vector.hpp>
@@ -18,6 +20,7 @@
 #include "Camera.hpp"
 #include "MouseState.hpp"
 #include "Math.hpp"
+#include "TripleBuffer.hpp"
 
 SDL_Window* createWindow();
 
@@ -84,8 +87,8 @@ int main(){
     float totalFrameTime = 0.f;
     uint64_t frameNumber = 0;
 
-    // change in time from last frame
-    float deltaTime;
+    // change in time from last simulation step
+    float deltaTime = 0.f;
 
     float fieldOfView = 45.f;
     int windowWidth = WINDOW_WIDTH, windowHeight = WINDOW_HEIGHT;
@@ -102,22 +105,158 @@ int main(){
     // keep track of mouse state
     MouseState mouse;
 
-    Material defaultMaterial = *renderer.getMaterial("defaultMaterial");
+    MaterialHandle defaultMaterial = renderer.findMaterial("defaultMaterial");
 
     Mesh terrain;
     // createSphereMesh(terrain, 100, 100);
     // createRectangleMesh(terrain, 30, 30, {1, 0.5, 0.25});
     std::vector<float> X;
     genLinear(X, -5, 5, 50);
-    createSurface(terrain, X, X, genZ);
+    createSurface(terrain, X, X, [](float x, float y){ return genZ(x, y); });
 
-    renderer.uploadMesh(terrain);
+    std::cout << "Terrain Size : " << terrain.vertices.size() * sizeof(Vertex) + terrain.indices.size() * 4 << std::endl;
+    MeshHandle terrainMesh = renderer.createMesh(std::move(terrain), "terrain");
+    renderer.uploadMesh(*renderer.getMesh(terrainMesh));
 
-    RenderObject terrainObj(&terrain, &defaultMaterial);
+    RenderObject terrainObj(terrainMesh, defaultMaterial);
    terrainObj.setScale({3, 3, 3});
 //    terrainObj.setRotation(Camera::XAxis, 90);
     renderer.addRenderObject(terrainObj);
-    std::cout << "Terrain Size : " << terrain.vertices.size() * sizeof(Vertex) + terrain.indices.size() * 4 << std::endl;
+
+    // animated wave generated on gpu, only its parameters are sent every frame
+    GpuSurfaceHandle wave = renderer.createGpuSurface("wave", SHADER_DIR "surface_height.comp.spv",
+                                                      256, 256, {-5, -5}, {5, 5});
+    if(wave){
+        RenderObject waveObj(renderer.getGpuSurface(wave)->mesh, defaultMaterial);
+        waveObj.setPosition({0, -6, 0});
+        waveObj.setScale({3, 3, 3});
+        renderer.addRenderObject(waveObj);
+    }
+
+    // plot edited every frame, only rows under a moving bump are sent to gpu
+    const uint32_t plotResolution = 200;
+    Mesh plotSource;
+    std::vector<float> plotX;
+    genLinear(plotX, -5, 5, plotResolution);
+    createSurface(plotSource, plotX, plotX, [](float, float){ return 0.f; });
+    DynamicMeshHandle plot = renderer.createDynamicMesh("plot", plotSource);
+    if(plot){
+        RenderObject plotObj(renderer.getDynamicMesh(plot)->mesh, defaultMaterial);
+        plotObj.setPosition({0, 10, 0});
+        plotObj.setScale({3, 3, 3});
+        renderer.addRenderObject(plotObj);
+    }
+
+    // row of primitives, every shape is one shared mesh tinted per object
+    const std::pair<PrimitiveType, uint32_t> primitives[] = {
+        {PrimitiveType::UVSphere, 32}, {PrimitiveType::Icosphere, 3}, {PrimitiveType::Cube, 1},
+        {PrimitiveType::Cylinder, 32}, {PrimitiveType::Cone, 32}, {PrimitiveType::Torus, 48},
+        {PrimitiveType::Grid, 8}
+    };
+    for(size_t p = 0; p < std::size(primitives); p++){
+        RenderObject primitiveObj(renderer.getPrimitive(primitives[p].first, primitives[p].second), defaultMaterial);
+        primitiveObj.setPosition({-15.f + 5.f * p, 2, -20});
+        primitiveObj.setScale({1.5, 1.5, 1.5});
+        float hue = float(p) / std::size(primitives);
+        primitiveObj.setColor({0.5f + 0.5f * std::cos(2.f * float(PI) * hue),
+                               0.5f + 0.5f * std::cos(2.f * float(PI) * (hue - 1.f / 3.f)),
+                               0.5f + 0.5f * std::cos(2.f * float(PI) * (hue - 2.f / 3.f)), 1.f});
+        renderer.addRenderObject(primitiveObj);
+    }
+
+    // orrery, only its root is turned every frame and the rest follows through hierarchy
+    RenderObject sunObj(renderer.getPrimitive(PrimitiveType::Icosphere, 3), defaultMaterial);
+    sunObj.setPosition({15, 6, -10});
+    sunObj.setColor({1.f, 0.8f, 0.2f, 1.f});
+    size_t sun = renderer.addRenderObject(sunObj);
+    for(uint32_t p = 0; p < 3; p++){
+        RenderObject planetObj(renderer.getPrimitive(PrimitiveType::UVSphere, 24), defaultMaterial);
+        planetObj.setPosition({3.f + 2.f * p, 0, 0});
+        planetObj.setScale(glm::vec3(0.4f));
+        planetObj.setColor({0.3f, 0.5f + 0.2f * p, 1.f, 1.f});
+        size_t planet = renderer.addRenderObject(planetObj);
+        renderer.renderObjects[planet].setParent(&renderer.renderObjects[sun]);
+
+        // ring around planet is relative to planet, scale of planet applies to it too
+        RenderObject ringObj(renderer.getPrimitive(PrimitiveType::Torus, 32), defaultMaterial);
+        ringObj.setScale(glm::vec3(2.f));
+        ringObj.setRotation({1, 0, 0}, 20.f * p);
+        size_t ring = renderer.addRenderObject(ringObj);
+        renderer.renderObjects[ring].setParent(&renderer.renderObjects[planet]);
+    }
+
+    // kilometers of terrain, nodes get coarser with distance so triangle count stays about the same
+    TerrainSettings terrainSettings;
+    terrainSettings.origin = glm::vec2(-2048.f);
+    terrainSettings.size = 4096.f;
+    terrainSettings.lodCount = 8;
+    Terrain landscape;
+    landscape.init(terrainSettings, 2049, [](float x, float z){
+        // a few octaves of waves, well below rest of the scene
+        return -40.f + 30.f * std::sin(x * 0.004f) * std::cos(z * 0.003f)
+                     + 8.f * std::sin(x * 0.021f + z * 0.017f)
+                     + 2.f * std::sin(x * 0.093f) * std::sin(z * 0.087f);
+    });
+    renderer.uploadTerrain(landscape);
+    camera.setClipPlanes(0.1f, 4000.f);
+
+    // gpu memory use is dumped periodically, so long sessions can be checked for leaks
+    renderer.memoryBudget.dumpPath = "memory_budget.json";
+    renderer.memoryBudget.dumpInterval = 10.f;
+
+    // snapshots of scene travel from simulation on this thread to render thread
+    TripleBuffer<FrameSnapshot> snapshots;
+    std::atomic<bool> rendering{true};
+    uint64_t renderedFrames = 0;
+
+    // render thread owns everything on gpu, so animated surfaces and dynamic meshes
+    // are driven from time of snapshot here, then snapshot is recorded, submitted and presented
+    std::thread renderThread([&](){
+        while(rendering.load(std::memory_order_relaxed)){
+            // redrawing a snapshot that was already drawn would show same frame again,
+            // so sleep until next one, waking up now and then to see if drawing should stop
+            if(!snapshots.acquireWait(std::chrono::milliseconds(50))) continue;
+            const FrameSnapshot& snapshot = snapshots.getReadBuffer();
+
+            // advance wave animation, time is in seconds
+            if(GpuSurface* surface = renderer.getGpuSurface(wave)) surface->setTime(snapshot.time);
+
+            // move bump around plot, rewriting only rows it covers now or covered last frame
+            if(DynamicMesh* plotMesh = renderer.getDynamicMesh(plot)){
+                static uint32_t lastRow = 0;
+                const uint32_t radius = 10, rows = 2 * radius + 1;
+                float t = snapshot.time;
+                uint32_t centerI = radius + uint32_t((0.5f + 0.5f * std::cos(t)) * (plotResolution - rows));
+                uint32_t centerJ = radius + uint32_t((0.5f + 0.5f * std::sin(t)) * (plotResolution - rows));
+
+                auto writeRows = [&](uint32_t firstRow){
+                    Vertex* vertices = plotMesh->editVertices(firstRow * plotResolution, rows * plotResolution);
+                    for(uint32_t j = 0; j < rows; j++){
+                        for(uint32_t i = 0; i < plotResolution; i++){
+                            float di = float(i) - float(centerI), dj = float(firstRow + j) - float(centerJ);
+                            float r2 = (di * di + dj * dj) / float(radius * radius);
+                            float falloff = std::max(0.f, 1.f - r2);
+                            // slope per grid step, grid steps are 10 / plotResolution units apart
+                            float slope = -2.f * falloff / float(radius * radius) * plotResolution / 10.f;
+                            Vertex& vertex = vertices[j * plotResolution + i];
+                            vertex.position.y = 0.5f * falloff * falloff;
+                            vertex.normal = glm::normalize(glm::vec3(-slope * di, 1.f, -slope * dj));
+                        }
+                    }
+                };
+                writeRows(lastRow);
+                lastRow = centerJ - radius;
+                writeRows(lastRow);
+            }
+
+            // draw to screen, blocks on present without holding back simulation
+            renderer.draw(snapshot);
+            renderedFrames++;
+        }
+    });
+
+    // simulation steps at a fixed rate, however fast frames are drawn
+    const auto simulationStep = std::chrono::microseconds(1000000 / 120);
 
     // the game loop
     while(gameIsRunning){
@@ -186,24 +325,37 @@ int main(){
             renderer.uniformData.pointLights[i].position = glm::vec4(sphericalToCartesian(radius, glm::radians(float(radius*frameNumber)), PI/2), 1) + glm::vec4{0, 2, 0, 0};
         }
 
-        // update camera position
-        renderer.uniformData.viewPosition = camera.getPosition();
+        // turning sun moves planets and their rings in next transform update
+        renderer.renderObjects[sun].setRotation({0, 1, 0}, totalFrameTime / 100.f);
 
-        // update uniform data
-        renderer.uniformData.viewMatrix = camera.getViewMatrix();
-        renderer.uniformData.projectionMatrix = camera.getProjectionMatrix();
+        // hand scene over, render thread always picks latest snapshot and skips older ones
+        FrameSnapshot& snapshot = snapshots.getWriteBuffer();
+        renderer.captureSnapshot(camera, snapshot);
+        snapshot.frame = frameNumber;
+        snapshot.time = totalFrameTime / 1000.f;
+        snapshots.publish();
 
-        // draw to screen
-        renderer.draw();
+        std::this_thread::sleep_until(start + simulationStep);
 
-        auto stop = std::chrono::high_resolution_clock::now();;
-        deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(stop-start).count();
+        auto stop = std::chrono::high_resolution_clock::now();
+        deltaTime = std::chrono::duration<float, std::milli>(stop - start).count();
         totalFrameTime += deltaTime;
         frameNumber++;
     }
 
-    float avgFrameTime = totalFrameTime / frameNumber;
+    // render thread finishes frame it's drawing
+    rendering = false;
+    renderThread.join();
+
+    float avgFrameTime = totalFrameTime / std::max<uint64_t>(renderedFrames, 1);
     std::cout << "Average Frame Time : " << avgFrameTime << " milliseconds." << std::endl;
+    std::cout << "Simulation Steps : " << frameNumber << ", Frames Drawn : " << renderedFrames << std::endl;
+    for(size_t c = 0; c < MemoryCategoryCount; c++){
+        MemoryCategory category = static_cast<MemoryCategory>(c);
+        const MemoryBudget::CategoryUsage& usage = renderer.memoryBudget.getCategoryUsage(category);
+        std::cout << "GPU Memory " << getMemoryCategoryName(category) << " : " << usage.bytes / double(1 << 20)
+                  << " MB in " << usage.allocations << " allocations" << std::endl;
+    }
 
     // cleanup renderer
     renderer.cleanup();